@@ -0,0 +1,822 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QXmlStreamReader>
+#include <QtTest/QtTest>
+
+#ifdef Q_OS_LINUX
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+#include <ndef/ndefmessage.h>
+#include <ndef/ndefmessagecache.h>
+#include <ndef/ndefmessageframer.h>
+#include <ndef/ndefrecordbatch.h>
+#include <ndef/ndefsignature.h>
+#include <ndef/ndefsnep.h>
+#include <ndef/tlv.h>
+#include <ndef/core/record.h>
+#include <ndef/core/scan.h>
+
+QTextStream err(stderr);
+
+class NDEFBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void recordFromByteArray_data();
+    void recordFromByteArray();
+    void recordToByteArray_data();
+    void recordToByteArray();
+    void messageFromByteArray_data();
+    void messageFromByteArray();
+    void messageToByteArray_data();
+    void messageToByteArray();
+    void messageIterate_data();
+    void messageIterate();
+    void framerSplit_data();
+    void framerSplit();
+    void snepPut_data();
+    void snepPut();
+    void cachedFromByteArray_data();
+    void cachedFromByteArray();
+    void recordDeduplicate();
+    void batchAppend();
+    void batchScan();
+    void createUriRecord_data();
+    void createUriRecord();
+    void createTextRecord_data();
+    void createTextRecord();
+    void smartPosterBuild();
+    void smartPosterParse();
+    void genericControlBuild();
+    void genericControlParse();
+    void tlvFromByteArray_data();
+    void tlvFromByteArray();
+    void signatureSign();
+    void signatureVerify_data();
+    void signatureVerify();
+};
+
+static void addPayloadSizes()
+{
+    QTest::addColumn<int>("size");
+
+    const int sizes[] = { 0, 16, 255, 256, 4096, 65536 };
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        QTest::newRow((QByteArray::number(sizes[i]) + " bytes").constData()) << sizes[i];
+}
+
+static NDEFRecord mimeRecord(int size)
+{
+    return NDEFRecord::createMimeRecord("application/octet-stream", QByteArray(size, 'x'));
+}
+
+void NDEFBench::recordFromByteArray_data()
+{
+    addPayloadSizes();
+}
+
+void NDEFBench::recordFromByteArray()
+{
+    QFETCH(int, size);
+    const QByteArray data = mimeRecord(size).toByteArray(NDEFRecord::NDEF_MB | NDEFRecord::NDEF_ME);
+
+    NDEFRecord record;
+    QBENCHMARK {
+        record = NDEFRecord::fromByteArray(data);
+    }
+    QCOMPARE(record.payloadLength(), size);
+}
+
+void NDEFBench::recordToByteArray_data()
+{
+    addPayloadSizes();
+}
+
+void NDEFBench::recordToByteArray()
+{
+    QFETCH(int, size);
+    const NDEFRecord record = mimeRecord(size);
+
+    QByteArray data;
+    QBENCHMARK {
+        data = record.toByteArray(NDEFRecord::NDEF_MB | NDEFRecord::NDEF_ME);
+    }
+    QVERIFY(data.count() > size);
+}
+
+void NDEFBench::messageFromByteArray_data()
+{
+    QTest::addColumn<int>("records");
+    QTest::addColumn<int>("size");
+
+    const int counts[] = { 1, 8, 64, 512 };
+    const int sizes[] = { 16, 1024 };
+    for (unsigned i = 0; i < sizeof(counts) / sizeof(counts[0]); i++)
+        for (unsigned j = 0; j < sizeof(sizes) / sizeof(sizes[0]); j++)
+            QTest::newRow((QByteArray::number(counts[i]) + " x " + QByteArray::number(sizes[j]) + " bytes").constData()) << counts[i] << sizes[j];
+}
+
+void NDEFBench::messageFromByteArray()
+{
+    QFETCH(int, records);
+    QFETCH(int, size);
+
+    NDEFMessage msg;
+    for (int i = 0; i < records; i++)
+        msg.appendRecord(mimeRecord(size));
+    const QByteArray data = msg.toByteArray();
+
+    NDEFMessage decoded;
+    QBENCHMARK {
+        decoded = NDEFMessage::fromByteArray(data);
+    }
+    QCOMPARE(decoded.recordCount(), records);
+}
+
+void NDEFBench::messageToByteArray_data()
+{
+    QTest::addColumn<int>("records");
+    QTest::addColumn<int>("size");
+
+    // Below and above the size from which payloads are copied in parallel.
+    QTest::newRow("64 x 1024 bytes") << 64 << 1024;
+    QTest::newRow("512 x 1024 bytes") << 512 << 1024;
+    QTest::newRow("16 x 256 KiB") << 16 << 256 * 1024;
+    QTest::newRow("4 x 4 MiB") << 4 << 4 * 1024 * 1024;
+    QTest::newRow("1 x 16 MiB") << 1 << 16 * 1024 * 1024;
+}
+
+void NDEFBench::messageToByteArray()
+{
+    QFETCH(int, records);
+    QFETCH(int, size);
+
+    NDEFMessage msg;
+    for (int i = 0; i < records; i++)
+        msg.appendRecord(mimeRecord(size));
+
+    QByteArray data;
+    QBENCHMARK {
+        data = msg.toByteArray();
+    }
+    QCOMPARE(NDEFMessage::fromByteArray(data), msg);
+}
+
+void NDEFBench::messageIterate_data()
+{
+    QTest::addColumn<int>("records");
+
+    QTest::newRow("8 records") << 8;
+    QTest::newRow("512 records") << 512;
+    QTest::newRow("4096 records") << 4096;
+}
+
+// Reads the payload length of every record, in place.
+void NDEFBench::messageIterate()
+{
+    QFETCH(int, records);
+
+    NDEFMessage msg;
+    for (int i = 0; i < records; i++)
+        msg.appendRecord(mimeRecord(i % 64));
+
+    int total = 0;
+    QBENCHMARK {
+        total = 0;
+        for (const NDEFRecord& record : msg)
+            total += record.payloadLength();
+    }
+    QVERIFY(total > 0);
+}
+
+void NDEFBench::framerSplit_data()
+{
+    QTest::addColumn<int>("piece");
+
+    // The whole stream at once, or as it would come from a socket.
+    QTest::newRow("whole stream") << 0;
+    QTest::newRow("4096-byte reads") << 4096;
+    QTest::newRow("64-byte reads") << 64;
+}
+
+// 1024 messages of 1 to 4 records, laid end to end, split into frames.
+void NDEFBench::framerSplit()
+{
+    QFETCH(int, piece);
+
+    QByteArray stream;
+    for (int i = 0; i < 1024; i++)
+    {
+        NDEFMessage msg;
+        for (int j = 0; j <= i % 4; j++)
+            msg.appendRecord(mimeRecord(16 << j));
+        stream.append(msg.toByteArray());
+    }
+    if (piece == 0)
+        piece = stream.count();
+
+    int frames = 0;
+    QBENCHMARK {
+        NDEFMessageFramer framer;
+        frames = 0;
+        for (int position = 0; position < stream.count(); position += piece)
+        {
+            framer.append(QByteArray::fromRawData(stream.constData() + position, qMin(piece, stream.count() - position)));
+            int offset, length;
+            while (framer.next(&offset, &length) == NDEFMessageFramer::MessageReady)
+                frames++;
+        }
+    }
+    QCOMPARE(frames, 1024);
+}
+
+// Answers Put requests until the link is closed.
+class NDEFSnepServerThread : public QThread
+{
+public:
+    NDEFSnepServer server;
+
+    explicit NDEFSnepServerThread(NDEFSnepTransport* transport)
+        :   server(transport)
+    {
+        server.setPutHandler([](const NDEFMessage& msg) {
+            return msg.recordCount() > 0 ? ndef::SnepSuccess : ndef::SnepBadRequest;
+        });
+    }
+
+protected:
+    void run()
+    {
+        while (server.serveOne())
+            ;
+    }
+};
+
+void NDEFBench::snepPut_data()
+{
+    QTest::addColumn<int>("miu");
+    QTest::addColumn<int>("window");
+    QTest::addColumn<int>("size");
+
+    // The LLCP default MIU and receive window, then the largest of both.
+    QTest::newRow("MIU 128, window 1, 1 KiB") << 128 << 1 << 1024;
+    QTest::newRow("MIU 128, window 1, 64 KiB") << 128 << 1 << 64 * 1024;
+    QTest::newRow("MIU 2175, window 15, 1 KiB") << 2175 << 15 << 1024;
+    QTest::newRow("MIU 2175, window 15, 64 KiB") << 2175 << 15 << 64 * 1024;
+}
+
+// Round trips of a Put over the loopback transport, the server in another thread.
+void NDEFBench::snepPut()
+{
+    QFETCH(int, miu);
+    QFETCH(int, window);
+    QFETCH(int, size);
+
+    NDEFMessage msg;
+    msg.appendRecord(mimeRecord(size));
+    const QByteArray data = msg.toByteArray();
+
+    NDEFSnepLoopback link(miu, window);
+    NDEFSnepServerThread thread(link.server());
+    thread.start();
+
+    NDEFSnepClient client(link.client());
+    bool ok = true;
+    QBENCHMARK {
+        ok = client.put(data) && ok;
+    }
+    link.close();
+    thread.wait();
+    QVERIFY(ok);
+}
+
+void NDEFBench::cachedFromByteArray_data()
+{
+    messageFromByteArray_data();
+}
+
+// Repeat taps: every iteration after the first hits the cache.
+void NDEFBench::cachedFromByteArray()
+{
+    QFETCH(int, records);
+    QFETCH(int, size);
+
+    NDEFMessage msg;
+    for (int i = 0; i < records; i++)
+        msg.appendRecord(mimeRecord(size));
+    const QByteArray data = msg.toByteArray();
+
+    NDEFMessageCache cache(64 * 1024 * 1024);
+    NDEFMessage decoded;
+    QBENCHMARK {
+        decoded = cache.fromByteArray(data);
+    }
+    QCOMPARE(decoded.recordCount(), records);
+    QVERIFY(cache.hits() > 0);
+}
+
+// A stream of 4096 decoded records, 64 of them distinct, through a QSet.
+void NDEFBench::recordDeduplicate()
+{
+    NDEFRecordList stream;
+    for (int i = 0; i < 4096; i++)
+        stream.append(NDEFRecord::fromByteArray(NDEFRecord::createUriRecord("http://www.libnfc.org/" + QString::number(i % 64)).toByteArray()));
+
+    QSet<NDEFRecord> seen;
+    QBENCHMARK {
+        seen.clear();
+        for (int i = 0; i < stream.count(); i++)
+            seen.insert(stream.at(i));
+    }
+    QCOMPARE(seen.count(), 64);
+}
+
+// 1024 messages of a URI, a Text and a MIME record.
+static QVector<QByteArray> batchMessages()
+{
+    QVector<QByteArray> messages;
+    for (int i = 0; i < 1024; i++)
+    {
+        NDEFMessage msg;
+        msg.appendRecord(NDEFRecord::createUriRecord("https://example.com/tag/" + QString::number(i)));
+        msg.appendRecord(NDEFRecord::createTextRecord("Tag " + QString::number(i), (i % 2) ? "en" : "it"));
+        msg.appendRecord(mimeRecord(i % 256));
+        messages.append(msg.toByteArray());
+    }
+    return messages;
+}
+
+void NDEFBench::batchAppend()
+{
+    const QVector<QByteArray> messages = batchMessages();
+
+    NDEFRecordBatch batch(NDEFRecordBatch::UriCodes | NDEFRecordBatch::TextLocales);
+    QBENCHMARK {
+        batch.clear();
+        for (int i = 0; i < messages.count(); i++)
+            batch.append(messages.at(i));
+    }
+    QCOMPARE(batch.recordCount(), 3 * messages.count());
+}
+
+// Three aggregations over one column each, with no record decoded.
+void NDEFBench::batchScan()
+{
+    const QVector<QByteArray> messages = batchMessages();
+    NDEFRecordBatch batch(NDEFRecordBatch::UriCodes | NDEFRecordBatch::TextLocales);
+    for (int i = 0; i < messages.count(); i++)
+        batch.append(messages.at(i));
+
+    const quint16 en = quint16(batch.localeIndex("en"));
+    quint64 https = 0, english = 0, mime_bytes = 0;
+    QBENCHMARK {
+        https = ndef::countEqual(batch.uriCodes(), batch.recordCount(), quint8(0x04));
+        english = ndef::countEqual(batch.locales(), batch.recordCount(), en);
+        mime_bytes = ndef::sumWhere(batch.payloadLengths(), batch.tnfs(), batch.recordCount(), quint8(ndef::Media));
+    }
+    QCOMPARE(https, quint64(messages.count()));
+    QCOMPARE(english, quint64(messages.count() / 2));
+    QVERIFY(mime_bytes > 0);
+}
+
+void NDEFBench::createUriRecord_data()
+{
+    QTest::addColumn<QString>("uri");
+
+    QTest::newRow("http://www.") << QString("http://www.nfc-forum.org/specs/spec_list/");
+    QTest::newRow("urn:epc:id:") << QString("urn:epc:id:sgtin:0614141.107346.2017");
+    QTest::newRow("no prefix") << QString("geo:45.4642,9.1900");
+}
+
+void NDEFBench::createUriRecord()
+{
+    QFETCH(QString, uri);
+
+    NDEFRecord record;
+    QBENCHMARK {
+        record = NDEFRecord::createUriRecord(uri);
+    }
+    QVERIFY(record.payloadLength() > 0);
+}
+
+void NDEFBench::createTextRecord_data()
+{
+    QTest::addColumn<int>("codec");
+    QTest::addColumn<QString>("text");
+
+    const QString short_text("Hello, world!");
+    const QString long_text = QString("Lorem ipsum dolor sit amet, consectetur adipiscing elit. ").repeated(16);
+
+    QTest::newRow("UTF-8 short") << int(NDEFRecord::NDEF_UTF8) << short_text;
+    QTest::newRow("UTF-8 long") << int(NDEFRecord::NDEF_UTF8) << long_text;
+    QTest::newRow("UTF-16 short") << int(NDEFRecord::NDEF_UTF16) << short_text;
+    QTest::newRow("UTF-16 long") << int(NDEFRecord::NDEF_UTF16) << long_text;
+}
+
+void NDEFBench::createTextRecord()
+{
+    QFETCH(int, codec);
+    QFETCH(QString, text);
+
+    NDEFRecord record;
+    QBENCHMARK {
+        record = NDEFRecord::createTextRecord(text, "en-US", NDEFRecord::NDEFRecordTextCodec(codec));
+    }
+    QVERIFY(record.payloadLength() > text.count());
+}
+
+static NDEFRecordList smartPosterRecords()
+{
+    NDEFRecordList records;
+    records.append(NDEFRecord::createTextRecord("libndef", "en-US"));
+    records.append(NDEFRecord::createSpActionRecord(NDEFRecord::Do));
+    records.append(NDEFRecord::createSpSizeRecord(1024));
+    records.append(NDEFRecord::createSpTypeRecord("text/html"));
+    return records;
+}
+
+void NDEFBench::smartPosterBuild()
+{
+    const NDEFRecordList records = smartPosterRecords();
+
+    QByteArray data;
+    QBENCHMARK {
+        data = NDEFMessage(NDEFRecord::createSmartPosterRecord("http://www.libnfc.org", records)).toByteArray();
+    }
+    QVERIFY(!data.isEmpty());
+}
+
+void NDEFBench::smartPosterParse()
+{
+    const QByteArray data = NDEFMessage(NDEFRecord::createSmartPosterRecord("http://www.libnfc.org", smartPosterRecords())).toByteArray();
+
+    int count = 0;
+    QBENCHMARK {
+        NDEFMessage msg = NDEFMessage::fromByteArray(data);
+        count = NDEFMessage::fromByteArray(msg.record(0).payload()).recordCount();
+    }
+    QCOMPARE(count, 5);
+}
+
+static NDEFRecord genericControlRecord()
+{
+    return NDEFRecord::createGenericControlRecord(NDEFRecord::CheckExitCondition,
+                                                  NDEFRecord::createUriRecord("http://www.libnfc.org"),
+                                                  NDEFRecord::Open,
+                                                  NDEFRecord::createTextRecord("data", "en"));
+}
+
+void NDEFBench::genericControlBuild()
+{
+    const NDEFRecord target = NDEFRecord::createUriRecord("http://www.libnfc.org");
+    const NDEFRecord data = NDEFRecord::createTextRecord("data", "en");
+
+    QByteArray encoded;
+    QBENCHMARK {
+        encoded = NDEFRecord::createGenericControlRecord(NDEFRecord::CheckExitCondition, target, NDEFRecord::Open, data).toByteArray();
+    }
+    QVERIFY(!encoded.isEmpty());
+}
+
+void NDEFBench::genericControlParse()
+{
+    const QByteArray data = NDEFMessage(genericControlRecord()).toByteArray();
+
+    NDEFRecord record;
+    int found = 0;
+    QBENCHMARK {
+        record = NDEFMessage::fromByteArray(data).record(0);
+        found = !NDEFRecord::getGcTargetRecord(record).isEmpty()
+                + !NDEFRecord::getGcActionRecord(record).isEmpty()
+                + !NDEFRecord::getGcDataRecord(record).isEmpty();
+    }
+    QCOMPARE(record.type(), NDEFRecordType::genericControlRecordType());
+    Q_UNUSED(found);
+}
+
+void NDEFBench::tlvFromByteArray_data()
+{
+    QTest::addColumn<QByteArray>("dump");
+
+    // Tag memory dumps: leading NULL TLVs, the NDEF TLV, a terminator and
+    // zeroed memory up to the size of the tag.
+    const int sizes[] = { 64, 888, 8192 };
+    for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        NDEFMessage msg(NDEFRecord::createUriRecord("http://www.libnfc.org"));
+        QByteArray dump(4, char(Tlv::Null));
+        dump.append(Tlv::createNDEFMessageTlv(msg).toByteArray());
+        dump.append(Tlv::createTerminatorTlv().toByteArray());
+        dump.append(QByteArray(sizes[i] - dump.count(), 0));
+        QTest::newRow((QByteArray::number(sizes[i]) + " bytes").constData()) << dump;
+    }
+}
+
+void NDEFBench::tlvFromByteArray()
+{
+    QFETCH(QByteArray, dump);
+
+    TlvList list;
+    QBENCHMARK {
+        list = Tlv::fromByteArray(dump);
+    }
+    QVERIFY(!list.isEmpty());
+}
+
+// ECDSA P-256 signer of the signature benchmarks: a PKCS#8 key and its
+// self-signed certificate, both DER in base64. Only fit for benchmarking.
+static const char signer_key[] =
+    "MIGHAgEAMBMGByqGSM49AgEGCCqGSM49AwEHBG0wawIBAQQgE0YSklaH1h0o7v9N"
+    "xWmOvnXRZgCfgg6irKz7By62buKhRANCAAQV2nrT8zDLhNgeeoZ94TmnCjaPaloi"
+    "gc8ETLOJvKPuSBsLb6YleZNFq4KVLdoem5W1MXIP33PSS+uB1PU+Cwuu";
+
+static const char signer_certificate[] =
+    "MIIBnTCCAUOgAwIBAgIUCxFFkYe/CEJwd4YjucmVotkOXv8wCgYIKoZIzj0EAwIw"
+    "IzEhMB8GA1UEAwwYbGlibmRlZiBiZW5jaG1hcmsgc2lnbmVyMCAXDTI2MTAxODA5"
+    "MTAzMVoYDzIxMjYwOTI0MDkxMDMxWjAjMSEwHwYDVQQDDBhsaWJuZGVmIGJlbmNo"
+    "bWFyayBzaWduZXIwWTATBgcqhkjOPQIBBggqhkjOPQMBBwNCAAQV2nrT8zDLhNge"
+    "eoZ94TmnCjaPaloigc8ETLOJvKPuSBsLb6YleZNFq4KVLdoem5W1MXIP33PSS+uB"
+    "1PU+Cwuuo1MwUTAdBgNVHQ4EFgQUZprpcZFNCr7u8RcPqLJNBrFq/RwwHwYDVR0j"
+    "BBgwFoAUZprpcZFNCr7u8RcPqLJNBrFq/RwwDwYDVR0TAQH/BAUwAwEB/zAKBggq"
+    "hkjOPQQDAgNIADBFAiEA86lUSN203QyF7rUP1rl9rFBPQ6S8B4+VnHlZsukc6kMC"
+    "IFUICZ411UitmpI+42QSNAa2K8vkgHXNPS8l3J/cacj8";
+
+// A Smart Poster-sized message with a signature of its records.
+static NDEFMessage signedMessage(int serial)
+{
+    NDEFMessage msg(NDEFRecord::createUriRecord("http://www.libnfc.org/" + QString::number(serial)));
+    msg.appendRecord(NDEFRecord::createTextRecord("libnfc", "en"));
+    return NDEFSignature::sign(msg, NDEFSignature::EcdsaP256, QByteArray::fromBase64(signer_key),
+                               QList<QByteArray>() << QByteArray::fromBase64(signer_certificate));
+}
+
+void NDEFBench::signatureSign()
+{
+    if (!NDEFSignature::isAvailable())
+        QSKIP("libndef was built without CONFIG+=ndef_openssl");
+
+    NDEFMessage msg;
+    QBENCHMARK {
+        msg = signedMessage(0);
+    }
+    QCOMPARE(msg.recordCount(), 3);
+}
+
+void NDEFBench::signatureVerify_data()
+{
+    QTest::addColumn<int>("threads");
+    QTest::addColumn<bool>("cached");
+
+    const int ideal = qMax(1, QThread::idealThreadCount());
+    QTest::newRow("1 thread, no cache") << 1 << false;
+    QTest::newRow("1 thread, cached chain") << 1 << true;
+    QTest::newRow((QByteArray::number(ideal) + " threads, cached chain").constData()) << ideal << true;
+}
+
+/* Verifies batches of 1024 signed messages: the reported time is per batch.
+Without the cache, each message pays for parsing and validating its chain.
+*/
+void NDEFBench::signatureVerify()
+{
+    if (!NDEFSignature::isAvailable())
+        QSKIP("libndef was built without CONFIG+=ndef_openssl");
+
+    QFETCH(int, threads);
+    QFETCH(bool, cached);
+
+    QVector<QByteArray> batch;
+    for (int i = 0; i < 1024; i++)
+        batch.append(signedMessage(i).toByteArray());
+
+    NDEFSignatureVerifier verifier;
+    verifier.addTrustedCertificate(QByteArray::fromBase64(signer_certificate));
+    verifier.setThreadCount(threads);
+
+    QVector<NDEFSignatureVerifier::Status> results;
+    QBENCHMARK {
+        if (cached)
+        {
+            results = verifier.verify(batch);
+        }
+        else
+        {
+            results.clear();
+            for (int i = 0; i < batch.count(); i++)
+            {
+                verifier.clearCache();
+                results.append(verifier.verify(batch.at(i)));
+            }
+        }
+    }
+    QCOMPARE(results.count(), batch.count());
+    QCOMPARE(results.count(NDEFSignatureVerifier::Valid), batch.count());
+}
+
+// Returns true if the kernel lets us count hardware events for this process.
+static bool perfEventsAvailable()
+{
+#ifdef Q_OS_LINUX
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CPU_CYCLES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd < 0)
+        return false;
+    close(fd);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/* Runs the benchmarks once and merges the results, read from QtTest's XML
+output, into results (keyed by "function/tag"). Returns QtTest's exit code.
+*/
+static int runPass(const QString& program, const QStringList& options, QMap<QString, QJsonObject>& results, QStringList& order)
+{
+    QTemporaryFile log;
+    if (!log.open())
+        return 1;
+
+    QStringList arguments;
+    arguments << program << "-o" << (log.fileName() + ",xml") << options;
+
+    NDEFBench bench;
+    int failures = QTest::qExec(&bench, arguments);
+
+    log.seek(0);
+    QXmlStreamReader xml(&log);
+    QString function;
+    while (!xml.atEnd())
+    {
+        if (xml.readNext() != QXmlStreamReader::StartElement)
+            continue;
+
+        if (xml.name() == QLatin1String("TestFunction"))
+        {
+            function = xml.attributes().value("name").toString();
+        }
+        else if (xml.name() == QLatin1String("BenchmarkResult"))
+        {
+            const QXmlStreamAttributes attributes = xml.attributes();
+            const QString tag = attributes.value("tag").toString();
+            const QString key = function + "/" + tag;
+
+            if (!results.contains(key))
+            {
+                QJsonObject result;
+                result["name"] = function;
+                result["tag"] = tag;
+                results[key] = result;
+                order.append(key);
+            }
+
+            // QtTest reports the value per iteration.
+            QJsonObject& result = results[key];
+            result[attributes.value("metric").toString()] = attributes.value("value").toString().toDouble();
+            result["iterations"] = attributes.value("iterations").toString().toInt();
+        }
+    }
+
+    return failures;
+}
+
+void print_usage(const QString& appName)
+{
+    err << "Usage: " << appName << " [OPTIONS] [FUNCTION[:TAG]...]" << endl;
+    err << "Run the libndef microbenchmarks and write the results as JSON." << endl << endl;
+    err << "Options:" << endl;
+    err << "  -o FILE		write the JSON results to FILE instead of stdout" << endl;
+    err << "  -l LABEL		label stored with the results (e.g. a version or a commit)" << endl;
+    err << "  -n			do not collect hardware counters" << endl;
+    err << "Other options are passed to QtTest (e.g. -minimumvalue, -iterations)." << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app (argc, argv);
+
+    QStringList arguments = app.arguments();
+    QString program = arguments.takeFirst();
+    QString output_filename;
+    QString label;
+    bool counters = true;
+    QStringList qtest_options;
+
+    for (int i=0; i<arguments.count(); i++)
+    {
+        const QString argument = arguments.at(i);
+        if (argument == "-o" || argument == "-l")
+        {
+            if ((i+1) >= arguments.size())
+            {
+                err << argument << " option requires an argument" << endl;
+                return 1;
+            }
+            i++;
+            if (argument == "-o")
+                output_filename = arguments.at(i);
+            else
+                label = arguments.at(i);
+        }
+        else if (argument == "-n")
+        {
+            counters = false;
+        }
+        else if (argument == "-h")
+        {
+            print_usage(program);
+            return 0;
+        }
+        else
+        {
+            qtest_options.append(argument);
+        }
+    }
+
+    // One pass for wall time, then one per hardware counter: QtTest measures a
+    // single metric per run.
+    QList<QStringList> passes;
+    passes.append(QStringList());
+    if (counters && perfEventsAvailable())
+    {
+        const char* events[] = { "cpu-cycles", "instructions", "cache-misses", "branch-misses" };
+        for (unsigned i = 0; i < sizeof(events) / sizeof(events[0]); i++)
+            passes.append(QStringList() << "-perf" << "-perfcounter" << events[i]);
+    }
+    else if (counters)
+    {
+        err << "Hardware counters are not available, measuring wall time only." << endl;
+    }
+
+    QMap<QString, QJsonObject> results;
+    QStringList order;
+    int failures = 0;
+    foreach (const QStringList& pass, passes)
+        failures += runPass(program, pass + qtest_options, results, order);
+
+    QJsonArray benchmarks;
+    foreach (const QString& key, order)
+        benchmarks.append(results.value(key));
+
+    QJsonObject root;
+    root["suite"] = QString("ndef-bench");
+    root["label"] = label;
+    root["qt"] = QString(qVersion());
+    root["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["counters"] = (passes.count() > 1);
+    root["benchmarks"] = benchmarks;
+
+    QFile output;
+    if (output_filename.isEmpty())
+        output.open(stdout, QIODevice::WriteOnly);
+    else
+        output.setFileName(output_filename);
+    if (!output.isOpen() && !output.open(QIODevice::WriteOnly))
+    {
+        err << "Unable to open output file." << endl;
+        return 1;
+    }
+    output.write(QJsonDocument(root).toJson());
+
+    return failures;
+}
+
+#include "ndef-bench.moc"
@@ -0,0 +1,44 @@
+##
+# This file is part of the libndef project.
+#
+# This program is free software: you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+##
+
+QT       -= gui
+QT       += testlib
+
+TARGET = ndef-bench
+CONFIG   += console
+CONFIG   -= app_bundle
+
+TEMPLATE = app
+greaterThan(QT_MAJOR_VERSION, 4): CONFIG += c++17
+else: QMAKE_CXXFLAGS += -std=c++17
+
+INCLUDEPATH += ../include
+
+win32: {
+    LIBS += -L../libndef/release/
+    LIBS += -lndef2
+}
+
+unix: {
+    # Link to the library generated by the project.
+    LIBS += ../libndef/libndef.so
+    PRE_TARGETDEPS += ../libndef/libndef.so
+}
+
+SOURCES += ndef-bench.cpp
+
+# Benchmarks are run from the build tree and are not installed.
@@ -0,0 +1,236 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDateTime>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtCore/QVector>
+
+#include <algorithm>
+
+#include <ndef/ndefmessage.h>
+#include <ndef/ndefcapture.h>
+#include <ndef/tlv.h>
+
+QTextStream err(stderr);
+
+/* Reads every typed field of a message the way an application would, and
+folds what it reads into a checksum so that none of it can be optimised out.
+*/
+static quint64 inspectMessage(const NDEFMessage& msg, int depth)
+{
+    quint64 checksum = 0;
+    for (int i = 0; i < msg.recordCount(); i++)
+    {
+        const NDEFRecord record = msg.record(i);
+        const NDEFRecordType type = record.type();
+        const QByteArray payload = record.payload();
+        checksum += payload.count();
+
+        if (type.id() != NDEFRecordType::NDEF_NfcForumRTD || payload.isEmpty())
+            continue;
+
+        if (type == NDEFRecordType::textRecordType())
+        {
+            checksum += NDEFRecord::textLocale(payload).count();
+            checksum += NDEFRecord::textText(payload).count();
+        }
+        else if (type == NDEFRecordType::uriRecordType())
+        {
+            checksum += NDEFRecord::uriProtocol(payload).count();
+        }
+        else if (type == NDEFRecordType::smartPosterRecordType() && depth < 4)
+        {
+            checksum += inspectMessage(NDEFMessage::fromByteArray(payload), depth + 1);
+        }
+        else if (type == NDEFRecordType::genericControlRecordType())
+        {
+            checksum += NDEFRecord::getGcTargetRecord(record).payloadLength();
+            checksum += NDEFRecord::getGcActionRecord(record).payloadLength();
+            checksum += NDEFRecord::getGcDataRecord(record).payloadLength();
+        }
+    }
+    return checksum;
+}
+
+static qint64 percentile(const QVector<qint64>& sorted, double p)
+{
+    if (sorted.isEmpty())
+        return 0;
+    int index = qMin(sorted.count() - 1, int(p * sorted.count()));
+    return sorted.at(index);
+}
+
+void print_usage(const QString& appName)
+{
+    err << "Usage: " << appName << " CORPUS [OPTIONS]" << endl;
+    err << "Decode, inspect and re-encode every message of a capture file (e.g. made by ndef-gen)" << endl;
+    err << "and report throughput and latency as JSON." << endl << endl;
+    err << "Options:" << endl;
+    err << "  -i ITERATIONS	passes over the corpus (default: 5)" << endl;
+    err << "  -o FILE		write the JSON results to FILE instead of stdout" << endl;
+    err << "  -l LABEL		label stored with the results (e.g. a version or a commit)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app (argc, argv);
+
+    QStringList arguments = app.arguments();
+    QString corpus_filename;
+    QString output_filename;
+    QString label;
+    int iterations = 5;
+
+    for (int i=1; i<arguments.count(); i++)
+    {
+        const QString argument = arguments.at(i);
+        if (argument == "-h")
+        {
+            print_usage(arguments.at(0));
+            return 0;
+        }
+        else if (argument == "-i" || argument == "-o" || argument == "-l")
+        {
+            if ((i+1) >= arguments.size())
+            {
+                err << argument << " option requires an argument" << endl;
+                return 1;
+            }
+            i++;
+            if (argument == "-i")
+                iterations = qMax(1, arguments.at(i).toInt());
+            else if (argument == "-o")
+                output_filename = arguments.at(i);
+            else
+                label = arguments.at(i);
+        }
+        else
+        {
+            corpus_filename = argument;
+        }
+    }
+
+    NDEFCaptureReader corpus;
+    if (corpus_filename.isEmpty() || !corpus.open(corpus_filename))
+    {
+        print_usage(arguments.at(0));
+        return 1;
+    }
+
+    // Tell the TLV dumps apart once, outside of the measured loop.
+    const quint64 message_count = corpus.messageCount();
+    QVector<bool> tlv(message_count);
+    qint64 corpus_bytes = 0;
+    for (quint64 i = 0; i < message_count; i++)
+    {
+        tlv[i] = corpus.metadata(i).readerId().endsWith("/tlv");
+        corpus_bytes += corpus.message(i).count();
+    }
+
+    QVector<qint64> latencies;
+    latencies.reserve(message_count * iterations);
+    quint64 checksum = 0;
+    quint64 invalid = 0;
+
+    QElapsedTimer total;
+    total.start();
+    for (int iteration = 0; iteration < iterations; iteration++)
+    {
+        for (quint64 i = 0; i < message_count; i++)
+        {
+            QElapsedTimer timer;
+            timer.start();
+
+            QByteArray data = corpus.message(i);
+            if (tlv.at(i))
+            {
+                foreach (const Tlv& block, Tlv::fromByteArray(data))
+                {
+                    if (block.type() == Tlv::NDEF)
+                    {
+                        data = block.value();
+                        break;
+                    }
+                }
+            }
+
+            NDEFMessage msg = NDEFMessage::fromByteArray(data);
+            if (msg.isValid())
+            {
+                checksum += inspectMessage(msg, 0);
+                checksum += msg.toByteArray().count();
+            }
+            else
+            {
+                invalid++;
+            }
+
+            latencies.append(timer.nsecsElapsed());
+        }
+    }
+    const qint64 elapsed = qMax<qint64>(total.nsecsElapsed(), 1);
+
+    std::sort(latencies.begin(), latencies.end());
+
+    QJsonObject latency;
+    latency["p50"] = double(percentile(latencies, 0.50));
+    latency["p90"] = double(percentile(latencies, 0.90));
+    latency["p99"] = double(percentile(latencies, 0.99));
+    latency["p999"] = double(percentile(latencies, 0.999));
+    latency["max"] = double(latencies.isEmpty() ? 0 : latencies.last());
+
+    const double seconds = elapsed / 1e9;
+    QJsonObject root;
+    root["suite"] = QString("ndef-macrobench");
+    root["label"] = label;
+    root["qt"] = QString(qVersion());
+    root["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["corpus"] = corpus_filename;
+    root["messages"] = double(message_count);
+    root["bytes"] = double(corpus_bytes);
+    root["iterations"] = iterations;
+    root["invalid"] = double(invalid / iterations);
+    root["messages_per_second"] = double(message_count) * iterations / seconds;
+    root["megabytes_per_second"] = double(corpus_bytes) * iterations / seconds / 1e6;
+    root["latency_ns"] = latency;
+    root["checksum"] = QString::number(checksum, 16);
+
+    err << message_count << " messages, " << corpus_bytes << " bytes, " << iterations << " iteration(s): "
+        << root["messages_per_second"].toDouble() << " messages/s, "
+        << root["megabytes_per_second"].toDouble() << " MB/s, p99 "
+        << percentile(latencies, 0.99) << " ns" << endl;
+
+    QFile output;
+    if (output_filename.isEmpty())
+        output.open(stdout, QIODevice::WriteOnly);
+    else
+        output.setFileName(output_filename);
+    if (!output.isOpen() && !output.open(QIODevice::WriteOnly))
+    {
+        err << "Unable to open output file." << endl;
+        return 1;
+    }
+    output.write(QJsonDocument(root).toJson());
+
+    return 0;
+}
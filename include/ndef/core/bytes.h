@@ -0,0 +1,145 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_BYTES_H
+#define NDEF_CORE_BYTES_H
+
+/* The ndef core is the wire format engine of libndef: header-only, C++17,
+and without any dependency but the standard library. It never allocates;
+it reads from and writes to buffers owned by the caller. The Qt classes of
+libndef are built on top of it.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace ndef
+{
+
+/* A read-only view on bytes owned by someone else (std::span is C++20).
+Like everything in the core, it bounds-checks instead of trusting lengths
+read from the wire: mid() clamps to the bytes that are actually there.
+*/
+class Bytes
+{
+    const std::uint8_t* m_data;
+    std::size_t m_size;
+
+public:
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    constexpr Bytes() noexcept
+        :   m_data(nullptr),
+            m_size(0)
+    {
+    }
+
+    constexpr Bytes(const std::uint8_t* data, std::size_t size) noexcept
+        :   m_data(data),
+            m_size(size)
+    {
+    }
+
+    Bytes(const char* data, std::size_t size) noexcept
+        :   m_data(reinterpret_cast<const std::uint8_t*>(data)),
+            m_size(size)
+    {
+    }
+
+    explicit Bytes(std::string_view text) noexcept
+        :   Bytes(text.data(), text.size())
+    {
+    }
+
+    constexpr const std::uint8_t* data() const noexcept { return m_data; }
+    constexpr std::size_t size() const noexcept { return m_size; }
+    constexpr bool empty() const noexcept { return m_size == 0; }
+    constexpr const std::uint8_t* begin() const noexcept { return m_data; }
+    constexpr const std::uint8_t* end() const noexcept { return m_data + m_size; }
+    constexpr std::uint8_t operator[](std::size_t index) const noexcept { return m_data[index]; }
+
+    // Bytes left from offset on (0 past the end).
+    constexpr std::size_t available(std::size_t offset) const noexcept
+    {
+        return (offset < m_size) ? (m_size - offset) : 0;
+    }
+
+    constexpr Bytes mid(std::size_t offset, std::size_t length = npos) const noexcept
+    {
+        std::size_t left = available(offset);
+        return Bytes(left ? m_data + offset : m_data + m_size, (length < left) ? length : left);
+    }
+
+    std::string_view toStringView() const noexcept
+    {
+        return std::string_view(reinterpret_cast<const char*>(m_data), m_size);
+    }
+};
+
+constexpr bool operator==(Bytes a, Bytes b) noexcept
+{
+    if (a.size() != b.size())
+        return false;
+    for (std::size_t i = 0; i < a.size(); i++)
+        if (a[i] != b[i])
+            return false;
+    return true;
+}
+
+constexpr bool operator!=(Bytes a, Bytes b) noexcept
+{
+    return !(a == b);
+}
+
+// Big-endian integers, as everywhere in NDEF.
+constexpr std::uint16_t readUInt16(const std::uint8_t* data) noexcept
+{
+    return std::uint16_t((data[0] << 8) | data[1]);
+}
+
+constexpr std::uint32_t readUInt32(const std::uint8_t* data) noexcept
+{
+    return (std::uint32_t(data[0]) << 24) | (std::uint32_t(data[1]) << 16)
+         | (std::uint32_t(data[2]) << 8) | std::uint32_t(data[3]);
+}
+
+constexpr void writeUInt16(std::uint8_t* out, std::uint16_t value) noexcept
+{
+    out[0] = std::uint8_t(value >> 8);
+    out[1] = std::uint8_t(value);
+}
+
+constexpr void writeUInt32(std::uint8_t* out, std::uint32_t value) noexcept
+{
+    out[0] = std::uint8_t(value >> 24);
+    out[1] = std::uint8_t(value >> 16);
+    out[2] = std::uint8_t(value >> 8);
+    out[3] = std::uint8_t(value);
+}
+
+// Copies bytes to out and returns the position after them.
+constexpr std::uint8_t* copyBytes(std::uint8_t* out, Bytes bytes) noexcept
+{
+    for (std::size_t i = 0; i < bytes.size(); i++)
+        out[i] = bytes[i];
+    return out + bytes.size();
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_BYTES_H
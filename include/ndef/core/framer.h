@@ -0,0 +1,158 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_FRAMER_H
+#define NDEF_CORE_FRAMER_H
+
+/* Splits a stream of messages laid end to end (peer-to-peer logs, captures
+of several tags) on the MB and ME flags of their records. A message is the
+records from one with MB up to the next one with ME; only record headers are
+read, and frames are byte ranges of the caller's buffer.
+
+MessageFramer works on a buffer that grows as the stream comes in: each
+next() reads on from where the previous one stopped, so every header is read
+once. frameMessage() finds a single message and reads nothing past its ME.
+A message whose records declare more than the maximum frame size is an error
+as soon as the header saying so is read, so a corrupt length does not make
+the caller buffer the rest of the stream.
+*/
+
+#include "record.h"
+
+namespace ndef
+{
+
+enum FrameStatus : std::uint8_t
+{
+    FrameComplete,
+    FrameNeedMoreData,      // The buffer ends inside the message.
+    FrameMissingBegin,      // The first record of the message has no MB.
+    FrameUnexpectedBegin,   // A record after the first one has MB.
+    FrameReservedTnf,
+    FrameTooLarge           // The message would exceed the maximum frame size.
+};
+
+struct MessageFrame
+{
+    std::size_t offset = 0;
+    std::size_t size = 0;
+    std::size_t recordCount = 0;
+
+    constexpr Bytes bytes(Bytes data) const noexcept { return data.mid(offset, size); }
+};
+
+class MessageFramer
+{
+    std::size_t m_begin;        // Start of the message being framed.
+    std::size_t m_position;     // Next record header to read.
+    std::size_t m_records;
+    std::size_t m_maxSize;
+
+public:
+    constexpr explicit MessageFramer(std::size_t offset = 0, std::size_t max_size = Bytes::npos) noexcept
+        :   m_begin(offset),
+            m_position(offset),
+            m_records(0),
+            m_maxSize(max_size)
+    {
+    }
+
+    /* Frames the next message of data, which holds the stream from its first
+    byte not discarded yet. On an error, frame.offset is the offending record
+    and the framer does not move until skip().
+    */
+    constexpr FrameStatus next(Bytes data, MessageFrame& frame) noexcept
+    {
+        for (;;)
+        {
+            if (data.available(m_position) == 0)
+                return FrameNeedMoreData;
+
+            const std::uint8_t first = data[m_position];
+            frame.offset = m_position;
+            if ((first & 0x07) == Reserved)
+                return FrameReservedTnf;
+            if (m_position == m_begin && !(first & MessageBegin))
+                return FrameMissingBegin;
+            if (m_position != m_begin && (first & MessageBegin))
+                return FrameUnexpectedBegin;
+
+            RecordHeader header;
+            if (!decodeHeader(data, m_position, header))
+                return FrameNeedMoreData;
+            if (header.recordLength() > m_maxSize - (m_position - m_begin))
+                return FrameTooLarge;
+            if (header.recordLength() > data.available(m_position))
+                return FrameNeedMoreData;
+
+            m_position += std::size_t(header.recordLength());
+            m_records++;
+            if (header.isMessageEnd())
+            {
+                frame.offset = m_begin;
+                frame.size = m_position - m_begin;
+                frame.recordCount = m_records;
+                m_begin = m_position;
+                m_records = 0;
+                return FrameComplete;
+            }
+        }
+    }
+
+    /* After an error: drops the message being framed and moves to the next
+    byte that may begin a message (MB set, TNF not reserved). Returns false
+    if data has none; the framer then goes on from the end of data.
+    */
+    constexpr bool skip(Bytes data) noexcept
+    {
+        std::size_t position = m_position + 1;
+        if (m_position != m_begin && data.available(m_position) && (data[m_position] & MessageBegin))
+            position = m_position;  // A truncated message, followed by a new one.
+
+        while (position < data.size() && !((data[position] & MessageBegin) && (data[position] & 0x07) != Reserved))
+            position++;
+        m_begin = m_position = (position < data.size()) ? position : data.size();
+        m_records = 0;
+        return position < data.size();
+    }
+
+    // Bytes of complete (or skipped) messages, which the caller may drop from
+    // the front of its buffer, telling discard() it did.
+    constexpr std::size_t consumed() const noexcept { return m_begin; }
+
+    constexpr void discard(std::size_t count) noexcept
+    {
+        m_begin -= count;
+        m_position -= count;
+    }
+
+    constexpr void reset() noexcept
+    {
+        m_begin = m_position = m_records = 0;
+    }
+};
+
+// The message starting at offset, up to its ME record.
+constexpr FrameStatus frameMessage(Bytes data, std::size_t offset, MessageFrame& frame, std::size_t max_size = Bytes::npos) noexcept
+{
+    MessageFramer framer(offset, max_size);
+    return framer.next(data, frame);
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_FRAMER_H
@@ -0,0 +1,394 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_HANDOVER_H
+#define NDEF_CORE_HANDOVER_H
+
+/* Connection Handover (NFC Forum CH 1.2/1.3) and Bluetooth OOB payloads.
+
+A Handover Select ("Hs") or Request ("Hr") record opens the message. Its
+payload is a version byte followed by a message of local records: one
+Alternative Carrier ("ac") per carrier, a Collision Resolution ("cr") random
+number for requests and an optional Error ("err") for selects. Each "ac"
+refers by ID to a carrier configuration record found later in the message:
+a Bluetooth OOB MIME record, or a Handover Carrier ("Hc") record.
+
+decodeHandover() gets all of this reading each payload once, without
+allocating: the carriers, their power state and the fields of their
+Bluetooth configuration (address, class of device, LE role, keys), all as
+views into the message. Messages made of a lone Bluetooth OOB record, as
+written on many headsets, are decoded as a single carrier; in a message with
+a Handover Select or Request record, OOB records that no "ac" refers to are
+not part of the handover and are ignored.
+*/
+
+#include "record.h"
+
+namespace ndef
+{
+
+enum CarrierPowerState : std::uint8_t
+{
+    CarrierInactive,
+    CarrierActive,
+    CarrierActivating,
+    CarrierUnknown
+};
+
+enum CarrierKind : std::uint8_t
+{
+    UnknownCarrier,
+    BluetoothCarrier,       // application/vnd.bluetooth.ep.oob (BR/EDR)
+    BluetoothLeCarrier,     // application/vnd.bluetooth.le.oob
+    HandoverCarrier         // "Hc" record
+};
+
+// EIR and AD data types used in Bluetooth OOB payloads.
+enum BluetoothDataType : std::uint8_t
+{
+    BluetoothFlags                          = 0x01,
+    BluetoothShortenedLocalName             = 0x08,
+    BluetoothCompleteLocalName              = 0x09,
+    BluetoothClassOfDevice                  = 0x0D,
+    BluetoothSimplePairingHash              = 0x0E,
+    BluetoothSimplePairingRandomizer        = 0x0F,
+    BluetoothSecurityManagerTk              = 0x10,
+    BluetoothAppearance                     = 0x19,
+    BluetoothLeDeviceAddress                = 0x1B,
+    BluetoothLeRole                         = 0x1C,
+    BluetoothLeSecureConnectionsConfirmation = 0x22,
+    BluetoothLeSecureConnectionsRandom      = 0x23
+};
+
+enum LeRole : std::uint8_t
+{
+    LePeripheralOnly,
+    LeCentralOnly,
+    LePeripheralPreferred,
+    LeCentralPreferred,
+    LeRoleAbsent = 0xFF
+};
+
+constexpr std::uint8_t handoverVersion = 0x12;
+constexpr std::size_t maxHandoverCarriers = 8;
+constexpr std::string_view bluetoothOobType = "application/vnd.bluetooth.ep.oob";
+constexpr std::string_view bluetoothLeOobType = "application/vnd.bluetooth.le.oob";
+
+// Compares a record type; MIME types ignore ASCII case.
+constexpr bool typeEquals(Bytes type, std::string_view name, bool ignoreCase = false) noexcept
+{
+    if (type.size() != name.size())
+        return false;
+    for (std::size_t i = 0; i < name.size(); i++)
+    {
+        std::uint8_t a = type[i];
+        std::uint8_t b = std::uint8_t(name[i]);
+        if (ignoreCase && a >= 'A' && a <= 'Z')
+            a = std::uint8_t(a - 'A' + 'a');
+        if (a != b)
+            return false;
+    }
+    return true;
+}
+
+// "ac" payload.
+struct AlternativeCarrierView
+{
+    CarrierPowerState powerState = CarrierUnknown;
+    Bytes reference;            // ID of the carrier configuration record.
+    std::uint8_t auxiliaryCount = 0;
+    Bytes auxiliaryReferences;  // auxiliaryCount times a length and an ID.
+    bool valid = false;
+};
+
+constexpr AlternativeCarrierView decodeAlternativeCarrier(Bytes payload) noexcept
+{
+    AlternativeCarrierView carrier;
+    if (payload.size() < 2)
+        return carrier;
+    carrier.powerState = CarrierPowerState(payload[0] & 0x03);
+    carrier.reference = payload.mid(2, payload[1]);
+    std::size_t offset = 2 + std::size_t(payload[1]);
+    if (carrier.reference.size() != payload[1] || offset >= payload.size())
+        return carrier;
+    carrier.auxiliaryCount = payload[offset];
+    carrier.auxiliaryReferences = payload.mid(offset + 1);
+    carrier.valid = true;
+    return carrier;
+}
+
+// "Hc" payload.
+struct HandoverCarrierView
+{
+    TypeNameFormat carrierTypeFormat = Empty;
+    Bytes carrierType;
+    Bytes carrierData;
+    bool valid = false;
+};
+
+constexpr HandoverCarrierView decodeHandoverCarrier(Bytes payload) noexcept
+{
+    HandoverCarrierView carrier;
+    if (payload.size() < 2)
+        return carrier;
+    carrier.carrierTypeFormat = TypeNameFormat(payload[0] & 0x07);
+    carrier.carrierType = payload.mid(2, payload[1]);
+    carrier.carrierData = payload.mid(2 + std::size_t(payload[1]));
+    carrier.valid = (carrier.carrierType.size() == payload[1]);
+    return carrier;
+}
+
+/* Bluetooth OOB data. Addresses are as on the air, least significant byte
+first; keys are 16 bytes, empty when absent.
+*/
+struct BluetoothOobView
+{
+    bool lowEnergy = false;
+    bool valid = false;
+    Bytes address;              // 6 bytes.
+    std::uint8_t addressType = 0;   // LE: 0 public, 1 random.
+    bool hasClassOfDevice = false;
+    std::uint32_t classOfDevice = 0;
+    std::uint8_t leRole = LeRoleAbsent;
+    Bytes localName;            // UTF-8, complete or shortened.
+    Bytes hash;                 // Simple Pairing Hash C-192.
+    Bytes randomizer;           // Simple Pairing Randomizer R-192.
+    Bytes temporaryKey;         // Security Manager TK.
+    Bytes confirmation;         // LE Secure Connections confirmation value.
+    Bytes random;               // LE Secure Connections random value.
+};
+
+namespace detail
+{
+    // EIR/AD structures: a length (type and data), a type and the data.
+    constexpr void decodeBluetoothData(Bytes data, BluetoothOobView& oob) noexcept
+    {
+        std::size_t offset = 0;
+        while (offset < data.size())
+        {
+            std::size_t length = data[offset];
+            if (length == 0 || data.available(offset + 1) < length)
+                break;
+            const std::uint8_t type = data[offset + 1];
+            const Bytes value = data.mid(offset + 2, length - 1);
+            switch (type)
+            {
+                case BluetoothShortenedLocalName:
+                    if (oob.localName.empty())
+                        oob.localName = value;
+                    break;
+                case BluetoothCompleteLocalName:
+                    oob.localName = value;
+                    break;
+                case BluetoothClassOfDevice:
+                    if (value.size() == 3)
+                    {
+                        oob.hasClassOfDevice = true;
+                        oob.classOfDevice = std::uint32_t(value[0]) | (std::uint32_t(value[1]) << 8)
+                                          | (std::uint32_t(value[2]) << 16);
+                    }
+                    break;
+                case BluetoothSimplePairingHash:        oob.hash = value; break;
+                case BluetoothSimplePairingRandomizer:  oob.randomizer = value; break;
+                case BluetoothSecurityManagerTk:        oob.temporaryKey = value; break;
+                case BluetoothLeSecureConnectionsConfirmation: oob.confirmation = value; break;
+                case BluetoothLeSecureConnectionsRandom: oob.random = value; break;
+                case BluetoothLeDeviceAddress:
+                    if (value.size() == 7)
+                    {
+                        oob.address = value.mid(0, 6);
+                        oob.addressType = value[6] & 0x01;
+                    }
+                    break;
+                case BluetoothLeRole:
+                    if (value.size() == 1)
+                        oob.leRole = value[0];
+                    break;
+            }
+            offset += 1 + length;
+        }
+    }
+}
+
+/* application/vnd.bluetooth.ep.oob: the OOB data length (little-endian,
+counting itself), the device address, then EIR structures.
+*/
+constexpr BluetoothOobView decodeBluetoothOob(Bytes payload) noexcept
+{
+    BluetoothOobView oob;
+    if (payload.size() < 8)
+        return oob;
+    std::size_t length = std::size_t(payload[0]) | (std::size_t(payload[1]) << 8);
+    if (length < 8 || length > payload.size())
+        length = payload.size();
+    oob.address = payload.mid(2, 6);
+    detail::decodeBluetoothData(payload.mid(8, length - 8), oob);
+    oob.valid = true;
+    return oob;
+}
+
+// application/vnd.bluetooth.le.oob: AD structures only.
+constexpr BluetoothOobView decodeBluetoothLeOob(Bytes payload) noexcept
+{
+    BluetoothOobView oob;
+    oob.lowEnergy = true;
+    detail::decodeBluetoothData(payload, oob);
+    oob.valid = (oob.address.size() == 6);
+    return oob;
+}
+
+struct CarrierView
+{
+    CarrierPowerState powerState = CarrierUnknown;
+    Bytes reference;
+    std::uint8_t auxiliaryCount = 0;
+    Bytes auxiliaryReferences;
+    CarrierKind kind = UnknownCarrier;
+    bool configured = false;    // Whether its configuration record was found.
+    RecordView record;          // The configuration record.
+    BluetoothOobView bluetooth;
+    HandoverCarrierView handoverCarrier;
+};
+
+struct HandoverView
+{
+    bool valid = false;
+    bool select = false;        // "Hs" (otherwise "Hr", or no handover record).
+    bool request = false;
+    std::uint8_t version = 0;
+    bool hasRandomNumber = false;
+    std::uint16_t randomNumber = 0;     // From "cr".
+    Bytes error;                // "err" payload: reason and data.
+    std::size_t carrierCount = 0;
+    CarrierView carriers[maxHandoverCarriers];
+    bool truncated = false;     // More carriers than maxHandoverCarriers.
+};
+
+namespace detail
+{
+    constexpr void configureCarrier(CarrierView& carrier, const RecordView& record) noexcept
+    {
+        carrier.configured = true;
+        carrier.record = record;
+        if (record.header.tnf == Media && typeEquals(record.type, bluetoothOobType, true))
+        {
+            carrier.kind = BluetoothCarrier;
+            carrier.bluetooth = decodeBluetoothOob(record.payload);
+        }
+        else if (record.header.tnf == Media && typeEquals(record.type, bluetoothLeOobType, true))
+        {
+            carrier.kind = BluetoothLeCarrier;
+            carrier.bluetooth = decodeBluetoothLeOob(record.payload);
+        }
+        else if (record.header.tnf == WellKnown && typeEquals(record.type, "Hc"))
+        {
+            carrier.kind = HandoverCarrier;
+            carrier.handoverCarrier = decodeHandoverCarrier(record.payload);
+        }
+    }
+
+    constexpr bool isBluetoothRecord(const RecordView& record) noexcept
+    {
+        return record.header.tnf == Media
+            && (typeEquals(record.type, bluetoothOobType, true) || typeEquals(record.type, bluetoothLeOobType, true));
+    }
+
+    constexpr bool isHandoverRecord(const RecordView& record) noexcept
+    {
+        return record.header.tnf == WellKnown && (typeEquals(record.type, "Hs") || typeEquals(record.type, "Hr"));
+    }
+
+    constexpr CarrierView* addCarrier(HandoverView& handover) noexcept
+    {
+        if (handover.carrierCount == maxHandoverCarriers)
+        {
+            handover.truncated = true;
+            return nullptr;
+        }
+        return &handover.carriers[handover.carrierCount++];
+    }
+}
+
+constexpr HandoverView decodeHandover(Bytes message) noexcept
+{
+    HandoverView handover;
+
+    // Only headers are read: Bluetooth OOB records are carriers of their own
+    // in messages without a handover record.
+    bool lone_carriers = true;
+    for (const RecordView& record : RecordRange(message))
+        if (detail::isHandoverRecord(record))
+            lone_carriers = false;
+
+    for (const RecordView& record : RecordRange(message))
+    {
+        // 1) The handover record and its local records.
+        if (!handover.select && !handover.request && detail::isHandoverRecord(record))
+        {
+            handover.select = (record.type[1] == 's');
+            handover.request = !handover.select;
+            handover.version = record.payload.empty() ? 0 : record.payload[0];
+            for (const RecordView& local : RecordRange(record.payload.mid(1)))
+            {
+                if (local.header.tnf != WellKnown)
+                    continue;
+                if (typeEquals(local.type, "ac"))
+                {
+                    const AlternativeCarrierView ac = decodeAlternativeCarrier(local.payload);
+                    CarrierView* carrier = ac.valid ? detail::addCarrier(handover) : nullptr;
+                    if (carrier)
+                    {
+                        carrier->powerState = ac.powerState;
+                        carrier->reference = ac.reference;
+                        carrier->auxiliaryCount = ac.auxiliaryCount;
+                        carrier->auxiliaryReferences = ac.auxiliaryReferences;
+                    }
+                }
+                else if (typeEquals(local.type, "cr") && local.payload.size() >= 2)
+                {
+                    handover.hasRandomNumber = true;
+                    handover.randomNumber = readUInt16(local.payload.data());
+                }
+                else if (typeEquals(local.type, "err"))
+                {
+                    handover.error = local.payload;
+                }
+            }
+            continue;
+        }
+
+        // 2) Configuration records, matched to their carrier by ID.
+        CarrierView* carrier = nullptr;
+        if (!record.id.empty())
+        {
+            for (std::size_t i = 0; !carrier && i < handover.carrierCount; i++)
+                if (!handover.carriers[i].configured && handover.carriers[i].reference == record.id)
+                    carrier = &handover.carriers[i];
+        }
+        if (!carrier && lone_carriers && detail::isBluetoothRecord(record))
+            carrier = detail::addCarrier(handover);
+        if (carrier)
+            detail::configureCarrier(*carrier, record);
+    }
+
+    handover.valid = handover.select || handover.request || handover.carrierCount > 0;
+    return handover;
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_HANDOVER_H
@@ -0,0 +1,140 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_HASH_H
+#define NDEF_CORE_HASH_H
+
+/* A fast, non-cryptographic 64-bit hash of raw bytes (XXH64), for caches
+and hash tables keyed by encoded messages. It reads 32 bytes per round, so
+hashing a tag costs a few nanoseconds. Equal hashes do not mean equal bytes:
+compare them too.
+*/
+
+#include "bytes.h"
+
+namespace ndef
+{
+
+namespace detail
+{
+
+constexpr std::uint64_t hashPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t hashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t hashPrime3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t hashPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t hashPrime5 = 0x27D4EB2F165667C5ULL;
+
+constexpr std::uint64_t rotl64(std::uint64_t value, int bits) noexcept
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Little-endian, whatever the host: compilers turn these into plain loads.
+constexpr std::uint64_t readUInt64LE(const std::uint8_t* data) noexcept
+{
+    std::uint64_t value = 0;
+    for (int i = 7; i >= 0; i--)
+        value = (value << 8) | data[i];
+    return value;
+}
+
+constexpr std::uint32_t readUInt32LE(const std::uint8_t* data) noexcept
+{
+    return std::uint32_t(data[0]) | (std::uint32_t(data[1]) << 8)
+         | (std::uint32_t(data[2]) << 16) | (std::uint32_t(data[3]) << 24);
+}
+
+constexpr std::uint64_t hashRound(std::uint64_t acc, std::uint64_t input) noexcept
+{
+    return rotl64(acc + input * hashPrime2, 31) * hashPrime1;
+}
+
+constexpr std::uint64_t hashMerge(std::uint64_t acc, std::uint64_t lane) noexcept
+{
+    return (acc ^ hashRound(0, lane)) * hashPrime1 + hashPrime4;
+}
+
+} // namespace detail
+
+constexpr std::uint64_t hash64(Bytes bytes, std::uint64_t seed = 0) noexcept
+{
+    using namespace detail;
+
+    const std::uint8_t* p = bytes.data();
+    const std::uint8_t* const end = bytes.data() + bytes.size();
+    std::uint64_t h = 0;
+
+    // 1) Four lanes over 32-byte stripes.
+    if (bytes.size() >= 32)
+    {
+        std::uint64_t v1 = seed + hashPrime1 + hashPrime2;
+        std::uint64_t v2 = seed + hashPrime2;
+        std::uint64_t v3 = seed;
+        std::uint64_t v4 = seed - hashPrime1;
+        for (; end - p >= 32; p += 32)
+        {
+            v1 = hashRound(v1, readUInt64LE(p));
+            v2 = hashRound(v2, readUInt64LE(p + 8));
+            v3 = hashRound(v3, readUInt64LE(p + 16));
+            v4 = hashRound(v4, readUInt64LE(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = hashMerge(h, v1);
+        h = hashMerge(h, v2);
+        h = hashMerge(h, v3);
+        h = hashMerge(h, v4);
+    }
+    else
+    {
+        h = seed + hashPrime5;
+    }
+    h += bytes.size();
+
+    // 2) The tail, 8, 4 then 1 byte at a time.
+    for (; end - p >= 8; p += 8)
+        h = rotl64(h ^ hashRound(0, readUInt64LE(p)), 27) * hashPrime1 + hashPrime4;
+    if (end - p >= 4)
+    {
+        h = rotl64(h ^ (readUInt32LE(p) * hashPrime1), 23) * hashPrime2 + hashPrime3;
+        p += 4;
+    }
+    for (; p < end; p++)
+        h = rotl64(h ^ (*p * hashPrime5), 11) * hashPrime1;
+
+    // 3) Avalanche.
+    h ^= h >> 33;
+    h *= hashPrime2;
+    h ^= h >> 29;
+    h *= hashPrime3;
+    h ^= h >> 32;
+    return h;
+}
+
+// Folds value into seed, in an order-dependent way: for hashing sequences of hashes.
+constexpr std::uint64_t hashCombine(std::uint64_t seed, std::uint64_t value) noexcept
+{
+    return detail::hashMerge(seed, value);
+}
+
+inline std::uint64_t hash64(std::string_view text, std::uint64_t seed = 0) noexcept
+{
+    return hash64(Bytes(text), seed);
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_HASH_H
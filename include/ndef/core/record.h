@@ -0,0 +1,314 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_RECORD_H
+#define NDEF_CORE_RECORD_H
+
+#include "bytes.h"
+
+namespace ndef
+{
+
+enum TypeNameFormat : std::uint8_t
+{
+    Empty       = 0x00,
+    WellKnown   = 0x01, // NFC Forum well-known type.
+    Media       = 0x02, // Media-type as defined in RFC 2046.
+    AbsoluteUri = 0x03, // Absolute URI as defined in RFC 3986.
+    External    = 0x04, // NFC Forum external type.
+    Unknown     = 0x05,
+    Unchanged   = 0x06, // Used for payload chunks.
+    Reserved    = 0x07
+};
+
+enum RecordFlag : std::uint8_t
+{
+    IdLength        = 0x08, // ID_LENGTH is present.
+    ShortRecord     = 0x10, // Payload length on 8 bits.
+    Chunk           = 0x20, // Chunk flag.
+    MessageEnd      = 0x40,
+    MessageBegin    = 0x80
+};
+
+/* The fixed part of a record: flags, TNF and the three length fields.
+Records are laid out as
+
+    flags | TNF     1 byte
+    type length     1 byte
+    payload length  1 byte (SR) or 4 bytes
+    ID length       1 byte, only with IL
+    type, ID, payload
+*/
+struct RecordHeader
+{
+    std::uint8_t flags = 0;
+    TypeNameFormat tnf = Empty;
+    std::uint8_t typeLength = 0;
+    std::uint8_t idLength = 0;
+    std::uint32_t payloadLength = 0;
+    std::uint8_t headerLength = 0;
+
+    constexpr bool isMessageBegin() const noexcept { return flags & MessageBegin; }
+    constexpr bool isMessageEnd() const noexcept { return flags & MessageEnd; }
+    constexpr bool isChunk() const noexcept { return flags & Chunk; }
+    constexpr bool isShort() const noexcept { return flags & ShortRecord; }
+    constexpr bool hasId() const noexcept { return flags & IdLength; }
+
+    constexpr std::uint64_t recordLength() const noexcept
+    {
+        return std::uint64_t(headerLength) + typeLength + idLength + payloadLength;
+    }
+};
+
+constexpr std::size_t headerLength(std::uint8_t flags) noexcept
+{
+    return 2 + ((flags & ShortRecord) ? 1 : 4) + ((flags & IdLength) ? 1 : 0);
+}
+
+/* Reads the header of the record at offset. Returns false if data ends
+before the header does; the fields that could be read are still filled in
+and the others are left to zero.
+*/
+constexpr bool decodeHeader(Bytes data, std::size_t offset, RecordHeader& header) noexcept
+{
+    header = RecordHeader();
+    std::size_t available = data.available(offset);
+    if (available == 0)
+        return false;
+
+    const std::uint8_t* in = data.data() + offset;
+    header.flags = in[0] & 0xF8;
+    header.tnf = TypeNameFormat(in[0] & 0x07);
+    header.headerLength = std::uint8_t(headerLength(in[0]));
+    if (available > 1)
+        header.typeLength = in[1];
+    if (header.isShort())
+    {
+        if (available > 2)
+            header.payloadLength = in[2];
+    }
+    else if (available > 5)
+    {
+        header.payloadLength = readUInt32(in + 2);
+    }
+    if (header.hasId() && available >= header.headerLength)
+        header.idLength = in[header.headerLength - 1];
+
+    return available >= header.headerLength;
+}
+
+/* Whether a record starts at offset: at least three bytes are left and the
+TNF is not the reserved one. The record may still be truncated.
+*/
+constexpr bool hasRecord(Bytes data, std::size_t offset) noexcept
+{
+    return data.available(offset) > 2 && (data[offset] & 0x07) != Reserved;
+}
+
+/* Returns the size of the record at offset as declared by its header, or 0
+if data does not hold the whole record (yet). Only the header is read.
+*/
+constexpr std::size_t recordLength(Bytes data, std::size_t offset) noexcept
+{
+    RecordHeader header;
+    if (!decodeHeader(data, offset, header) || header.recordLength() > data.available(offset))
+        return 0;
+    return std::size_t(header.recordLength());
+}
+
+// A decoded record. Its fields point into the decoded buffer.
+struct RecordView
+{
+    RecordHeader header;
+    std::size_t offset = 0;
+    Bytes type;
+    Bytes id;
+    Bytes payload;
+    bool complete = false;  // Whether the buffer held the whole record.
+
+    // Bytes actually covered in the buffer (less than declared if truncated).
+    constexpr std::size_t size() const noexcept
+    {
+        return (complete ? std::size_t(header.recordLength())
+                         : header.headerLength + type.size() + id.size() + payload.size());
+    }
+};
+
+/* Decodes the record at offset. A truncated record is decoded as far as
+data goes: its type, ID and payload are cut at the end of data and complete
+is false.
+*/
+constexpr RecordView decodeRecord(Bytes data, std::size_t offset) noexcept
+{
+    RecordView record;
+    record.offset = offset;
+    bool header_complete = decodeHeader(data, offset, record.header);
+
+    std::size_t position = offset + record.header.headerLength;
+    record.type = data.mid(position, record.header.typeLength);
+    position += record.header.typeLength;
+    record.id = data.mid(position, record.header.idLength);
+    position += record.header.idLength;
+    record.payload = data.mid(position, record.header.payloadLength);
+
+    record.complete = header_complete && record.header.recordLength() <= data.available(offset);
+    if (!header_complete)
+        record.header.headerLength = std::uint8_t(data.available(offset));
+    return record;
+}
+
+/* The records of a message, for range-based for loops. Iteration stops
+where NDEFMessage::fromByteArray() always stopped: when less than three
+bytes are left, on the reserved TNF, or after a truncated record.
+*/
+class RecordRange
+{
+    Bytes m_data;
+    std::size_t m_offset;
+
+public:
+    class Iterator
+    {
+        Bytes m_data;
+        RecordView m_record;
+        bool m_end;
+
+        constexpr void load(std::size_t offset) noexcept
+        {
+            m_end = !hasRecord(m_data, offset);
+            if (!m_end)
+                m_record = decodeRecord(m_data, offset);
+        }
+
+    public:
+        constexpr Iterator() noexcept
+            :   m_end(true)
+        {
+        }
+
+        constexpr Iterator(Bytes data, std::size_t offset) noexcept
+            :   m_data(data),
+                m_end(true)
+        {
+            load(offset);
+        }
+
+        constexpr const RecordView& operator*() const noexcept { return m_record; }
+        constexpr const RecordView* operator->() const noexcept { return &m_record; }
+
+        constexpr Iterator& operator++() noexcept
+        {
+            if (m_record.complete)
+                load(m_record.offset + std::size_t(m_record.header.recordLength()));
+            else
+                m_end = true;
+            return *this;
+        }
+
+        constexpr bool operator==(const Iterator& other) const noexcept
+        {
+            if (m_end || other.m_end)
+                return m_end == other.m_end;
+            return m_record.offset == other.m_record.offset;
+        }
+
+        constexpr bool operator!=(const Iterator& other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    constexpr explicit RecordRange(Bytes data, std::size_t offset = 0) noexcept
+        :   m_data(data),
+            m_offset(offset)
+    {
+    }
+
+    constexpr Iterator begin() const noexcept { return Iterator(m_data, m_offset); }
+    constexpr Iterator end() const noexcept { return Iterator(); }
+
+    // Number of records, read from the headers only.
+    constexpr std::size_t count() const noexcept
+    {
+        std::size_t count = 0;
+        std::size_t offset = m_offset;
+        while (hasRecord(m_data, offset))
+        {
+            count++;
+            std::size_t length = recordLength(m_data, offset);
+            if (length == 0)
+                break;
+            offset += length;
+        }
+        return count;
+    }
+};
+
+// Size of an encoded record. SR and IL must already be set in flags.
+constexpr std::size_t encodedRecordLength(std::uint8_t flags, std::size_t typeLength,
+                                          std::size_t idLength, std::size_t payloadLength) noexcept
+{
+    return headerLength(flags) + typeLength + idLength + payloadLength;
+}
+
+// The flags a record needs for its lengths, added to the given ones.
+constexpr std::uint8_t recordFlags(std::uint8_t flags, std::size_t idLength, std::size_t payloadLength) noexcept
+{
+    return std::uint8_t((flags & 0xF8) | ((payloadLength < 256) ? ShortRecord : 0) | (idLength ? IdLength : 0));
+}
+
+/* Writes a record header and returns its length. The payload length takes
+one byte if flags has SR, and the ID length is only written with IL.
+*/
+constexpr std::size_t encodeHeader(std::uint8_t* out, std::uint8_t flags, TypeNameFormat tnf,
+                                   std::uint8_t typeLength, std::uint32_t payloadLength,
+                                   std::uint8_t idLength) noexcept
+{
+    std::size_t length = 0;
+    out[length++] = std::uint8_t((flags & 0xF8) | (tnf & 0x07));
+    out[length++] = typeLength;
+    if (flags & ShortRecord)
+    {
+        out[length++] = std::uint8_t(payloadLength);
+    }
+    else
+    {
+        writeUInt32(out + length, payloadLength);
+        length += 4;
+    }
+    if (flags & IdLength)
+        out[length++] = idLength;
+    return length;
+}
+
+/* Writes a whole record and returns its length, which is
+encodedRecordLength(flags, type.size(), id.size(), payload.size()).
+*/
+constexpr std::size_t encodeRecord(std::uint8_t* out, std::uint8_t flags, TypeNameFormat tnf,
+                                   Bytes type, Bytes id, Bytes payload) noexcept
+{
+    std::uint8_t* position = out + encodeHeader(out, flags, tnf, std::uint8_t(type.size()),
+                                                std::uint32_t(payload.size()), std::uint8_t(id.size()));
+    position = copyBytes(position, type);
+    position = copyBytes(position, id);
+    position = copyBytes(position, payload);
+    return std::size_t(position - out);
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_RECORD_H
@@ -0,0 +1,99 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_SCAN_H
+#define NDEF_CORE_SCAN_H
+
+/* Scans over columns: arrays holding one field of many records, such as
+those of NDEFRecordBatch. The loops have no branches in their bodies, so
+compilers vectorise them; nothing is allocated, selectEqual() writes into
+the caller's array.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ndef
+{
+
+// Number of rows where column equals value.
+template <typename T>
+constexpr std::size_t countEqual(const T* column, std::size_t count, T value) noexcept
+{
+    std::size_t matches = 0;
+    for (std::size_t i = 0; i < count; i++)
+        matches += (column[i] == value);
+    return matches;
+}
+
+/* Writes the rows where column equals value to rows, which has room for
+count of them, and returns how many there are.
+*/
+template <typename T>
+constexpr std::size_t selectEqual(const T* column, std::size_t count, T value, std::uint32_t* rows) noexcept
+{
+    std::size_t matches = 0;
+    for (std::size_t i = 0; i < count; i++)
+    {
+        rows[matches] = std::uint32_t(i);
+        matches += (column[i] == value);
+    }
+    return matches;
+}
+
+template <typename T>
+constexpr std::uint64_t sum(const T* column, std::size_t count) noexcept
+{
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < count; i++)
+        total += column[i];
+    return total;
+}
+
+// Sum of values over the rows where keys equals key.
+template <typename T, typename K>
+constexpr std::uint64_t sumWhere(const T* values, const K* keys, std::size_t count, K key) noexcept
+{
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < count; i++)
+        total += std::uint64_t(values[i]) * (keys[i] == key);
+    return total;
+}
+
+// Sum of values over the given rows, e.g. those of selectEqual().
+template <typename T>
+constexpr std::uint64_t sumRows(const T* values, const std::uint32_t* rows, std::size_t count) noexcept
+{
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < count; i++)
+        total += values[rows[i]];
+    return total;
+}
+
+/* Adds the number of rows holding each value to counts, which has an entry
+for every value of the column (256 for bytes).
+*/
+template <typename T>
+constexpr void histogram(const T* column, std::size_t count, std::uint64_t* counts) noexcept
+{
+    for (std::size_t i = 0; i < count; i++)
+        counts[column[i]]++;
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_SCAN_H
@@ -0,0 +1,225 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_SIGNATURE_H
+#define NDEF_CORE_SIGNATURE_H
+
+/* Signature RTD ("Sig" well-known records).
+
+    Payload
+        quint8                          version (0x20)
+        quint8                          bit 7: signature is a URI, bits 6-0: signature type
+        quint8                          hash type (0x02: SHA-256)
+        quint16 + bytes                 signature (or its URI)
+        quint8                          bit 7: chain URI present, bits 6-4: certificate
+                                        format, bits 3-0: certificate count
+        (quint16 + bytes) * count       certificates, signer's first
+        [quint16 + bytes]               certificate chain URI
+
+A signature covers the records that precede it, back to the previous "Sig"
+record or to the beginning of the message. A "Sig" record without signature
+(type 0) only marks where the signed records start. The signed data is the
+type, ID and payload of each covered record, in order: it is read as slices
+of the encoded message, without copying.
+*/
+
+#include "record.h"
+
+namespace ndef
+{
+
+enum SignatureType : std::uint8_t
+{
+    NoSignature     = 0x00,     // Marker.
+    RsaPss1024      = 0x01,
+    RsaPkcs1_1024   = 0x02,
+    Dsa1024         = 0x03,
+    EcdsaP192       = 0x04,
+    RsaPss2048      = 0x05,
+    RsaPkcs1_2048   = 0x06,
+    Dsa2048         = 0x07,
+    EcdsaP224       = 0x08,
+    EcdsaK233       = 0x09,
+    EcdsaB233       = 0x0A,
+    EcdsaP256       = 0x0B
+};
+
+enum SignatureHashType : std::uint8_t
+{
+    Sha256Hash = 0x02
+};
+
+enum CertificateFormat : std::uint8_t
+{
+    X509Certificate = 0,
+    M2MCertificate  = 1
+};
+
+constexpr std::uint8_t signatureVersion = 0x20;
+
+struct SignatureView
+{
+    bool valid = false;
+    std::uint8_t version = 0;
+    std::uint8_t type = NoSignature;
+    std::uint8_t hashType = 0;
+    bool signatureIsUri = false;
+    Bytes signature;            // The signature, or its URI.
+    std::uint8_t certificateFormat = X509Certificate;
+    std::uint8_t certificateCount = 0;
+    Bytes certificateChain;     // The whole chain field, e.g. as a cache key.
+    Bytes certificateUri;
+
+    constexpr bool isMarker() const noexcept { return type == NoSignature; }
+
+    // The index-th certificate of the chain, empty if there is none.
+    constexpr Bytes certificate(std::size_t index) const noexcept
+    {
+        std::size_t offset = 1;
+        for (std::size_t i = 0; i < certificateCount && certificateChain.available(offset) >= 2; i++)
+        {
+            const std::size_t length = readUInt16(certificateChain.data() + offset);
+            if (i == index)
+                return certificateChain.mid(offset + 2, length);
+            offset += 2 + length;
+        }
+        return Bytes();
+    }
+};
+
+constexpr SignatureView decodeSignature(Bytes payload) noexcept
+{
+    SignatureView signature;
+    if (payload.size() < 5)
+        return signature;
+
+    // 1) Version and signature field.
+    signature.version = payload[0];
+    signature.signatureIsUri = payload[1] & 0x80;
+    signature.type = payload[1] & 0x7F;
+    signature.hashType = payload[2];
+    std::size_t length = readUInt16(payload.data() + 3);
+    signature.signature = payload.mid(5, length);
+    std::size_t offset = 5 + length;
+    if (signature.signature.size() != length || offset >= payload.size())
+        return signature;
+
+    // 2) Certificate chain field.
+    const std::uint8_t chain = payload[offset];
+    signature.certificateFormat = (chain >> 4) & 0x07;
+    signature.certificateCount = chain & 0x0F;
+    const std::size_t chain_offset = offset++;
+    for (std::size_t i = 0; i < signature.certificateCount; i++)
+    {
+        if (payload.available(offset) < 2)
+            return signature;
+        length = readUInt16(payload.data() + offset);
+        offset += 2 + length;
+        if (offset > payload.size())
+            return signature;
+    }
+    if (chain & 0x80)
+    {
+        if (payload.available(offset) < 2)
+            return signature;
+        length = readUInt16(payload.data() + offset);
+        signature.certificateUri = payload.mid(offset + 2, length);
+        offset += 2 + length;
+        if (offset > payload.size())
+            return signature;
+    }
+    signature.certificateChain = payload.mid(chain_offset, offset - chain_offset);
+    signature.valid = true;
+    return signature;
+}
+
+// Length of a "Sig" payload holding a signature and certificates of the given lengths.
+constexpr std::size_t signaturePayloadLength(std::size_t signatureLength, const std::size_t* certificateLengths,
+                                             std::size_t certificateCount) noexcept
+{
+    std::size_t length = 1 + 1 + 1 + 2 + signatureLength + 1;
+    for (std::size_t i = 0; i < certificateCount; i++)
+        length += 2 + certificateLengths[i];
+    return length;
+}
+
+// A "Sig" record and the records it covers.
+struct SignedBlock
+{
+    RecordView record;
+    SignatureView signature;
+    std::size_t index = 0;          // Of the "Sig" record in the message.
+    std::size_t firstRecord = 0;    // Covered records.
+    std::size_t recordCount = 0;
+    std::size_t begin = 0;          // Bytes of the covered records.
+    std::size_t end = 0;
+};
+
+constexpr bool isSignatureRecord(const RecordView& record) noexcept
+{
+    return record.header.tnf == WellKnown && record.type.size() == 3
+        && record.type[0] == 'S' && record.type[1] == 'i' && record.type[2] == 'g';
+}
+
+/* Calls f(const SignedBlock&) for each "Sig" record of message, markers
+included, and returns how many there are.
+*/
+template <typename F>
+constexpr std::size_t forEachSignature(Bytes message, F&& f)
+{
+    std::size_t count = 0;
+    std::size_t index = 0;
+    std::size_t first = 0;
+    std::size_t begin = 0;
+    for (const RecordView& record : RecordRange(message))
+    {
+        if (isSignatureRecord(record))
+        {
+            SignedBlock block;
+            block.record = record;
+            block.signature = decodeSignature(record.payload);
+            block.index = index;
+            block.firstRecord = first;
+            block.recordCount = index - first;
+            block.begin = begin;
+            block.end = record.offset;
+            f(static_cast<const SignedBlock&>(block));
+            count++;
+
+            first = index + 1;
+            begin = record.offset + record.size();
+        }
+        index++;
+    }
+    return count;
+}
+
+// Calls f(Bytes) for each slice of the data signed by block: type, ID and payload of each record.
+template <typename F>
+constexpr void forEachSignedSlice(Bytes message, const SignedBlock& block, F&& f)
+{
+    for (const RecordView& record : RecordRange(message.mid(block.begin, block.end - block.begin)))
+    {
+        f(record.type);
+        f(record.id);
+        f(record.payload);
+    }
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_SIGNATURE_H
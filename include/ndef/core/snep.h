@@ -0,0 +1,164 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_SNEP_H
+#define NDEF_CORE_SNEP_H
+
+/* Simple NDEF Exchange Protocol (NFC Forum SNEP 1.0), which carries NDEF
+messages over an LLCP data link connection. A request or response is
+
+    version         1 byte (major 1, minor 0: 0x10)
+    code            1 byte
+    length          4 bytes, big-endian: of the information field
+    information     for Get, an acceptable length (4 bytes) then the message;
+                    for Put and for the Success response to Get, the message
+
+cut into fragments of at most the link's MIU (Maximum Information Unit).
+The first fragment carries the header; when more follow, the sender waits
+for a Continue from its peer and then sends them all without waiting.
+
+SnepFragmenter hands out the fragments as views: the header it keeps, and
+slices of the caller's message, which is never copied.
+*/
+
+#include "bytes.h"
+
+namespace ndef
+{
+
+enum SnepCode : std::uint8_t
+{
+    // Requests.
+    SnepContinue            = 0x00,
+    SnepGet                 = 0x01,
+    SnepPut                 = 0x02,
+    SnepReject              = 0x7F,
+
+    // Responses.
+    SnepResponseContinue    = 0x80,
+    SnepSuccess             = 0x81,
+    SnepNotFound            = 0xC0,
+    SnepExcessData          = 0xC1,
+    SnepBadRequest          = 0xC2,
+    SnepNotImplemented      = 0xE0,
+    SnepUnsupportedVersion  = 0xE1,
+    SnepResponseReject      = 0xFF
+};
+
+constexpr std::uint8_t snepVersion = 0x10;
+constexpr std::size_t snepHeaderLength = 6;
+constexpr std::size_t snepMaxHeadLength = snepHeaderLength + 4;    // With a Get acceptable length.
+
+struct SnepHeader
+{
+    std::uint8_t version = 0;
+    std::uint8_t code = 0;
+    std::uint32_t length = 0;
+
+    // Same major version: minor versions are compatible.
+    constexpr bool isSupported() const noexcept { return (version >> 4) == (snepVersion >> 4); }
+};
+
+constexpr std::size_t encodeSnepHeader(std::uint8_t* out, std::uint8_t code, std::uint32_t length) noexcept
+{
+    out[0] = snepVersion;
+    out[1] = code;
+    writeUInt32(out + 2, length);
+    return snepHeaderLength;
+}
+
+// Returns false if data is shorter than a header.
+constexpr bool decodeSnepHeader(Bytes data, SnepHeader& header) noexcept
+{
+    header = SnepHeader();
+    if (data.size() < snepHeaderLength)
+        return false;
+    header.version = data[0];
+    header.code = data[1];
+    header.length = readUInt32(data.data() + 2);
+    return true;
+}
+
+// A fragment: head then body, sent as one PDU. head is empty but for the first.
+struct SnepFragment
+{
+    Bytes head;
+    Bytes body;
+
+    constexpr std::size_t size() const noexcept { return head.size() + body.size(); }
+};
+
+class SnepFragmenter
+{
+    std::uint8_t m_head[snepMaxHeadLength];
+    std::size_t m_headLength;
+    Bytes m_message;
+    std::size_t m_miu;
+    std::size_t m_sent;         // Bytes of the message sent so far.
+    bool m_started;
+
+public:
+    /* A request or response carrying message. A Get request has the
+    acceptable length of the response before the message. The MIU is
+    raised to what the header needs, as LLCP guarantees 128 bytes anyway.
+    */
+    constexpr SnepFragmenter(std::uint8_t code, Bytes message, std::size_t miu, std::uint32_t acceptable_length = 0) noexcept
+        :   m_head(),
+            m_headLength(0),
+            m_message(message),
+            m_miu(miu < snepMaxHeadLength + 1 ? snepMaxHeadLength + 1 : miu),
+            m_sent(0),
+            m_started(false)
+    {
+        const bool get = (code == SnepGet);
+        m_headLength = encodeSnepHeader(m_head, code, std::uint32_t(message.size() + (get ? 4 : 0)));
+        if (get)
+        {
+            writeUInt32(m_head + m_headLength, acceptable_length);
+            m_headLength += 4;
+        }
+    }
+
+    // Hands out the next fragment; false once all were.
+    constexpr bool next(SnepFragment& fragment) noexcept
+    {
+        if (m_started && m_sent >= m_message.size())
+            return false;
+
+        fragment.head = m_started ? Bytes() : Bytes(m_head, m_headLength);
+        const std::size_t room = m_miu - fragment.head.size();
+        fragment.body = m_message.mid(m_sent, room);
+        m_sent += fragment.body.size();
+        m_started = true;
+        return true;
+    }
+
+    // Whether the peer must answer Continue before the other fragments go.
+    constexpr bool needsContinue() const noexcept { return m_started && m_sent < m_message.size(); }
+
+    constexpr std::size_t fragmentCount() const noexcept
+    {
+        const std::size_t first = m_miu - m_headLength;
+        if (m_message.size() <= first)
+            return 1;
+        return 1 + (m_message.size() - first + m_miu - 1) / m_miu;
+    }
+};
+
+} // namespace ndef
+
+#endif // NDEF_CORE_SNEP_H
@@ -0,0 +1,217 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_STATIC_MESSAGE_H
+#define NDEF_CORE_STATIC_MESSAGE_H
+
+/* Messages encoded by the compiler, for tags whose content never changes:
+
+    using Lobby = ndef::StaticMessage<
+        ndef::UriRecord<"https://example.com/lobby">,
+        ndef::TextRecord<"en", "Lobby">>;
+
+    tag.write(Lobby::bytes.data(), Lobby::bytes.size());
+
+Lobby::bytes is a constexpr std::array holding the encoded message, with the
+URI identifier code, the flags and all the lengths worked out at compile
+time, so it can live in read-only memory. StaticTagMessage<Capacity, ...>
+does the same and fails to compile if the message needs more than Capacity
+bytes.
+
+Strings are template arguments, which needs C++20 (the rest of the core only
+needs C++17). Payloads are the bytes of the literals: text is UTF-8 as long
+as the source is, and binary payloads can be written with "\x.." escapes.
+*/
+
+#if __cplusplus < 202002L
+#error "ndef/core/static_message.h needs C++20"
+#endif
+
+#include "record.h"
+#include "text.h"
+#include "uri.h"
+#include <array>
+
+namespace ndef
+{
+
+// A string literal usable as a template argument (without its final NUL).
+template <std::size_t N>
+struct FixedString
+{
+    char value[N] = {};
+
+    constexpr FixedString(const char (&text)[N]) noexcept
+    {
+        for (std::size_t i = 0; i < N; i++)
+            value[i] = text[i];
+    }
+
+    constexpr std::size_t size() const noexcept { return N - 1; }
+    constexpr std::string_view view() const noexcept { return std::string_view(value, N - 1); }
+};
+
+constexpr std::uint8_t* copyChars(std::uint8_t* out, std::string_view text) noexcept
+{
+    for (std::size_t i = 0; i < text.size(); i++)
+        out[i] = std::uint8_t(text[i]);
+    return out + text.size();
+}
+
+/* Records. Each one gives its TNF, its type, the length of its payload and
+writes the payload; StaticMessage does the rest.
+*/
+
+template <FixedString Uri>
+struct UriRecord
+{
+    static constexpr TypeNameFormat tnf = WellKnown;
+    static constexpr std::string_view type = "U";
+    static constexpr std::uint8_t code = uriPrefixCode(Uri.view());
+    static constexpr std::string_view rest = Uri.view().substr(uriPrefix(code).size());
+    static constexpr std::size_t payloadLength = 1 + rest.size();
+
+    static constexpr void writePayload(std::uint8_t* out) noexcept
+    {
+        out[0] = code;
+        copyChars(out + 1, rest);
+    }
+};
+
+template <FixedString Locale, FixedString Text>
+struct TextRecord
+{
+    static_assert(Locale.size() <= TextLocaleLengthMask, "Text record locale too long");
+
+    static constexpr TypeNameFormat tnf = WellKnown;
+    static constexpr std::string_view type = "T";
+    static constexpr std::size_t payloadLength = 1 + Locale.size() + Text.size();
+
+    static constexpr void writePayload(std::uint8_t* out) noexcept
+    {
+        out[0] = textStatusByte(false, Locale.size());
+        copyChars(copyChars(out + 1, Locale.view()), Text.view());
+    }
+};
+
+template <FixedString MimeType, FixedString Payload>
+struct MimeRecord
+{
+    static constexpr TypeNameFormat tnf = Media;
+    static constexpr std::string_view type = MimeType.view();
+    static constexpr std::size_t payloadLength = Payload.size();
+
+    static constexpr void writePayload(std::uint8_t* out) noexcept
+    {
+        copyChars(out, Payload.view());
+    }
+};
+
+template <FixedString Type, FixedString Payload>
+struct ExternalRecord
+{
+    static constexpr TypeNameFormat tnf = External;
+    static constexpr std::string_view type = Type.view();
+    static constexpr std::size_t payloadLength = Payload.size();
+
+    static constexpr void writePayload(std::uint8_t* out) noexcept
+    {
+        copyChars(out, Payload.view());
+    }
+};
+
+template <typename... Records>
+struct StaticMessage;
+
+// A Smart Poster: its payload is the message made of Records.
+template <typename... Records>
+struct SmartPosterRecord
+{
+    static constexpr TypeNameFormat tnf = WellKnown;
+    static constexpr std::string_view type = "Sp";
+    static constexpr std::size_t payloadLength = StaticMessage<Records...>::size;
+
+    static constexpr void writePayload(std::uint8_t* out) noexcept
+    {
+        for (std::size_t i = 0; i < payloadLength; i++)
+            out[i] = StaticMessage<Records...>::bytes[i];
+    }
+};
+
+template <typename... Records>
+struct StaticMessage
+{
+    static_assert(sizeof...(Records) > 0, "A NDEF message holds at least one record");
+
+private:
+    template <typename Record>
+    static constexpr std::uint8_t flags(bool first, bool last) noexcept
+    {
+        static_assert(Record::type.size() <= 0xFF, "Record type too long");
+        static_assert(Record::payloadLength <= 0xFFFFFFFFu, "Record payload too long");
+        return recordFlags((first ? MessageBegin : 0) | (last ? MessageEnd : 0), 0, Record::payloadLength);
+    }
+
+    // Flags only change the size through SR, which depends on the payload.
+    template <typename Record>
+    static constexpr std::size_t recordSize() noexcept
+    {
+        return encodedRecordLength(flags<Record>(false, false), Record::type.size(), 0, Record::payloadLength);
+    }
+
+    template <typename Record>
+    static constexpr std::size_t writeRecord(std::uint8_t* out, bool first, bool last) noexcept
+    {
+        std::uint8_t* position = out + encodeHeader(out, flags<Record>(first, last), Record::tnf,
+                                                    std::uint8_t(Record::type.size()),
+                                                    std::uint32_t(Record::payloadLength), 0);
+        position = copyChars(position, Record::type);
+        Record::writePayload(position);
+        return std::size_t(position - out) + Record::payloadLength;
+    }
+
+public:
+    static constexpr std::size_t count = sizeof...(Records);
+    static constexpr std::size_t size = (recordSize<Records>() + ...);
+
+    static constexpr std::array<std::uint8_t, size> encode() noexcept
+    {
+        std::array<std::uint8_t, size> out = {};
+        std::size_t offset = 0;
+        std::size_t index = 0;
+        ([&]
+        {
+            bool first = (index == 0);
+            bool last = (++index == count);
+            offset += writeRecord<Records>(out.data() + offset, first, last);
+        }(), ...);
+        return out;
+    }
+
+    static constexpr std::array<std::uint8_t, size> bytes = encode();
+};
+
+// A StaticMessage that must fit in Capacity bytes, e.g. the NDEF area of a tag.
+template <std::size_t Capacity, typename... Records>
+struct StaticTagMessage : StaticMessage<Records...>
+{
+    static_assert(StaticMessage<Records...>::size <= Capacity, "NDEF message does not fit the tag capacity");
+};
+
+} // namespace ndef
+
+#endif // NDEF_CORE_STATIC_MESSAGE_H
@@ -0,0 +1,62 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_TEXT_H
+#define NDEF_CORE_TEXT_H
+
+#include "bytes.h"
+
+namespace ndef
+{
+
+/* Text record payloads start with a status byte: bit 7 set for UTF-16
+(big-endian unless there is a BOM), the low bits for the length of the
+language code that follows. The text comes last and is not converted here.
+*/
+enum TextStatus : std::uint8_t
+{
+    TextUtf16           = 0x80,
+    TextLocaleLengthMask = 0x1F
+};
+
+constexpr std::uint8_t textStatusByte(bool utf16, std::size_t localeLength) noexcept
+{
+    return std::uint8_t((utf16 ? TextUtf16 : 0) | (localeLength & TextLocaleLengthMask));
+}
+
+struct TextView
+{
+    bool utf16 = false;
+    Bytes locale;
+    Bytes text;
+};
+
+constexpr TextView decodeText(Bytes payload) noexcept
+{
+    TextView text;
+    if (payload.empty())
+        return text;
+    std::size_t locale_length = payload[0] & TextLocaleLengthMask;
+    text.utf16 = payload[0] & TextUtf16;
+    text.locale = payload.mid(1, locale_length);
+    text.text = payload.mid(1 + locale_length);
+    return text;
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_TEXT_H
@@ -0,0 +1,171 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_TLV_H
+#define NDEF_CORE_TLV_H
+
+#include "bytes.h"
+
+namespace ndef
+{
+
+enum TlvType : std::uint8_t
+{
+    NullTlv         = 0x00,
+    LockControlTlv  = 0x01,
+    MemoryControlTlv = 0x02,
+    MessageTlv      = 0x03,
+    ProprietaryTlv  = 0xFD,
+    TerminatorTlv   = 0xFE
+};
+
+/* A TLV block of a tag memory dump. Null and Terminator blocks are a single
+byte; the others have a length on one byte, or 0xFF and two bytes.
+*/
+struct TlvView
+{
+    std::uint8_t type = NullTlv;
+    std::size_t offset = 0;
+    Bytes value;
+};
+
+/* The TLV blocks of a dump, for range-based for loops. Null blocks are
+returned too. Iteration stops after a Terminator block, or on a block whose
+length or value goes past the end of the dump.
+*/
+class TlvRange
+{
+    Bytes m_data;
+    std::size_t m_offset;
+
+public:
+    class Iterator
+    {
+        Bytes m_data;
+        TlvView m_tlv;
+        std::size_t m_next;
+        bool m_end;
+
+        constexpr void load(std::size_t offset) noexcept
+        {
+            m_end = true;
+            std::size_t available = m_data.available(offset);
+            if (available == 0)
+                return;
+
+            m_tlv = TlvView();
+            m_tlv.type = m_data[offset];
+            m_tlv.offset = offset;
+            m_next = offset + 1;
+            if (m_tlv.type != NullTlv && m_tlv.type != TerminatorTlv)
+            {
+                if (available < 2)
+                    return;
+                std::size_t length = m_data[offset + 1];
+                m_next = offset + 2;
+                if (length == 0xFF)
+                {
+                    if (available < 4)
+                        return;
+                    length = readUInt16(m_data.data() + offset + 2);
+                    m_next = offset + 4;
+                }
+                if (m_data.available(m_next) < length)
+                    return;
+                m_tlv.value = m_data.mid(m_next, length);
+                m_next += length;
+            }
+            m_end = false;
+        }
+
+    public:
+        constexpr Iterator() noexcept
+            :   m_next(0),
+                m_end(true)
+        {
+        }
+
+        constexpr Iterator(Bytes data, std::size_t offset) noexcept
+            :   m_data(data),
+                m_next(0),
+                m_end(true)
+        {
+            load(offset);
+        }
+
+        constexpr const TlvView& operator*() const noexcept { return m_tlv; }
+        constexpr const TlvView* operator->() const noexcept { return &m_tlv; }
+
+        constexpr Iterator& operator++() noexcept
+        {
+            if (m_tlv.type == TerminatorTlv)
+                m_end = true;
+            else
+                load(m_next);
+            return *this;
+        }
+
+        constexpr bool operator==(const Iterator& other) const noexcept
+        {
+            if (m_end || other.m_end)
+                return m_end == other.m_end;
+            return m_tlv.offset == other.m_tlv.offset;
+        }
+
+        constexpr bool operator!=(const Iterator& other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    constexpr explicit TlvRange(Bytes data, std::size_t offset = 0) noexcept
+        :   m_data(data),
+            m_offset(offset)
+    {
+    }
+
+    constexpr Iterator begin() const noexcept { return Iterator(m_data, m_offset); }
+    constexpr Iterator end() const noexcept { return Iterator(); }
+};
+
+// Size of the type and length fields of a block with a value of length bytes.
+constexpr std::size_t tlvHeaderLength(std::uint8_t type, std::size_t length) noexcept
+{
+    if (type == NullTlv || type == TerminatorTlv)
+        return 1;
+    return (length <= 0xFE) ? 2 : 4;
+}
+
+// Writes the type and length fields of a block and returns their size.
+constexpr std::size_t encodeTlvHeader(std::uint8_t* out, std::uint8_t type, std::uint16_t length) noexcept
+{
+    out[0] = type;
+    if (type == NullTlv || type == TerminatorTlv)
+        return 1;
+    if (length <= 0xFE)
+    {
+        out[1] = std::uint8_t(length);
+        return 2;
+    }
+    out[1] = 0xFF;
+    writeUInt16(out + 2, length);
+    return 4;
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_TLV_H
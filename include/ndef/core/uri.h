@@ -0,0 +1,110 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_URI_H
+#define NDEF_CORE_URI_H
+
+#include "bytes.h"
+
+namespace ndef
+{
+
+// URI identifier codes of the NFC Forum URI RTD: code n abbreviates
+// uriPrefixes[n - 1], code 0 means no abbreviation.
+constexpr std::string_view uriPrefixes[] = {
+    "http://www.",
+    "https://www.",
+    "http://",
+    "https://",
+    "tel:",
+    "mailto:",
+    "ftp://anonymous:anonymous@",
+    "ftp://ftp.",
+    "ftps://",
+    "sftp://",
+    "smb://",
+    "nfs://",
+    "ftp://",
+    "dav://",
+    "news:",
+    "telnet://",
+    "imap:",
+    "rtsp://",
+    "urn:",
+    "pop:",
+    "sip:",
+    "sips:",
+    "tftp:",
+    "btspp://",
+    "btl2cap://",
+    "btgoep://",
+    "tcpobex://",
+    "irdaobex://",
+    "file://",
+    "urn:epc:id:",
+    "urn:epc:tag:",
+    "urn:epc:pat:",
+    "urn:epc:raw:",
+    "urn:epc:",
+    "urn:nfc:"
+};
+
+constexpr std::size_t uriPrefixCount = sizeof(uriPrefixes) / sizeof(uriPrefixes[0]);
+
+// The prefix a code stands for, empty for 0 and unknown codes.
+constexpr std::string_view uriPrefix(std::uint8_t code) noexcept
+{
+    return (code > 0 && code <= uriPrefixCount) ? uriPrefixes[code - 1] : std::string_view();
+}
+
+// The code of the longest prefix uri starts with, 0 if none.
+constexpr std::uint8_t uriPrefixCode(std::string_view uri) noexcept
+{
+    std::uint8_t code = 0;
+    std::size_t length = 0;
+    for (std::size_t i = 0; i < uriPrefixCount; i++)
+    {
+        const std::string_view prefix = uriPrefixes[i];
+        if (prefix.size() > length && uri.substr(0, prefix.size()) == prefix)
+        {
+            code = std::uint8_t(i + 1);
+            length = prefix.size();
+        }
+    }
+    return code;
+}
+
+// A URI record payload: identifier code and the rest of the URI.
+struct UriView
+{
+    std::string_view prefix;
+    Bytes rest;
+};
+
+constexpr UriView decodeUri(Bytes payload) noexcept
+{
+    UriView uri;
+    if (payload.empty())
+        return uri;
+    uri.prefix = uriPrefix(payload[0]);
+    uri.rest = payload.mid(1);
+    return uri;
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_URI_H
@@ -0,0 +1,356 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEF_CORE_VISIT_H
+#define NDEF_CORE_VISIT_H
+
+/* Typed dispatch over the records of a message:
+
+    ndef::visit(message, ndef::Overloaded {
+        [](const ndef::UriRecordView& uri) { ... },
+        [](const ndef::TextRecordView& text) { ... },
+        [](const ndef::SmartPosterRecordView& sp) { sp.visit(...); },
+        [](const ndef::RecordView& record) { ... }   // Everything else.
+    });
+
+Each record is classified once, from its TNF and a type code packing the
+length and first bytes of its type, by a switch; the matching handler is then
+called with the fields already decoded. Records without a handler of their
+own go to the RecordView handler if there is one, and are skipped otherwise.
+
+Local types ("act", "s", "t" in Smart Posters, "t", "a", "d" in Generic
+Controls) are only recognised inside their parent, which is why the nested
+visit() of SmartPosterRecordView and GenericControlRecordView must be used
+for their content.
+*/
+
+#include "record.h"
+#include "text.h"
+#include "uri.h"
+#include <type_traits>
+#include <utility>
+
+namespace ndef
+{
+
+// Combines lambdas into a single visitor.
+template <typename... Handlers>
+struct Overloaded : Handlers...
+{
+    using Handlers::operator()...;
+};
+
+template <typename... Handlers>
+Overloaded(Handlers...) -> Overloaded<Handlers...>;
+
+enum class RecordKind : std::uint8_t
+{
+    Other,
+    Empty,
+    Text,
+    Uri,
+    SmartPoster,
+    GenericControl,
+    SpAction,
+    SpSize,
+    SpType,
+    GcTarget,
+    GcAction,
+    GcData,
+    Mime,
+    AbsoluteUri,
+    External,
+    Unknown,
+    Unchanged
+};
+
+// Where a record is found, for the local types.
+enum class RecordContext : std::uint8_t
+{
+    Message,
+    SmartPoster,
+    GenericControl
+};
+
+/* Packs a type of up to three bytes with its length, so that well-known
+types can be told apart with a switch. Longer types get 0.
+*/
+constexpr std::uint32_t typeCode(Bytes type) noexcept
+{
+    if (type.size() > 3)
+        return 0;
+    std::uint32_t code = std::uint32_t(type.size()) << 24;
+    for (std::size_t i = 0; i < type.size(); i++)
+        code |= std::uint32_t(type[i]) << (16 - 8 * i);
+    return code;
+}
+
+constexpr std::uint32_t typeCode(std::string_view type) noexcept
+{
+    std::uint32_t code = std::uint32_t(type.size()) << 24;
+    for (std::size_t i = 0; i < type.size() && i < 3; i++)
+        code |= std::uint32_t(std::uint8_t(type[i])) << (16 - 8 * i);
+    return code;
+}
+
+constexpr RecordKind classify(TypeNameFormat tnf, Bytes type, RecordContext context = RecordContext::Message) noexcept
+{
+    switch (tnf)
+    {
+        case ndef::Empty:       return RecordKind::Empty;
+        case ndef::Media:       return RecordKind::Mime;
+        case ndef::AbsoluteUri: return RecordKind::AbsoluteUri;
+        case ndef::External:    return RecordKind::External;
+        case ndef::Unknown:     return RecordKind::Unknown;
+        case ndef::Unchanged:   return RecordKind::Unchanged;
+        case ndef::Reserved:    return RecordKind::Other;
+        case ndef::WellKnown:   break;
+    }
+
+    bool sp = (context == RecordContext::SmartPoster);
+    bool gc = (context == RecordContext::GenericControl);
+    switch (typeCode(type))
+    {
+        case typeCode("T"):     return RecordKind::Text;
+        case typeCode("U"):     return RecordKind::Uri;
+        case typeCode("Sp"):    return RecordKind::SmartPoster;
+        case typeCode("Gc"):    return RecordKind::GenericControl;
+        case typeCode("act"):   return sp ? RecordKind::SpAction : RecordKind::Other;
+        case typeCode("s"):     return sp ? RecordKind::SpSize : RecordKind::Other;
+        case typeCode("t"):     return sp ? RecordKind::SpType : (gc ? RecordKind::GcTarget : RecordKind::Other);
+        case typeCode("a"):     return gc ? RecordKind::GcAction : RecordKind::Other;
+        case typeCode("d"):     return gc ? RecordKind::GcData : RecordKind::Other;
+    }
+    return RecordKind::Other;
+}
+
+template <typename Visitor>
+constexpr void visit(Bytes message, RecordContext context, Visitor&& visitor);
+
+// Typed views. They point into the visited buffer, like RecordView.
+
+struct TextRecordView
+{
+    RecordView record;
+    bool utf16;
+    Bytes locale;
+    Bytes text;     // UTF-8, or UTF-16 if utf16 is set.
+};
+
+struct UriRecordView
+{
+    RecordView record;
+    std::string_view prefix;
+    Bytes rest;
+};
+
+struct MimeRecordView
+{
+    RecordView record;
+    Bytes mimeType;
+    Bytes payload;
+};
+
+struct AbsoluteUriRecordView
+{
+    RecordView record;
+    Bytes uri;
+    Bytes payload;
+};
+
+struct ExternalRecordView
+{
+    RecordView record;
+    Bytes type;     // "domain:type"
+    Bytes payload;
+};
+
+struct SmartPosterRecordView
+{
+    RecordView record;
+
+    // Visits the records of the poster, local types included.
+    template <typename Visitor>
+    constexpr void visit(Visitor&& visitor) const
+    {
+        ndef::visit(record.payload, RecordContext::SmartPoster, std::forward<Visitor>(visitor));
+    }
+};
+
+struct SpActionRecordView
+{
+    RecordView record;
+    std::uint8_t action;    // 0 do, 1 save, 2 open.
+};
+
+struct SpSizeRecordView
+{
+    RecordView record;
+    std::uint32_t size;
+};
+
+struct SpTypeRecordView
+{
+    RecordView record;
+    Bytes mimeType;
+};
+
+struct GenericControlRecordView
+{
+    RecordView record;
+    std::uint8_t config;
+    Bytes records;          // Target, action and data records.
+
+    template <typename Visitor>
+    constexpr void visit(Visitor&& visitor) const
+    {
+        ndef::visit(records, RecordContext::GenericControl, std::forward<Visitor>(visitor));
+    }
+};
+
+// Target, action and data records wrap a record (a message for data).
+struct GcTargetRecordView
+{
+    RecordView record;
+
+    template <typename Visitor>
+    constexpr void visit(Visitor&& visitor) const
+    {
+        ndef::visit(record.payload, RecordContext::Message, std::forward<Visitor>(visitor));
+    }
+};
+
+struct GcActionRecordView
+{
+    RecordView record;
+    bool hasAction;         // Action flag set: the action is a byte...
+    std::uint8_t action;
+    Bytes records;          // ...otherwise a record.
+
+    template <typename Visitor>
+    constexpr void visit(Visitor&& visitor) const
+    {
+        ndef::visit(records, RecordContext::Message, std::forward<Visitor>(visitor));
+    }
+};
+
+struct GcDataRecordView
+{
+    RecordView record;
+
+    template <typename Visitor>
+    constexpr void visit(Visitor&& visitor) const
+    {
+        ndef::visit(record.payload, RecordContext::Message, std::forward<Visitor>(visitor));
+    }
+};
+
+namespace detail
+{
+    // Calls the typed handler, or the RecordView one, or nothing.
+    template <typename Visitor, typename View>
+    constexpr void dispatch(Visitor& visitor, const View& view)
+    {
+        if constexpr (std::is_invocable_v<Visitor&, const View&>)
+            visitor(view);
+        else if constexpr (std::is_invocable_v<Visitor&, const RecordView&>)
+            visitor(view.record);
+    }
+}
+
+// Classifies a single record and calls the matching handler.
+template <typename Visitor>
+constexpr void visitRecord(const RecordView& record, RecordContext context, Visitor&& visitor)
+{
+    const Bytes& payload = record.payload;
+    switch (classify(record.header.tnf, record.type, context))
+    {
+        case RecordKind::Text:
+        {
+            const TextView text = decodeText(payload);
+            detail::dispatch(visitor, TextRecordView { record, text.utf16, text.locale, text.text });
+            return;
+        }
+        case RecordKind::Uri:
+        {
+            const UriView uri = decodeUri(payload);
+            detail::dispatch(visitor, UriRecordView { record, uri.prefix, uri.rest });
+            return;
+        }
+        case RecordKind::SmartPoster:
+            detail::dispatch(visitor, SmartPosterRecordView { record });
+            return;
+        case RecordKind::GenericControl:
+            detail::dispatch(visitor, GenericControlRecordView {
+                record, std::uint8_t(payload.empty() ? 0 : payload[0]), payload.mid(1) });
+            return;
+        case RecordKind::SpAction:
+            detail::dispatch(visitor, SpActionRecordView { record, std::uint8_t(payload.empty() ? 0 : payload[0]) });
+            return;
+        case RecordKind::SpSize:
+            detail::dispatch(visitor, SpSizeRecordView { record, payload.size() >= 4 ? readUInt32(payload.data()) : 0 });
+            return;
+        case RecordKind::SpType:
+            detail::dispatch(visitor, SpTypeRecordView { record, payload });
+            return;
+        case RecordKind::GcTarget:
+            detail::dispatch(visitor, GcTargetRecordView { record });
+            return;
+        case RecordKind::GcAction:
+        {
+            bool has_action = !payload.empty() && (payload[0] & 0x01);
+            detail::dispatch(visitor, GcActionRecordView {
+                record, has_action, std::uint8_t((has_action && payload.size() > 1) ? payload[1] : 0),
+                has_action ? Bytes() : payload.mid(1) });
+            return;
+        }
+        case RecordKind::GcData:
+            detail::dispatch(visitor, GcDataRecordView { record });
+            return;
+        case RecordKind::Mime:
+            detail::dispatch(visitor, MimeRecordView { record, record.type, payload });
+            return;
+        case RecordKind::AbsoluteUri:
+            detail::dispatch(visitor, AbsoluteUriRecordView { record, record.type, payload });
+            return;
+        case RecordKind::External:
+            detail::dispatch(visitor, ExternalRecordView { record, record.type, payload });
+            return;
+        default:
+            if constexpr (std::is_invocable_v<Visitor&, const RecordView&>)
+                visitor(record);
+            return;
+    }
+}
+
+// Visits the records of message, as iterated by RecordRange.
+template <typename Visitor>
+constexpr void visit(Bytes message, RecordContext context, Visitor&& visitor)
+{
+    for (const RecordView& record : RecordRange(message))
+        visitRecord(record, context, visitor);
+}
+
+template <typename Visitor>
+constexpr void visit(Bytes message, Visitor&& visitor)
+{
+    visit(message, RecordContext::Message, std::forward<Visitor>(visitor));
+}
+
+} // namespace ndef
+
+#endif // NDEF_CORE_VISIT_H
@@ -28,4 +28,11 @@
 #  define LIBNDEFSHARED_EXPORT Q_DECL_IMPORT
 #endif
 
+// What qHash() returns with this Qt version.
+#if (QT_VERSION >= QT_VERSION_CHECK(6, 0, 0))
+typedef size_t NDEFHashValue;
+#else
+typedef uint NDEFHashValue;
+#endif
+
 #endif // LIBNDEF_GLOBAL_H
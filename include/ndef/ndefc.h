@@ -0,0 +1,185 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFC_H
+#define NDEFC_H
+
+/* C API of libndef (libndefc, pkg-config "libndefc").
+
+Decoding works in place on a buffer owned by the caller, e.g. the one
+libnfc filled: records, TLV blocks and Text/URI fields are returned as
+pointers into it and nothing is allocated. Encoding writes into a buffer
+given by the caller. Functions return NDEF_OK (0) or a negative
+ndef_status; ndef_strerror() describes a status.
+
+    ndef_message_iter it;
+    ndef_record record;
+    size_t length;
+    int status;
+
+    ndef_message_iter_init(&it, data, size);
+    while ((status = ndef_record_next(&it, &record)) == NDEF_OK)
+        handle(ndef_record_tnf(&record), record.type, record.type_length,
+               ndef_record_payload(&record, &length), length);
+    if (status != NDEF_END)
+        fprintf(stderr, "%s\n", ndef_strerror(status));
+
+The structures below are allocated by callers, on their stack or in their
+own structures: any change to them is an ABI change, made only with a new
+major version of the library.
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(NDEFC_LIBRARY)
+#  define NDEFC_EXPORT __declspec(dllexport)
+#elif defined(_WIN32)
+#  define NDEFC_EXPORT __declspec(dllimport)
+#elif defined(__GNUC__)
+#  define NDEFC_EXPORT __attribute__((visibility("default")))
+#else
+#  define NDEFC_EXPORT
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    NDEF_OK = 0,
+    NDEF_END = 1,                       /* No more records or TLV blocks. */
+    NDEF_ERR_ARGUMENT = -1,             /* NULL pointer or invalid value. */
+    NDEF_ERR_TRUNCATED = -2,            /* The buffer ends inside a record or block. */
+    NDEF_ERR_RESERVED_TNF = -3,         /* Record with TNF 7. */
+    NDEF_ERR_BUFFER_TOO_SMALL = -4,     /* Output buffer too small, see ndef_encoded_size(). */
+    NDEF_ERR_TOO_LONG = -5,             /* Field too long for its length field. */
+    NDEF_ERR_NOT_FOUND = -6             /* No NDEF message TLV in the dump. */
+} ndef_status;
+
+/* Type name formats. */
+enum
+{
+    NDEF_TNF_EMPTY = 0,
+    NDEF_TNF_WELL_KNOWN = 1,
+    NDEF_TNF_MEDIA = 2,
+    NDEF_TNF_ABSOLUTE_URI = 3,
+    NDEF_TNF_EXTERNAL = 4,
+    NDEF_TNF_UNKNOWN = 5,
+    NDEF_TNF_UNCHANGED = 6
+};
+
+/* Record flags, as found in ndef_record.flags. */
+enum
+{
+    NDEF_FLAG_IL = 0x08,
+    NDEF_FLAG_SR = 0x10,
+    NDEF_FLAG_CF = 0x20,
+    NDEF_FLAG_ME = 0x40,
+    NDEF_FLAG_MB = 0x80
+};
+
+/* A record, pointing into the decoded buffer. */
+typedef struct
+{
+    uint8_t flags;              /* MB, ME, CF, SR and IL. */
+    uint8_t tnf;
+    size_t offset;              /* Offset of the record in the buffer. */
+    size_t length;              /* Encoded size of the record. */
+    const uint8_t* type;
+    size_t type_length;
+    const uint8_t* id;
+    size_t id_length;
+    const uint8_t* payload;
+    size_t payload_length;
+} ndef_record;
+
+/* Iteration state over the records of a message; opaque to the caller. */
+typedef struct
+{
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    int done;
+} ndef_message_iter;
+
+/* Iteration state over the TLV blocks of a tag memory dump. */
+typedef struct
+{
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+    int done;
+} ndef_tlv_iter;
+
+/* A record to encode. The caller owns the fields. */
+typedef struct
+{
+    uint8_t tnf;
+    int chunk;                  /* Non zero to set the CF flag. */
+    const uint8_t* type;
+    size_t type_length;
+    const uint8_t* id;
+    size_t id_length;
+    const uint8_t* payload;
+    size_t payload_length;
+} ndef_record_desc;
+
+NDEFC_EXPORT const char* ndef_strerror(int status);
+
+/* Decoding. ndef_record_next() returns NDEF_OK and fills record, NDEF_END
+after the record flagged ME or at the end of the buffer, or an error. After
+an error the iterator stays at the failing record. */
+NDEFC_EXPORT int ndef_message_iter_init(ndef_message_iter* it, const uint8_t* data, size_t size);
+NDEFC_EXPORT int ndef_record_next(ndef_message_iter* it, ndef_record* record);
+NDEFC_EXPORT int ndef_message_record_count(const uint8_t* data, size_t size, size_t* count);
+
+NDEFC_EXPORT uint8_t ndef_record_tnf(const ndef_record* record);
+NDEFC_EXPORT int ndef_record_is_chunk(const ndef_record* record);
+NDEFC_EXPORT int ndef_record_type_is(const ndef_record* record, uint8_t tnf, const char* type);
+NDEFC_EXPORT const uint8_t* ndef_record_type(const ndef_record* record, size_t* length);
+NDEFC_EXPORT const uint8_t* ndef_record_id(const ndef_record* record, size_t* length);
+NDEFC_EXPORT const uint8_t* ndef_record_payload(const ndef_record* record, size_t* length);
+
+/* Text ("T") and URI ("U") payloads. The text is UTF-8, or UTF-16 if
+*utf16 is set, and is not converted. */
+NDEFC_EXPORT int ndef_text_decode(const uint8_t* payload, size_t payload_length, int* utf16,
+                                  const uint8_t** locale, size_t* locale_length,
+                                  const uint8_t** text, size_t* text_length);
+NDEFC_EXPORT const char* ndef_uri_prefix(uint8_t code);
+NDEFC_EXPORT int ndef_uri_decode(const uint8_t* payload, size_t payload_length, const char** prefix,
+                                 const uint8_t** rest, size_t* rest_length);
+
+/* TLV blocks. ndef_tlv_find_message() returns the value of the first NDEF
+message TLV of a dump. */
+NDEFC_EXPORT int ndef_tlv_iter_init(ndef_tlv_iter* it, const uint8_t* data, size_t size);
+NDEFC_EXPORT int ndef_tlv_next(ndef_tlv_iter* it, uint8_t* type, const uint8_t** value, size_t* length);
+NDEFC_EXPORT int ndef_tlv_find_message(const uint8_t* data, size_t size, const uint8_t** message, size_t* length);
+
+/* Encoding. MB and ME are set on the first and last records, SR and IL
+from the lengths. ndef_encode_into() fails with NDEF_ERR_BUFFER_TOO_SMALL
+without writing anything if capacity is less than ndef_encoded_size(). */
+NDEFC_EXPORT size_t ndef_encoded_size(const ndef_record_desc* records, size_t count);
+NDEFC_EXPORT int ndef_encode_into(const ndef_record_desc* records, size_t count,
+                                  uint8_t* out, size_t capacity, size_t* written);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NDEFC_H */
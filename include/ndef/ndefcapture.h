@@ -0,0 +1,149 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFCAPTURE_H
+#define NDEFCAPTURE_H
+
+#include "ndefmessage.h"
+#include <QtCore/QFile>
+#include <QtCore/QVector>
+
+/* A capture file is an append-only sequence of raw NDEF messages, each one
+tagged with the time it was read, the reader and the tag UID. An index is
+written at the end of the file when the writer is closed, so that messages
+can be accessed at random without scanning the file.
+
+All integers are big-endian.
+
+    File header (16 bytes)
+        "NDEFCAP1"                      magic
+        quint16                         format version (1)
+        quint16                         reserved (0)
+        quint32                         messages per block
+
+    Entry (repeated)
+        quint32                         entry length (without this field)
+        quint64                         timestamp (ms since epoch, UTC)
+        quint8 + bytes                  reader ID length and reader ID
+        quint8 + bytes                  tag UID length and tag UID
+        bytes                           NDEF message (rest of the entry)
+
+    Index
+        quint64                         message count
+        quint32                         block count
+        quint64 * message count         offset of each entry
+        block summary * block count     see below
+
+    Block summary (24 bytes)
+        quint64                         first message
+        quint32                         message count
+        quint8                          TNFs used (bit n set for TNF n)
+        quint8[3]                       reserved (0)
+        quint64                         Bloom filter over (TNF, type)
+
+    Trailer (16 bytes)
+        quint64                         offset of the index
+        "NDEFIDX1"                      magic
+
+Blocks are fixed runs of consecutive messages; their summaries let a reader
+skip blocks that cannot hold a record type, and give parallel readers a
+natural unit of work. A file whose writer was not closed has no index: the
+reader then rebuilds it by walking the entries, and the writer drops the
+partial last entry before appending to it.
+
+NDEFCaptureReader maps the file and is read-only once opened, so a single
+reader can be shared by several threads. The QByteArray returned by
+message() points into the mapping and is only valid while the reader is
+open; copy it if it must outlive the reader.
+*/
+
+class LIBNDEFSHARED_EXPORT NDEFCaptureMetadata
+{
+protected:
+    quint64 m_timestamp;
+    QByteArray m_readerId;
+    QByteArray m_tagUid;
+
+public:
+    NDEFCaptureMetadata(quint64 timestamp = 0, const QByteArray& reader_id = QByteArray(), const QByteArray& tag_uid = QByteArray());
+
+    quint64 timestamp() const;
+    QByteArray readerId() const;
+    QByteArray tagUid() const;
+};
+
+class LIBNDEFSHARED_EXPORT NDEFCaptureWriter
+{
+protected:
+    QFile m_file;
+    quint32 m_blockSize;
+    QVector<quint64> m_offsets;
+    QVector<quint8> m_blockTnfs;
+    QVector<quint64> m_blockTypes;
+
+public:
+    NDEFCaptureWriter();
+    virtual ~NDEFCaptureWriter();
+
+    bool open(const QString& filename, quint32 block_size = 1024);
+    bool isOpen() const;
+    bool append(const QByteArray& message, const NDEFCaptureMetadata& metadata = NDEFCaptureMetadata());
+    bool append(const NDEFMessage& message, const NDEFCaptureMetadata& metadata = NDEFCaptureMetadata());
+    quint64 messageCount() const;
+    bool close();
+};
+
+class LIBNDEFSHARED_EXPORT NDEFCaptureReader
+{
+protected:
+    QFile m_file;
+    const uchar* m_data;
+    qint64 m_size;
+    quint32 m_blockSize;
+    QVector<quint64> m_offsets;
+    QVector<quint8> m_blockTnfs;
+    QVector<quint64> m_blockTypes;
+    qint64 m_end;
+
+    friend class NDEFCaptureWriter;
+
+public:
+    NDEFCaptureReader();
+    virtual ~NDEFCaptureReader();
+
+    bool open(const QString& filename);
+    bool isOpen() const;
+    void close();
+
+    quint32 blockSize() const;
+    quint64 messageCount() const;
+    QByteArray message(quint64 index) const;
+    NDEFCaptureMetadata metadata(quint64 index) const;
+
+    int blockCount() const;
+    quint64 blockFirstMessage(int block) const;
+    quint64 blockMessageCount(int block) const;
+    bool blockMayContain(int block, const NDEFRecordType& type) const;
+
+    static bool isCapture(const QByteArray& data);
+
+protected:
+    bool readIndex();
+    bool scanEntries();
+};
+
+#endif // NDEFCAPTURE_H
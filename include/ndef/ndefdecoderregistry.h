@@ -0,0 +1,94 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFDECODERREGISTRY_H
+#define NDEFDECODERREGISTRY_H
+
+#include "ndefrecord.h"
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+#include <functional>
+
+/* Routes records to decoders registered by (TNF, type name):
+
+    NDEFDecoderRegistry registry;
+    registry.registerDecoder(NDEFRecordType::NDEF_ExternalRTD, "android.com:pkg", decodePackage);
+    registry.registerDecoder(NDEFRecordType::NDEF_ExternalRTD, "example.com:*", decodeInHouse);
+    registry.registerDecoder(NDEFRecordType::NDEF_MIME, "application/vnd.example.*", decodeVendor);
+    registry.freeze();
+    ...
+    QVariant value = registry.decode(record, &ok);
+
+MIME and external type names are matched case-insensitively, as RFC 2046
+and the NFC Forum RTD specification require; MIME parameters (";...") are
+ignored. Well-known and absolute URI types are matched exactly.
+
+A type name ending with '*' right after a ':', '/' or '.' matches every type
+starting with what comes before the '*', e.g. all the types of a domain. The
+exact type wins, then the longest matching prefix.
+
+Decoders are registered at startup, then freeze() builds an immutable
+perfect hash table: a lookup hashes the type once, reads one displacement
+and one slot and compares one key, whatever the number of decoders. The
+frozen registry is never written again, so it can be shared by any number of
+threads without locks, provided freeze() is called before it is handed to
+them (e.g. before they are started). Lookups on a registry not frozen yet
+find nothing, and a frozen one takes no more decoders.
+*/
+
+class LIBNDEFSHARED_EXPORT NDEFDecoderRegistry
+{
+public:
+    typedef std::function<QVariant (const NDEFRecord& record)> Decoder;
+
+protected:
+    struct Entry
+    {
+        quint8 tnf;
+        bool prefix;
+        QByteArray type;    // Lower-case for MIME and external types.
+        Decoder decoder;
+        quint64 hash;
+    };
+
+    QVector<Entry> m_entries;
+    QVector<quint32> m_displacements;
+    QVector<qint32> m_slots;
+    quint8 m_prefixTnfs;    // Bit n set if TNF n has prefix entries.
+    bool m_frozen;
+
+public:
+    NDEFDecoderRegistry();
+    virtual ~NDEFDecoderRegistry();
+
+    bool registerDecoder(NDEFRecordType::NDEFRecordTypeId tnf, const QByteArray& type, const Decoder& decoder);
+    bool freeze();
+    bool isFrozen() const;
+    int count() const;
+
+    const Decoder* decoder(NDEFRecordType::NDEFRecordTypeId tnf, const QByteArray& type) const;
+    const Decoder* decoder(const NDEFRecord& record) const;
+    QVariant decode(const NDEFRecord& record, bool* ok = 0) const;
+
+protected:
+    const Entry* find(quint8 tnf, bool prefix, const char* type, int length) const;
+
+private:
+    Q_DISABLE_COPY(NDEFDecoderRegistry)
+};
+
+#endif // NDEFDECODERREGISTRY_H
@@ -25,7 +25,7 @@
 class LIBNDEFSHARED_EXPORT NDEFMessage
 {
 protected:
-    NDEFRecordList m_records;
+    NDEFRecordVector m_records;     // Contiguous, records are not polymorphic.
     
 public:
     NDEFMessage();
@@ -41,12 +41,37 @@ public:
     NDEFRecord record(const QByteArray& id) const;
     NDEFRecord record(int index = 0) const;
     NDEFRecordList record(const NDEFRecordType& type) const;
-    NDEFRecordList records() const;
+    // Copies every record into a new QList, one allocation per record: use
+    // recordVector(), recordAt() or a range-based for instead.
+    Q_DECL_DEPRECATED NDEFRecordList records() const;
     int recordCount() const;
+
+    // The records in place, without copies: valid until the message changes.
+    // begin() and end() make messages usable in range-based for loops.
+    const NDEFRecord& recordAt(int index) const;
+    const NDEFRecordVector& recordVector() const;
+    const NDEFRecord* constBegin() const;
+    const NDEFRecord* constEnd() const;
+    const NDEFRecord* begin() const;
+    const NDEFRecord* end() const;
+
     bool isValid() const;
     QByteArray toByteArray() const;
 
+    // Compared and hashed record by record, without encoding.
+    bool operator==(const NDEFMessage& msg) const;
+    bool operator!=(const NDEFMessage& msg) const;
+    quint64 hash() const;
+
     static NDEFMessage fromByteArray(const QByteArray& data, int offset = 0);
+    // The message starting at offset, up to its ME record: nothing after it is
+    // read. length gets its size, 0 if data holds no whole message there.
+    static NDEFMessage fromFrame(const QByteArray& data, int offset = 0, int* length = 0);
 };
 
+inline NDEFHashValue qHash(const NDEFMessage& msg, NDEFHashValue seed = 0)
+{
+    return NDEFHashValue(msg.hash()) ^ seed;
+}
+
 #endif // NDEFMESSAGE_H
@@ -0,0 +1,76 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFMESSAGECACHE_H
+#define NDEFMESSAGECACHE_H
+
+#include "ndefmessage.h"
+
+/* A bounded cache of decoded messages, keyed by their encoded bytes.
+
+fromByteArray() returns what NDEFMessage::fromByteArray() would, but a
+message seen before costs one hash of the bytes, one lookup and one
+comparison of the bytes with the cached ones. The least recently used
+messages are dropped when the cost of the cached ones (their bytes, decoded
+and encoded, plus a fixed overhead per record) would go past maxCost().
+
+The cache is split into ShardCount shards, each with its own lock and an
+equal share of maxCost(), so it can be shared by the threads that decode.
+A message costing more than one share is never cached: it is decoded on
+every call and counted by skipped(). Cached messages are never modified:
+callers get copies sharing their records.
+*/
+
+class NDEFMessageCacheShard;
+
+class LIBNDEFSHARED_EXPORT NDEFMessageCache
+{
+public:
+    static const int ShardCount = 16;
+
+protected:
+    NDEFMessageCacheShard* m_shards;
+    qint64 m_maxCost;
+
+public:
+    explicit NDEFMessageCache(qint64 max_cost = 16 * 1024 * 1024);
+    virtual ~NDEFMessageCache();
+
+    NDEFMessage fromByteArray(const QByteArray& data);
+    bool contains(const QByteArray& data) const;
+
+    void setMaxCost(qint64 max_cost);
+    qint64 maxCost() const;
+    qint64 totalCost() const;
+    int count() const;
+    void clear();
+
+    // Since the cache was created or resetStatistics() was called.
+    quint64 hits() const;
+    quint64 misses() const;
+    quint64 evictions() const;
+    // Misses whose message was too large for a shard, and was not cached.
+    quint64 skipped() const;
+    void resetStatistics();
+
+    static qint64 cost(const QByteArray& data, const NDEFMessage& msg);
+
+private:
+    Q_DISABLE_COPY(NDEFMessageCache)
+};
+
+#endif // NDEFMESSAGECACHE_H
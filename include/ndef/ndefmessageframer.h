@@ -0,0 +1,74 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFMESSAGEFRAMER_H
+#define NDEFMESSAGEFRAMER_H
+
+#include "ndefmessage.h"
+#include "core/framer.h"
+
+/* Splits a stream of messages laid end to end into messages, on the MB and
+ME flags of their records (see <ndef/core/framer.h>), as the bytes come in:
+
+    framer.append(socket.readAll());
+    int offset, length;
+    while (framer.next(&offset, &length) == NDEFMessageFramer::MessageReady)
+        handle(framer.messageBytes(offset, length));
+
+Frames are ranges of buffer(), valid until the next append(), skip() or
+clear(); append() drops the bytes of the messages already framed. A message
+declaring more than max_frame_size bytes is a FramingError (FrameTooLarge)
+from its first oversized header on, so the buffer stays bounded. After a
+FramingError, skip() moves on to the next byte that may begin a message.
+*/
+
+class LIBNDEFSHARED_EXPORT NDEFMessageFramer
+{
+public:
+    enum Status
+    {
+        MessageReady,
+        NeedMoreData,
+        FramingError
+    };
+
+protected:
+    QByteArray m_buffer;
+    ndef::MessageFramer m_framer;
+    ndef::FrameStatus m_error;
+
+public:
+    explicit NDEFMessageFramer(int max_frame_size = 16 * 1024 * 1024);
+    virtual ~NDEFMessageFramer();
+
+    void append(const QByteArray& data);
+    Status next(int* offset, int* length);
+    // The next message, decoded; an empty message unless status is MessageReady.
+    NDEFMessage nextMessage(Status* status = 0);
+    bool skip();
+    void clear();
+
+    const QByteArray& buffer() const;
+    // A frame of buffer(), without copy.
+    QByteArray messageBytes(int offset, int length) const;
+    // Bytes received but not framed yet.
+    int pendingBytes() const;
+    // Why the last FramingError happened.
+    ndef::FrameStatus error() const;
+};
+
+#endif // NDEFMESSAGEFRAMER_H
@@ -0,0 +1,110 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFMETRICS_H
+#define NDEFMETRICS_H
+
+#include "ndefrecordtype.h"
+
+/* Process-wide counters of what NDEFMessage::fromByteArray() (decode) and
+NDEFMessage::toByteArray() (encode) did since the library was loaded or the
+last reset().
+
+Metrics are only collected when the library is built with
+"CONFIG += ndef_metrics" (Qt 5 or later). Otherwise the hot path is left
+untouched, isEnabled() returns false and every snapshot reads zero.
+
+A NDEFMetrics object is a snapshot: it is taken with snapshot() and does not
+change afterwards. Counters are updated with relaxed atomics, so a snapshot
+taken while other threads decode is consistent per counter, not across
+counters.
+*/
+
+class LIBNDEFSHARED_EXPORT NDEFMetrics
+{
+public:
+    enum Operation
+    {
+        Decode,
+        Encode,
+        OperationCount
+    };
+
+    enum WellKnownType
+    {
+        Text,               // "T"
+        Uri,                // "U"
+        SmartPoster,        // "Sp"
+        GenericControl,     // "Gc"
+        OtherWellKnownType,
+        WellKnownTypeCount
+    };
+
+    enum RejectReason
+    {
+        EmptyInput,             // No byte to decode.
+        TruncatedHeader,        // Less bytes left than a record header.
+        TruncatedRecord,        // Payload shorter than declared (the record is kept).
+        ReservedTypeNameFormat, // TNF 7, decoding stops there.
+        RejectReasonCount
+    };
+
+    // Bucket n counts the durations below 2^n ns (and above the previous
+    // bucket); the last bucket also counts everything longer.
+    static const int LatencyBucketCount = 32;
+    // Smart Posters nested deeper than this are counted with it.
+    static const int MaxNestingDepth = 7;
+
+protected:
+    quint64 m_messages[OperationCount];
+    quint64 m_bytes[OperationCount];
+    quint64 m_records[OperationCount][8];
+    quint64 m_wellKnownRecords[OperationCount][WellKnownTypeCount];
+    quint64 m_payloadBytes[OperationCount][8];
+    quint64 m_wellKnownPayloadBytes[OperationCount][WellKnownTypeCount];
+    quint64 m_rejections[RejectReasonCount];
+    quint64 m_chunkedRecords[OperationCount];
+    quint64 m_chunkSequences[OperationCount];
+    quint64 m_nestingDepths[MaxNestingDepth + 1];
+    quint64 m_latencyBuckets[OperationCount][LatencyBucketCount];
+    quint64 m_latencySum[OperationCount];
+
+public:
+    NDEFMetrics();
+
+    quint64 messages(Operation operation) const;
+    quint64 bytes(Operation operation) const;
+    quint64 records(Operation operation, NDEFRecordType::NDEFRecordTypeId tnf) const;
+    quint64 wellKnownRecords(Operation operation, WellKnownType type) const;
+    // Payload bytes of the records counted by records() and wellKnownRecords().
+    quint64 payloadBytes(Operation operation, NDEFRecordType::NDEFRecordTypeId tnf) const;
+    quint64 wellKnownPayloadBytes(Operation operation, WellKnownType type) const;
+    quint64 rejections(RejectReason reason) const;
+    quint64 chunkedRecords(Operation operation) const;
+    quint64 chunkSequences(Operation operation) const;
+    quint64 nestingDepth(int depth) const;
+    quint64 latencyBucket(Operation operation, int bucket) const;
+    quint64 latencySum(Operation operation) const;
+
+    QByteArray toPrometheus(const QByteArray& prefix = "libndef") const;
+
+    static bool isEnabled();
+    static NDEFMetrics snapshot();
+    static void reset();
+};
+
+#endif // NDEFMETRICS_H
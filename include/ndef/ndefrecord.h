@@ -22,7 +22,11 @@
 
 #include "ndefrecordtype.h"
 #include <QtCore/QList>
+#include <QtCore/QVector>
+#include <atomic>
 
+// NDEFRecord has no virtual destructor: a subclass must never be deleted
+// through a NDEFRecord pointer.
 class LIBNDEFSHARED_EXPORT NDEFRecord
 {
 public:
@@ -53,18 +57,47 @@ public:
         CheckExitCondition = 0x02,
         ExitOnFailure = 0x04
     };
+
+    enum NDEFCarrierPowerState
+    {
+        CarrierInactive,
+        CarrierActive,
+        CarrierActivating,
+        CarrierUnknown
+    };
+
+    enum NDEFBluetoothLeRole
+    {
+        LePeripheralOnly,
+        LeCentralOnly,
+        LePeripheralPreferred,  // Both roles, peripheral preferred.
+        LeCentralPreferred      // Both roles, central preferred.
+    };
     
 protected:
     NDEFRecordType m_type;
     QByteArray m_id;
     QByteArray m_payload;
     bool m_chuncked;
+    // The hash, as two 32-bit halves: 64-bit atomics need libatomic on some
+    // 32-bit targets. The high half is never 0 once hash() was called.
+    mutable std::atomic<quint32> m_hashLow;
+    mutable std::atomic<quint32> m_hashHigh;
     
 public:
     NDEFRecord();
+    NDEFRecord(const NDEFRecord& record);
     NDEFRecord(const QByteArray& data, const NDEFRecordType& type = NDEFRecordType(), int offset = 0, bool chuncked = false);
     NDEFRecord(const NDEFRecordType& type, const QByteArray& id = QByteArray(), const QByteArray& payload = QByteArray(), bool chuncked = false);
-    virtual ~NDEFRecord();
+    ~NDEFRecord();
+
+    NDEFRecord& operator=(const NDEFRecord& record);
+
+    // Records are equal if their type, ID, payload and chunk flag are.
+    bool operator==(const NDEFRecord& record) const;
+    bool operator!=(const NDEFRecord& record) const;
+    // Hash of the type, ID and payload, computed once and kept until they change.
+    quint64 hash() const;
     
     void setId(const QByteArray& id);
     QByteArray id() const;
@@ -85,11 +118,22 @@ public:
     int payloadLength() const;
     
     QByteArray toByteArray(int flags = 0) const;
+    // Encoding into a caller's buffer of at least encodedSize(flags) bytes;
+    // both return the number of bytes written. writeHeaderTo() writes all but
+    // the payload, which then goes right after the header.
+    int encodedSize(int flags = 0) const;
+    int writeTo(char* out, int flags = 0) const;
+    int writeHeaderTo(char* out, int flags = 0) const;
 
     static NDEFRecord fromByteArray(const QByteArray& data, int offset = 0);
+    static int recordLength(const QByteArray& data, int offset = 0);
 
 protected:
     void checkConsistency();
+    // The hash if hash() was called since the last change, 0 otherwise.
+    quint64 cachedHash() const;
+    void storeHash(quint64 hash) const;
+    static bool encodedParts(const NDEFRecord& record, QByteArray& type_name, QByteArray& id);
 
     // MIME records.
 public:
@@ -123,6 +167,27 @@ public:
     static NDEFRecord getGcTargetRecord(const NDEFRecord& record);
     static NDEFRecord getGcActionRecord(const NDEFRecord& record);
     static NDEFRecord getGcDataRecord(const NDEFRecord& record);
+
+    // Connection Handover records. The carrier configuration records follow
+    // the Handover Select/Request record in the message, with the IDs the
+    // Alternative Carrier records refer to. Bluetooth addresses are given
+    // most significant byte first, as they are usually written. Bluetooth
+    // names longer than 254 bytes in UTF-8, and keys, hashes and random
+    // values other than 16 bytes long, give an invalid record.
+public:
+    static NDEFRecord createHandoverSelectRecord(const QList<NDEFRecord>& alternative_carriers, quint8 version = 0x12);
+    static NDEFRecord createHandoverRequestRecord(quint16 random_number, const QList<NDEFRecord>& alternative_carriers, quint8 version = 0x12);
+    static NDEFRecord createAlternativeCarrierRecord(NDEFCarrierPowerState power_state, const QByteArray& carrier_data_reference, const QList<QByteArray>& auxiliary_data_references = QList<QByteArray>());
+    static NDEFRecord createCollisionResolutionRecord(quint16 random_number);
+    static NDEFRecord createHandoverCarrierRecord(const NDEFRecordType& carrier_type, const QByteArray& carrier_data = QByteArray());
+    static NDEFRecord createBluetoothOobRecord(const QByteArray& id, const QByteArray& address, quint32 class_of_device = 0, const QString& name = QString(), const QByteArray& hash = QByteArray(), const QByteArray& randomizer = QByteArray());
+    static NDEFRecord createBluetoothLeOobRecord(const QByteArray& id, const QByteArray& address, bool random_address, NDEFBluetoothLeRole role, const QString& name = QString(), const QByteArray& temporary_key = QByteArray(), const QByteArray& confirmation = QByteArray(), const QByteArray& random = QByteArray());
+
+    // Signature records (see ndefsignature.h). A signature type of 0 with no
+    // signature makes a marker.
+public:
+    static NDEFRecord createSignatureRecord(quint8 signature_type, const QByteArray& signature, const QList<QByteArray>& certificates = QList<QByteArray>());
+
 protected:
     static NDEFRecord createGcTargetRecord(const NDEFRecord& record);
     static NDEFRecord createGcActionRecord(const NDEFRecord& record);
@@ -130,6 +195,15 @@ protected:
     static NDEFRecord createGcDataRecord(const NDEFRecord& data);
 };
 
+// Records are relocatable, so that vectors of them are moved with memmove.
+Q_DECLARE_TYPEINFO(NDEFRecord, Q_MOVABLE_TYPE);
+
 typedef QList<NDEFRecord> NDEFRecordList;
+typedef QVector<NDEFRecord> NDEFRecordVector;
+
+inline NDEFHashValue qHash(const NDEFRecord& record, NDEFHashValue seed = 0)
+{
+    return NDEFHashValue(record.hash()) ^ seed;
+}
 
 #endif // NDEFRECORD_H
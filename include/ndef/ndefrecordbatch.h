@@ -0,0 +1,137 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFRECORDBATCH_H
+#define NDEFRECORDBATCH_H
+
+#include "libndef_global.h"
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+/* The records of many messages as columns, one array per field, for scans
+over one field of a whole corpus without NDEFMessage and NDEFRecord objects.
+
+append() copies a message to the arena of the batch, one buffer shared by
+all messages, and decodes its record headers as NDEFMessage::fromByteArray()
+would, into one row per record:
+
+    messageIndex                    message the record is in
+    tnf, flags                      TNF and MB/ME/CF/SR/IL bits
+    type                            index in typeName(): types are interned
+    idOffset, idLength              ID, as a slice of arena()
+    payloadOffset, payloadLength    payload, as a slice of arena()
+
+and, when asked for, the fields of well-known records:
+
+    uriCode                         identifier code of "U" records
+    locale                          index in localeName() of "T" records
+
+messageOffsets() and messageRecords() have one entry per message and one
+more: where its bytes start in the arena and its first row. The columns are
+plain arrays, to be scanned with the loops of <ndef/core/scan.h>; pointers
+to them are valid until the next append() or clear().
+*/
+
+class LIBNDEFSHARED_EXPORT NDEFRecordBatch
+{
+public:
+    enum NDEFRecordBatchField
+    {
+        UriCodes = 0x01,
+        TextLocales = 0x02
+    };
+
+    static const quint8 NoUriCode = 0xFF;       // Not a URI record.
+    static const quint16 NoLocale = 0xFFFF;     // Not a Text record.
+    // Types and locales past the first 65534 distinct ones all get this
+    // index, which has no name.
+    static const quint16 OtherIndex = 0xFFFE;
+
+protected:
+    int m_fields;
+    QByteArray m_arena;
+    QVector<quint32> m_messageOffsets;
+    QVector<quint32> m_messageRecords;
+
+    QVector<quint32> m_messageIndexes;
+    QVector<quint8> m_tnfs;
+    QVector<quint8> m_flags;
+    QVector<quint16> m_types;
+    QVector<quint32> m_idOffsets;
+    QVector<quint8> m_idLengths;
+    QVector<quint32> m_payloadOffsets;
+    QVector<quint32> m_payloadLengths;
+    QVector<quint8> m_uriCodes;
+    QVector<quint16> m_locales;
+
+    QVector<QByteArray> m_typeNames;
+    QHash<QByteArray, quint16> m_typeIndexes;
+    QVector<QByteArray> m_localeNames;
+    QHash<QByteArray, quint16> m_localeIndexes;
+
+public:
+    explicit NDEFRecordBatch(int fields = 0);
+    virtual ~NDEFRecordBatch();
+
+    // Decodes a message into the columns; returns its number of records.
+    int append(const QByteArray& data);
+    void reserve(int messages, int records, int bytes);
+    void clear();
+
+    int fields() const;
+    int messageCount() const;
+    int recordCount() const;
+    const QByteArray& arena() const;
+
+    const quint32* messageOffsets() const;
+    const quint32* messageRecords() const;
+
+    const quint32* messageIndexes() const;
+    const quint8* tnfs() const;
+    const quint8* flags() const;
+    const quint16* types() const;
+    const quint32* idOffsets() const;
+    const quint8* idLengths() const;
+    const quint32* payloadOffsets() const;
+    const quint32* payloadLengths() const;
+    // Null unless the batch has the field.
+    const quint8* uriCodes() const;
+    const quint16* locales() const;
+
+    // Interned values; the index of a value not in the batch, or under
+    // OtherIndex, is -1.
+    int typeCount() const;
+    QByteArray typeName(int type) const;
+    int typeIndex(const QByteArray& name) const;
+    int localeCount() const;
+    QByteArray localeName(int locale) const;
+    int localeIndex(const QByteArray& name) const;
+
+    // A message or a field of a row, without copy: valid as long as the arena.
+    QByteArray message(int message) const;
+    QByteArray id(int row) const;
+    QByteArray payload(int row) const;
+
+protected:
+    static quint16 intern(const char* data, int length, QVector<QByteArray>& names, QHash<QByteArray, quint16>& indexes);
+
+private:
+    Q_DISABLE_COPY(NDEFRecordBatch)
+};
+
+#endif // NDEFRECORDBATCH_H
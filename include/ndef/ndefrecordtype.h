@@ -50,6 +50,7 @@ public:
 
     bool operator==(const NDEFRecordType& type) const;
     bool operator!=(const NDEFRecordType& type) const;
+    quint64 hash(quint64 seed = 0) const;
 
     static NDEFRecordType fromByteArray(const QByteArray& data, int offset = 0);
 
@@ -65,6 +66,21 @@ public:
     static NDEFRecordType gcTargetRecordType();
     static NDEFRecordType gcActionRecordType();
     static NDEFRecordType gcDataRecordType();
+
+    static NDEFRecordType handoverSelectRecordType();
+    static NDEFRecordType handoverRequestRecordType();
+    static NDEFRecordType alternativeCarrierRecordType();
+    static NDEFRecordType collisionResolutionRecordType();
+    static NDEFRecordType handoverCarrierRecordType();
+    static NDEFRecordType bluetoothOobRecordType();
+    static NDEFRecordType bluetoothLeOobRecordType();
+
+    static NDEFRecordType signatureRecordType();
 };
 
+inline NDEFHashValue qHash(const NDEFRecordType& type, NDEFHashValue seed = 0)
+{
+    return NDEFHashValue(type.hash(seed));
+}
+
 #endif // NDEFRECORDTYPE_H
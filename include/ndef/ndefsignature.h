@@ -0,0 +1,117 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFSIGNATURE_H
+#define NDEFSIGNATURE_H
+
+#include "ndefmessage.h"
+#include <QtCore/QVector>
+
+/* Signature RTD: signed messages and their verification.
+
+A "Sig" record signs the records before it, back to the previous "Sig"
+record (see core/signature.h). Signatures use SHA-256 and X.509
+certificates in DER, the signer's first; chains and signatures given by URI
+are not fetched.
+
+Signing and verifying need the library to be built with
+"CONFIG += ndef_openssl"; otherwise isAvailable() returns false, sign()
+returns an empty message and every signed message verifies as Unavailable.
+Finding what a signature covers works in any case.
+*/
+
+class NDEFSignatureCache;
+
+class LIBNDEFSHARED_EXPORT NDEFSignature
+{
+public:
+    enum SignatureType
+    {
+        NoSignature = 0x00,     // Marks the start of the signed records.
+        RsaPss1024 = 0x01,
+        RsaPkcs1_1024 = 0x02,
+        Dsa1024 = 0x03,
+        EcdsaP192 = 0x04,
+        RsaPss2048 = 0x05,
+        RsaPkcs1_2048 = 0x06,
+        Dsa2048 = 0x07,
+        EcdsaP224 = 0x08,
+        EcdsaK233 = 0x09,
+        EcdsaB233 = 0x0A,
+        EcdsaP256 = 0x0B
+    };
+
+    static bool isAvailable();
+
+    // Signatures of an encoded message: "Sig" records, markers included.
+    static int signatureCount(const QByteArray& message);
+    static QList<int> signedRecords(const QByteArray& message, int signature);
+    // The data signed by a signature, as slices of message: valid as long as message is.
+    static QList<QByteArray> signedData(const QByteArray& message, int signature);
+
+    // Appends a signature of the records after the last "Sig" record.
+    static NDEFMessage sign(const NDEFMessage& message, SignatureType type, const QByteArray& private_key, const QList<QByteArray>& certificates);
+};
+
+/* Verifies signed messages against trusted root certificates.
+
+Certificate chains are parsed and validated once, then cached by content,
+so that messages from a known signer only cost the signature check.
+verify() may be called from several threads at once; the batch overload
+spreads the messages over a pool of threadCount() threads. Trusted
+certificates must be added before verifying.
+*/
+class LIBNDEFSHARED_EXPORT NDEFSignatureVerifier
+{
+public:
+    enum Status
+    {
+        Valid,                  // Every signature is valid, from a trusted signer.
+        Unsigned,               // No signature.
+        BadSignature,
+        UntrustedCertificate,   // Valid signature, but the chain does not lead to a trusted root.
+        Malformed,
+        Unsupported,            // Algorithm, certificate format or URI references.
+        Unavailable             // Built without OpenSSL.
+    };
+
+protected:
+    NDEFSignatureCache* m_cache;
+
+public:
+    NDEFSignatureVerifier();
+    virtual ~NDEFSignatureVerifier();
+
+    bool addTrustedCertificate(const QByteArray& certificate);
+
+    void setThreadCount(int count);
+    int threadCount() const;
+
+    // Every signature is checked; a message with several is given the worst
+    // status: BadSignature, Malformed, UntrustedCertificate, Unsupported,
+    // Unavailable, then Valid.
+    Status verify(const QByteArray& message) const;
+    QVector<Status> verify(const QVector<QByteArray>& messages) const;
+
+    int cachedChainCount() const;
+    void clearCache();
+
+private:
+    Q_DISABLE_COPY(NDEFSignatureVerifier)
+};
+
+#endif // NDEFSIGNATURE_H
@@ -0,0 +1,187 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFSNEP_H
+#define NDEFSNEP_H
+
+#include "ndefmessage.h"
+#include "ndefmessageframer.h"
+#include "core/snep.h"
+#include <functional>
+
+/* SNEP (see <ndef/core/snep.h>) over any link that carries PDUs of up to
+its MIU: requests and responses are sent as fragments cut from the encoded
+message without copy, and the fragments after the first go back to back
+once the peer has answered Continue, so as many are in flight as the link
+lets through.
+
+Received fragments go straight into a NDEFMessageFramer, which checks the
+records as they arrive: a malformed message is rejected (Bad Request)
+without waiting for the rest of it.
+
+    NDEFSnepLoopback link(248, 4);
+    NDEFSnepServer server(link.server());
+    server.setPutHandler(store);
+    // In another thread:  while (server.serveOne()) ;
+
+    NDEFSnepClient client(link.client());
+    ndef::SnepCode response;
+    client.put(msg, &response);
+
+LLCP itself is not part of the library: NDEFSnepTransport is what a LLCP
+data link connection (e.g. of libnfc's libllcp) would implement.
+*/
+
+// A link carrying PDUs of up to miu() bytes, in order.
+class LIBNDEFSHARED_EXPORT NDEFSnepTransport
+{
+public:
+    virtual ~NDEFSnepTransport();
+
+    virtual int miu() const = 0;
+    // Sends head then body as one PDU; false once the link is closed.
+    virtual bool send(ndef::Bytes head, ndef::Bytes body) = 0;
+    // Waits for the next PDU; false on timeout (in ms, -1 for none) or
+    // once the link is closed.
+    virtual bool receive(QByteArray* pdu, int timeout = -1) = 0;
+};
+
+class NDEFSnepLoopbackQueue;
+
+/* Two transports in the same process, one for each end, for tests and
+benchmarks. Each direction holds at most window PDUs, as the receive
+window of a LLCP connection would: senders block when it is full.
+*/
+class LIBNDEFSHARED_EXPORT NDEFSnepLoopback
+{
+protected:
+    NDEFSnepLoopbackQueue* m_queues;
+    NDEFSnepTransport* m_client;
+    NDEFSnepTransport* m_server;
+
+public:
+    NDEFSnepLoopback(int miu = 128, int window = 1);
+    virtual ~NDEFSnepLoopback();
+
+    NDEFSnepTransport* client() const;
+    NDEFSnepTransport* server() const;
+    // Wakes up both ends; they fail from now on.
+    void close();
+};
+
+// Puts the fragments of one request or response back together.
+class LIBNDEFSHARED_EXPORT NDEFSnepReassembler
+{
+public:
+    enum Status
+    {
+        NeedMoreData,
+        Complete,
+        Error
+    };
+
+protected:
+    NDEFMessageFramer m_framer;
+    quint32 m_maxLength;
+    quint32 m_length;           // Of the information field.
+    quint32 m_received;
+    quint32 m_acceptableLength;
+    int m_frameLength;          // -1 until the framer found the message.
+    ndef::SnepCode m_code;
+    ndef::SnepCode m_error;
+    bool m_started;
+    Status m_status;
+
+public:
+    explicit NDEFSnepReassembler(quint32 max_length = 16 * 1024 * 1024);
+    virtual ~NDEFSnepReassembler();
+
+    /* After an Error, feed() only counts the bytes of the fragments still
+    coming (see isFinished()), for the error to be answered once the peer
+    is done sending.
+    */
+    Status feed(const QByteArray& fragment);
+    void reset();
+    // Larger messages are an Error (Reject) from their first fragment on.
+    void setMaxLength(quint32 max_length);
+
+    // Whether all the bytes the header announced came in.
+    bool isFinished() const;
+    ndef::SnepCode code() const;
+    // Of a Get request.
+    quint32 acceptableLength() const;
+    // The message received, once Complete.
+    NDEFMessage message() const;
+    QByteArray messageBytes() const;
+    // The response for an Error: Bad Request, Unsupported Version or Reject.
+    ndef::SnepCode error() const;
+
+protected:
+    Status fail(ndef::SnepCode error);
+};
+
+class LIBNDEFSHARED_EXPORT NDEFSnepClient
+{
+protected:
+    NDEFSnepTransport* m_transport;
+    int m_timeout;
+
+public:
+    explicit NDEFSnepClient(NDEFSnepTransport* transport, int timeout = -1);
+    virtual ~NDEFSnepClient();
+
+    /* True if the server answered Success; response is what it answered,
+    or Reject if the link failed.
+    */
+    bool put(const NDEFMessage& msg, ndef::SnepCode* response = 0);
+    bool put(const QByteArray& data, ndef::SnepCode* response = 0);
+    bool get(const NDEFMessage& request, NDEFMessage* msg, ndef::SnepCode* response = 0,
+             quint32 acceptable_length = 0xFFFFFFFF);
+
+protected:
+    bool request(ndef::SnepCode code, const QByteArray& data, quint32 acceptable_length,
+                 NDEFMessage* msg, ndef::SnepCode* response);
+};
+
+class LIBNDEFSHARED_EXPORT NDEFSnepServer
+{
+public:
+    typedef std::function<ndef::SnepCode (const NDEFMessage& msg)> PutHandler;
+    typedef std::function<ndef::SnepCode (const NDEFMessage& request, NDEFMessage* msg)> GetHandler;
+
+protected:
+    NDEFSnepTransport* m_transport;
+    NDEFSnepReassembler m_reassembler;
+    PutHandler m_putHandler;
+    GetHandler m_getHandler;
+    int m_timeout;
+
+public:
+    explicit NDEFSnepServer(NDEFSnepTransport* transport, int timeout = -1);
+    virtual ~NDEFSnepServer();
+
+    // Without handler, requests are answered Not Implemented.
+    void setPutHandler(const PutHandler& handler);
+    void setGetHandler(const GetHandler& handler);
+    // Larger requests are rejected after their first fragment.
+    void setMaxLength(quint32 max_length);
+
+    // Answers one request; false on timeout or once the link is closed.
+    bool serveOne();
+};
+
+#endif // NDEFSNEP_H
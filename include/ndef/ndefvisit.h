@@ -0,0 +1,71 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFVISIT_H
+#define NDEFVISIT_H
+
+/* ndef::visit() (core/visit.h) for NDEFRecord and NDEFMessage:
+
+    ndefVisit(message, ndef::Overloaded {
+        [](const ndef::UriRecordView& uri) { ... },
+        [](const ndef::RecordView& record) { ... }
+    });
+
+The views point into the record's type, ID and payload and are only valid
+during the call of the handler. Needs C++17.
+*/
+
+#include "ndefmessage.h"
+#include "core/visit.h"
+
+template <typename Visitor>
+void ndefVisit(const NDEFRecord& record, ndef::RecordContext context, Visitor&& visitor)
+{
+    // Keep the implicitly shared arrays alive while the views are in use.
+    const QByteArray type = record.type().name();
+    const QByteArray id = record.id();
+    const QByteArray payload = record.payload();
+
+    ndef::RecordView view;
+    view.header.flags = record.flags();
+    view.header.tnf = ndef::TypeNameFormat(record.type().id());
+    view.header.typeLength = std::uint8_t(type.size());
+    view.header.idLength = std::uint8_t(id.size());
+    view.header.payloadLength = std::uint32_t(payload.size());
+    view.header.headerLength = std::uint8_t(ndef::headerLength(view.header.flags));
+    view.type = ndef::Bytes(type.constData(), std::size_t(type.size()));
+    view.id = ndef::Bytes(id.constData(), std::size_t(id.size()));
+    view.payload = ndef::Bytes(payload.constData(), std::size_t(payload.size()));
+    view.complete = true;
+
+    ndef::visitRecord(view, context, visitor);
+}
+
+template <typename Visitor>
+void ndefVisit(const NDEFRecord& record, Visitor&& visitor)
+{
+    ndefVisit(record, ndef::RecordContext::Message, visitor);
+}
+
+template <typename Visitor>
+void ndefVisit(const NDEFMessage& message, Visitor&& visitor)
+{
+    for (const NDEFRecord& record : message)
+        ndefVisit(record, ndef::RecordContext::Message, visitor);
+}
+
+#endif // NDEFVISIT_H
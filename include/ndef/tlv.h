@@ -50,6 +50,10 @@ public:
 
     QByteArray toByteArray() const;
 
+    bool operator==(const Tlv& tlv) const;
+    bool operator!=(const Tlv& tlv) const;
+    quint64 hash() const;
+
     static TlvList fromByteArray(const QByteArray& data, quint64 offset = 0);
 
     static Tlv createNullTlv();
@@ -57,4 +61,9 @@ public:
     static Tlv createNDEFMessageTlv(const NDEFMessage& msg);
 };
 
+inline NDEFHashValue qHash(const Tlv& tlv, NDEFHashValue seed = 0)
+{
+    return NDEFHashValue(tlv.hash()) ^ seed;
+}
+
 #endif // TLV_H
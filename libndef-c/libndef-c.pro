@@ -0,0 +1,56 @@
+##
+# This file is part of the libndef project.
+#
+# This program is free software: you can redistribute it and/or modify it
+# under the terms of the GNU Lesser General Public License as published by the
+# Free Software Foundation, either version 3 of the License, or (at your
+# option) any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU Lesser General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>
+##
+
+# C API (include/ndef/ndefc.h) over the wire format core. It does not use Qt.
+VERSION=1.0.0
+NDEF_INCDIR = ../include/ndef
+NDEF_SRCDIR = ../libndef-c
+
+PUBLIC_HEADERS = $$NDEF_INCDIR/ndefc.h
+
+CONFIG -= qt
+# Only the ndef_* functions are exported, not the core's inline C++.
+CONFIG += hide_symbols
+greaterThan(QT_MAJOR_VERSION, 4): CONFIG += c++17
+else: QMAKE_CXXFLAGS += -std=c++17
+TARGET = ndefc
+TEMPLATE = lib
+DEFINES += NDEFC_LIBRARY
+INCLUDEPATH += $$NDEF_INCDIR
+HEADERS += $$PUBLIC_HEADERS
+SOURCES += $$NDEF_SRCDIR/ndefc.cpp
+
+unix: {
+    # install library and headers
+    isEmpty(PREFIX) {
+      PREFIX = /usr/local
+    }
+    target.path = $$PREFIX/lib
+    INSTALLS += target
+
+    incfiles.path = $$PREFIX/include/ndef
+    incfiles.files = $$PUBLIC_HEADERS
+    INSTALLS += incfiles
+
+    # install pkg-config file (libndefc.pc)
+    CONFIG += create_pc create_prl
+    QMAKE_PKGCONFIG_NAME = libndefc
+    QMAKE_PKGCONFIG_DESCRIPTION = C API of libndef
+    QMAKE_PKGCONFIG_LIBDIR = $$target.path
+    QMAKE_PKGCONFIG_INCDIR = $$PREFIX/include
+    QMAKE_PKGCONFIG_DESTDIR = pkgconfig
+}
@@ -0,0 +1,326 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefc.h"
+#include "core/record.h"
+#include "core/text.h"
+#include "core/tlv.h"
+#include "core/uri.h"
+#include <cstring>
+
+// The C API is a thin layer over the ndef core: no Qt, no allocation.
+
+static size_t recordSize(const ndef_record_desc& record, std::uint8_t flags)
+{
+    return ndef::encodedRecordLength(flags, record.type_length, record.id_length, record.payload_length);
+}
+
+static int checkRecord(const ndef_record_desc& record)
+{
+    if (record.tnf > ndef::Unchanged)
+        return NDEF_ERR_ARGUMENT;
+    if ((!record.type && record.type_length) || (!record.id && record.id_length)
+        || (!record.payload && record.payload_length))
+        return NDEF_ERR_ARGUMENT;
+    if (record.type_length > 0xFF || record.id_length > 0xFF || record.payload_length > 0xFFFFFFFFu)
+        return NDEF_ERR_TOO_LONG;
+    return NDEF_OK;
+}
+
+static std::uint8_t recordFlags(const ndef_record_desc* records, size_t count, size_t i)
+{
+    std::uint8_t flags = 0;
+    if (i == 0)
+        flags |= ndef::MessageBegin;
+    if (i == count - 1)
+        flags |= ndef::MessageEnd;
+    if (records[i].chunk)
+        flags |= ndef::Chunk;
+    return ndef::recordFlags(flags, records[i].id_length, records[i].payload_length);
+}
+
+const char* ndef_strerror(int status)
+{
+    switch (status)
+    {
+        case NDEF_OK:                   return "Success";
+        case NDEF_END:                  return "End of data";
+        case NDEF_ERR_ARGUMENT:         return "Invalid argument";
+        case NDEF_ERR_TRUNCATED:        return "Truncated record or TLV block";
+        case NDEF_ERR_RESERVED_TNF:     return "Record with a reserved type name format";
+        case NDEF_ERR_BUFFER_TOO_SMALL: return "Output buffer too small";
+        case NDEF_ERR_TOO_LONG:         return "Field too long";
+        case NDEF_ERR_NOT_FOUND:        return "No NDEF message TLV";
+    }
+    return "Unknown error";
+}
+
+int ndef_message_iter_init(ndef_message_iter* it, const uint8_t* data, size_t size)
+{
+    if (!it || (!data && size))
+        return NDEF_ERR_ARGUMENT;
+
+    it->data = data;
+    it->size = size;
+    it->offset = 0;
+    it->done = 0;
+    return NDEF_OK;
+}
+
+int ndef_record_next(ndef_message_iter* it, ndef_record* record)
+{
+    if (!it || !record)
+        return NDEF_ERR_ARGUMENT;
+    if (it->done || it->offset >= it->size)
+        return NDEF_END;
+
+    const ndef::Bytes data(it->data, it->size);
+    if ((data[it->offset] & 0x07) == ndef::Reserved)
+        return NDEF_ERR_RESERVED_TNF;
+
+    const ndef::RecordView view = ndef::decodeRecord(data, it->offset);
+    if (!view.complete)
+        return NDEF_ERR_TRUNCATED;
+
+    record->flags = view.header.flags;
+    record->tnf = view.header.tnf;
+    record->offset = view.offset;
+    record->length = view.size();
+    record->type = view.type.data();
+    record->type_length = view.type.size();
+    record->id = view.id.data();
+    record->id_length = view.id.size();
+    record->payload = view.payload.data();
+    record->payload_length = view.payload.size();
+
+    it->offset += record->length;
+    if (view.header.isMessageEnd())
+        it->done = 1;
+    return NDEF_OK;
+}
+
+int ndef_message_record_count(const uint8_t* data, size_t size, size_t* count)
+{
+    if (!count)
+        return NDEF_ERR_ARGUMENT;
+
+    ndef_message_iter it;
+    ndef_record record;
+    int status = ndef_message_iter_init(&it, data, size);
+
+    *count = 0;
+    while (status == NDEF_OK && (status = ndef_record_next(&it, &record)) == NDEF_OK)
+        (*count)++;
+    return (status == NDEF_END) ? NDEF_OK : status;
+}
+
+uint8_t ndef_record_tnf(const ndef_record* record)
+{
+    return record ? record->tnf : 0;
+}
+
+int ndef_record_is_chunk(const ndef_record* record)
+{
+    return record && (record->flags & NDEF_FLAG_CF);
+}
+
+int ndef_record_type_is(const ndef_record* record, uint8_t tnf, const char* type)
+{
+    if (!record || !type || record->tnf != tnf)
+        return 0;
+    size_t length = std::strlen(type);
+    return length == record->type_length && (length == 0 || std::memcmp(record->type, type, length) == 0);
+}
+
+const uint8_t* ndef_record_type(const ndef_record* record, size_t* length)
+{
+    if (length)
+        *length = record ? record->type_length : 0;
+    return record ? record->type : 0;
+}
+
+const uint8_t* ndef_record_id(const ndef_record* record, size_t* length)
+{
+    if (length)
+        *length = record ? record->id_length : 0;
+    return record ? record->id : 0;
+}
+
+const uint8_t* ndef_record_payload(const ndef_record* record, size_t* length)
+{
+    if (length)
+        *length = record ? record->payload_length : 0;
+    return record ? record->payload : 0;
+}
+
+int ndef_text_decode(const uint8_t* payload, size_t payload_length, int* utf16,
+                     const uint8_t** locale, size_t* locale_length,
+                     const uint8_t** text, size_t* text_length)
+{
+    if (!payload || payload_length == 0)
+        return NDEF_ERR_ARGUMENT;
+
+    const ndef::TextView view = ndef::decodeText(ndef::Bytes(payload, payload_length));
+    if (view.locale.size() != std::size_t(payload[0] & ndef::TextLocaleLengthMask))
+        return NDEF_ERR_TRUNCATED;
+
+    if (utf16)
+        *utf16 = view.utf16;
+    if (locale)
+        *locale = view.locale.data();
+    if (locale_length)
+        *locale_length = view.locale.size();
+    if (text)
+        *text = view.text.data();
+    if (text_length)
+        *text_length = view.text.size();
+    return NDEF_OK;
+}
+
+const char* ndef_uri_prefix(uint8_t code)
+{
+    // The prefixes are string literals, so they are NUL-terminated.
+    const std::string_view prefix = ndef::uriPrefix(code);
+    return prefix.empty() ? "" : prefix.data();
+}
+
+int ndef_uri_decode(const uint8_t* payload, size_t payload_length, const char** prefix,
+                    const uint8_t** rest, size_t* rest_length)
+{
+    if (!payload || payload_length == 0)
+        return NDEF_ERR_ARGUMENT;
+
+    const ndef::UriView view = ndef::decodeUri(ndef::Bytes(payload, payload_length));
+    if (prefix)
+        *prefix = ndef_uri_prefix(payload[0]);
+    if (rest)
+        *rest = view.rest.data();
+    if (rest_length)
+        *rest_length = view.rest.size();
+    return NDEF_OK;
+}
+
+int ndef_tlv_iter_init(ndef_tlv_iter* it, const uint8_t* data, size_t size)
+{
+    if (!it || (!data && size))
+        return NDEF_ERR_ARGUMENT;
+
+    it->data = data;
+    it->size = size;
+    it->offset = 0;
+    it->done = 0;
+    return NDEF_OK;
+}
+
+int ndef_tlv_next(ndef_tlv_iter* it, uint8_t* type, const uint8_t** value, size_t* length)
+{
+    if (!it)
+        return NDEF_ERR_ARGUMENT;
+    if (it->done || it->offset >= it->size)
+        return NDEF_END;
+
+    const ndef::Bytes data(it->data, it->size);
+    const ndef::TlvRange blocks(data, it->offset);
+    const ndef::TlvRange::Iterator block = blocks.begin();
+    if (block == blocks.end())
+        return NDEF_ERR_TRUNCATED;
+
+    if (type)
+        *type = block->type;
+    if (value)
+        *value = block->value.data();
+    if (length)
+        *length = block->value.size();
+
+    if (block->type == ndef::NullTlv || block->type == ndef::TerminatorTlv)
+        it->offset += 1;
+    else
+        it->offset = std::size_t(block->value.data() - it->data) + block->value.size();
+    if (block->type == ndef::TerminatorTlv)
+        it->done = 1;
+    return NDEF_OK;
+}
+
+int ndef_tlv_find_message(const uint8_t* data, size_t size, const uint8_t** message, size_t* length)
+{
+    ndef_tlv_iter it;
+    uint8_t type;
+    const uint8_t* value;
+    size_t value_length;
+    int status = ndef_tlv_iter_init(&it, data, size);
+
+    while (status == NDEF_OK && (status = ndef_tlv_next(&it, &type, &value, &value_length)) == NDEF_OK)
+    {
+        if (type == ndef::MessageTlv)
+        {
+            if (message)
+                *message = value;
+            if (length)
+                *length = value_length;
+            return NDEF_OK;
+        }
+    }
+    return (status == NDEF_END) ? NDEF_ERR_NOT_FOUND : status;
+}
+
+size_t ndef_encoded_size(const ndef_record_desc* records, size_t count)
+{
+    if (!records && count)
+        return 0;
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (checkRecord(records[i]) != NDEF_OK)
+            return 0;
+        size += recordSize(records[i], recordFlags(records, count, i));
+    }
+    return size;
+}
+
+int ndef_encode_into(const ndef_record_desc* records, size_t count,
+                     uint8_t* out, size_t capacity, size_t* written)
+{
+    if ((!records && count) || (!out && capacity))
+        return NDEF_ERR_ARGUMENT;
+
+    size_t size = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        int status = checkRecord(records[i]);
+        if (status != NDEF_OK)
+            return status;
+        size += recordSize(records[i], recordFlags(records, count, i));
+    }
+    if (size > capacity)
+        return NDEF_ERR_BUFFER_TOO_SMALL;
+
+    uint8_t* position = out;
+    for (size_t i = 0; i < count; i++)
+    {
+        const ndef_record_desc& record = records[i];
+        position += ndef::encodeRecord(position, recordFlags(records, count, i),
+                                       ndef::TypeNameFormat(record.tnf),
+                                       ndef::Bytes(record.type, record.type_length),
+                                       ndef::Bytes(record.id, record.id_length),
+                                       ndef::Bytes(record.payload, record.payload_length));
+    }
+
+    if (written)
+        *written = size;
+    return NDEF_OK;
+}
@@ -25,8 +25,14 @@ CONFIG += ordered
 
 # All the projects in your application are sub-projects of your solution
 SUBDIRS = libndef \
+          libndef-c \
           tools
 
 # Use .depends to specify that a project depends on another.
 tools.depends = libndef
 
+# Benchmarks need QtTest and the JSON classes of Qt 5.
+greaterThan(QT_MAJOR_VERSION, 4) {
+    SUBDIRS += bench
+    bench.depends = libndef
+}
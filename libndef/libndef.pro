@@ -17,7 +17,7 @@
 # along with this program.  If not, see <http://www.gnu.org/licenses/>
 ##
 
-VERSION=1.2.0
+VERSION=2.0.0
 NDEF_INCDIR = ../include/ndef
 NDEF_SRCDIR = ../libndef
 
@@ -25,18 +25,82 @@ PUBLIC_HEADERS = $$NDEF_INCDIR/libndef_global.h \
     $$NDEF_INCDIR/ndefrecord.h \
     $$NDEF_INCDIR/ndefmessage.h \
     $$NDEF_INCDIR/ndefrecordtype.h \
-    $$NDEF_INCDIR/tlv.h
+    $$NDEF_INCDIR/tlv.h \
+    $$NDEF_INCDIR/ndefcapture.h \
+    $$NDEF_INCDIR/ndefmetrics.h \
+    $$NDEF_INCDIR/ndefvisit.h \
+    $$NDEF_INCDIR/ndefdecoderregistry.h \
+    $$NDEF_INCDIR/ndefsignature.h \
+    $$NDEF_INCDIR/ndefmessagecache.h \
+    $$NDEF_INCDIR/ndefrecordbatch.h \
+    $$NDEF_INCDIR/ndefmessageframer.h \
+    $$NDEF_INCDIR/ndefsnep.h
+
+# The wire format core: header-only, C++17, no dependency but the standard
+# library. The Qt classes above are adapters over it.
+CORE_HEADERS = $$NDEF_INCDIR/core/bytes.h \
+    $$NDEF_INCDIR/core/record.h \
+    $$NDEF_INCDIR/core/tlv.h \
+    $$NDEF_INCDIR/core/uri.h \
+    $$NDEF_INCDIR/core/text.h \
+    $$NDEF_INCDIR/core/static_message.h \
+    $$NDEF_INCDIR/core/visit.h \
+    $$NDEF_INCDIR/core/handover.h \
+    $$NDEF_INCDIR/core/signature.h \
+    $$NDEF_INCDIR/core/hash.h \
+    $$NDEF_INCDIR/core/scan.h \
+    $$NDEF_INCDIR/core/framer.h \
+    $$NDEF_INCDIR/core/snep.h
 
 QT -= gui
 TARGET = ndef
 TEMPLATE = lib
 DEFINES += NDEF_LIBRARY
+greaterThan(QT_MAJOR_VERSION, 4): CONFIG += c++17
+else: QMAKE_CXXFLAGS += -std=c++17
 INCLUDEPATH += $$NDEF_INCDIR
-HEADERS += $$PUBLIC_HEADERS
+HEADERS += $$PUBLIC_HEADERS \
+    $$CORE_HEADERS \
+    $$NDEF_SRCDIR/ndefcore_p.h \
+    $$NDEF_SRCDIR/ndefmetrics_p.h \
+    $$NDEF_SRCDIR/ndeftrace_p.h
 SOURCES += $$NDEF_SRCDIR/ndefrecord.cpp \
     $$NDEF_SRCDIR/ndefmessage.cpp \
     $$NDEF_SRCDIR/ndefrecordtype.cpp \
-    $$NDEF_SRCDIR/tlv.cpp
+    $$NDEF_SRCDIR/tlv.cpp \
+    $$NDEF_SRCDIR/ndefcapture.cpp \
+    $$NDEF_SRCDIR/ndefmetrics.cpp \
+    $$NDEF_SRCDIR/ndefdecoderregistry.cpp \
+    $$NDEF_SRCDIR/ndefsignature.cpp \
+    $$NDEF_SRCDIR/ndefmessagecache.cpp \
+    $$NDEF_SRCDIR/ndefrecordbatch.cpp \
+    $$NDEF_SRCDIR/ndefmessageframer.cpp \
+    $$NDEF_SRCDIR/ndefsnep.cpp
+
+# Collect NDEFMetrics counters (qmake CONFIG+=ndef_metrics). Without it the
+# metrics hooks compile to nothing.
+ndef_metrics {
+    lessThan(QT_MAJOR_VERSION, 5): error("ndef_metrics requires Qt 5 or later")
+    DEFINES += NDEF_METRICS
+    # The 64-bit counters need libatomic on 32-bit ARM and MIPS.
+    linux:contains(QT_ARCH, "^(arm|mips)$"): LIBS += -latomic
+}
+
+# Compile in the USDT probes of ndeftrace_p.h (qmake CONFIG+=ndef_usdt).
+# Needs <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel).
+ndef_usdt {
+    DEFINES += NDEF_USDT
+}
+
+# Sign and verify Signature RTD records with OpenSSL (qmake CONFIG+=ndef_openssl).
+# Without it NDEFSignature only finds what signatures cover.
+ndef_openssl {
+    DEFINES += NDEF_OPENSSL
+    HEADERS += $$NDEF_SRCDIR/ndefcrypto_p.h
+    SOURCES += $$NDEF_SRCDIR/ndefcrypto.cpp
+    CONFIG += link_pkgconfig
+    PKGCONFIG += libcrypto
+}
 
 unix: {
     # install library and headers
@@ -50,6 +114,10 @@ unix: {
     incfiles.files = $$PUBLIC_HEADERS
     INSTALLS += incfiles
 
+    corefiles.path = $$PREFIX/include/ndef/core
+    corefiles.files = $$CORE_HEADERS
+    INSTALLS += corefiles
+
     # install pkg-config file (libndef.pc)
     CONFIG += create_pc create_prl
     QMAKE_PKGCONFIG_REQUIRES = QtCore
@@ -0,0 +1,456 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefcapture.h"
+#include <QtCore/QDataStream>
+#include <QtCore/QtEndian>
+#include <string.h>
+#include <limits.h>
+
+static const char capture_magic[] = "NDEFCAP1";
+static const char index_magic[] = "NDEFIDX1";
+static const int magic_size = 8;
+static const int header_size = 16;
+static const int trailer_size = 16;
+static const int block_summary_size = 24;
+
+// Bits of the per-block Bloom filter set by a (TNF, type) pair.
+static quint64 typeBits(quint8 tnf, const uchar* name, int length)
+{
+    // FNV-1a over the TNF and the type name.
+    quint32 hash = 2166136261u;
+    hash = (hash ^ tnf) * 16777619u;
+    for (int i = 0; i < length; i++)
+        hash = (hash ^ name[i]) * 16777619u;
+
+    return (Q_UINT64_C(1) << (hash & 63)) | (Q_UINT64_C(1) << ((hash >> 6) & 63));
+}
+
+// Adds the records of message to a block summary, reading only their headers.
+static void summarizeMessage(const QByteArray& message, quint8* tnfs, quint64* types)
+{
+    int offset = 0;
+    while ((message.count() - offset) > 2)
+    {
+        int record_length = NDEFRecord::recordLength(message, offset);
+        if (record_length < 0)
+            break;
+
+        const uchar* header = reinterpret_cast<const uchar*>(message.constData()) + offset;
+        quint8 tnf = header[0] & 0x07;
+        int header_length = 2 + ((header[0] & NDEFRecord::NDEF_SR) ? 1 : 4) + ((header[0] & NDEFRecord::NDEF_IL) ? 1 : 0);
+
+        *tnfs |= (1 << tnf);
+        *types |= typeBits(tnf, header + header_length, header[1]);
+
+        offset += record_length;
+    }
+}
+
+NDEFCaptureMetadata::NDEFCaptureMetadata(quint64 timestamp, const QByteArray& reader_id, const QByteArray& tag_uid)
+    :   m_timestamp(timestamp),
+        m_readerId(reader_id),
+        m_tagUid(tag_uid)
+{
+}
+
+quint64 NDEFCaptureMetadata::timestamp() const
+{
+    return m_timestamp;
+}
+
+QByteArray NDEFCaptureMetadata::readerId() const
+{
+    return m_readerId;
+}
+
+QByteArray NDEFCaptureMetadata::tagUid() const
+{
+    return m_tagUid;
+}
+
+NDEFCaptureWriter::NDEFCaptureWriter()
+    :   m_blockSize(0)
+{
+}
+
+NDEFCaptureWriter::~NDEFCaptureWriter()
+{
+    this->close();
+}
+
+/* Opens filename for appending. An existing capture keeps its block size and
+its messages; a new one is created with block_size messages per block.
+*/
+bool NDEFCaptureWriter::open(const QString& filename, quint32 block_size)
+{
+    this->close();
+
+    m_offsets.clear();
+    m_blockTnfs.clear();
+    m_blockTypes.clear();
+    m_file.setFileName(filename);
+
+    if (m_file.exists() && m_file.size() > 0)
+    {
+        NDEFCaptureReader reader;
+        if (!reader.open(filename))
+            return false;
+
+        m_blockSize = reader.m_blockSize;
+        m_offsets = reader.m_offsets;
+        m_blockTnfs = reader.m_blockTnfs;
+        m_blockTypes = reader.m_blockTypes;
+        qint64 end = reader.m_end;
+        reader.close();
+
+        // Drop the index (or a partial last entry): it is rewritten by close().
+        if (!m_file.open(QIODevice::ReadWrite) || !m_file.resize(end) || !m_file.seek(end))
+        {
+            m_file.close();
+            return false;
+        }
+        return true;
+    }
+
+    if (block_size == 0 || !m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    m_blockSize = block_size;
+
+    QDataStream stream(&m_file);
+    stream.writeRawData(capture_magic, magic_size);
+    stream << (quint16)1;
+    stream << (quint16)0;
+    stream << m_blockSize;
+
+    return (stream.status() == QDataStream::Ok);
+}
+
+bool NDEFCaptureWriter::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+bool NDEFCaptureWriter::append(const QByteArray& message, const NDEFCaptureMetadata& metadata)
+{
+    QByteArray reader_id = metadata.readerId();
+    QByteArray tag_uid = metadata.tagUid();
+
+    if (!m_file.isOpen() || reader_id.count() > 0xFF || tag_uid.count() > 0xFF)
+        return false;
+
+    quint64 entry_length = 8 + 1 + reader_id.count() + 1 + tag_uid.count() + quint64(message.count());
+    if (entry_length > 0xFFFFFFFF)
+        return false;
+
+    if ((m_offsets.count() % m_blockSize) == 0)
+    {
+        m_blockTnfs.append(0);
+        m_blockTypes.append(0);
+    }
+    summarizeMessage(message, &m_blockTnfs.last(), &m_blockTypes.last());
+    m_offsets.append(m_file.pos());
+
+    QDataStream stream(&m_file);
+    stream << (quint32)entry_length;
+    stream << metadata.timestamp();
+    stream << (quint8)reader_id.count();
+    stream.writeRawData(reader_id.constData(), reader_id.count());
+    stream << (quint8)tag_uid.count();
+    stream.writeRawData(tag_uid.constData(), tag_uid.count());
+    stream.writeRawData(message.constData(), message.count());
+
+    return (stream.status() == QDataStream::Ok);
+}
+
+bool NDEFCaptureWriter::append(const NDEFMessage& message, const NDEFCaptureMetadata& metadata)
+{
+    return this->append(message.toByteArray(), metadata);
+}
+
+quint64 NDEFCaptureWriter::messageCount() const
+{
+    return m_offsets.count();
+}
+
+// Writes the index and the trailer, then closes the file.
+bool NDEFCaptureWriter::close()
+{
+    if (!m_file.isOpen())
+        return true;
+
+    quint64 index_offset = m_file.pos();
+    int block_count = m_blockTnfs.count();
+
+    QDataStream stream(&m_file);
+    stream << (quint64)m_offsets.count();
+    stream << (quint32)block_count;
+    foreach (quint64 offset, m_offsets)
+        stream << offset;
+
+    for (int i = 0; i < block_count; i++)
+    {
+        quint64 first = quint64(i) * m_blockSize;
+        stream << first;
+        stream << (quint32)qMin<quint64>(m_blockSize, m_offsets.count() - first);
+        stream << m_blockTnfs.at(i);
+        stream << (quint8)0 << (quint8)0 << (quint8)0;
+        stream << m_blockTypes.at(i);
+    }
+
+    stream << index_offset;
+    stream.writeRawData(index_magic, magic_size);
+
+    bool ok = (stream.status() == QDataStream::Ok);
+    m_file.close();
+
+    return ok;
+}
+
+NDEFCaptureReader::NDEFCaptureReader()
+    :   m_data(0),
+        m_size(0),
+        m_blockSize(0),
+        m_end(0)
+{
+}
+
+NDEFCaptureReader::~NDEFCaptureReader()
+{
+    this->close();
+}
+
+bool NDEFCaptureReader::open(const QString& filename)
+{
+    this->close();
+
+    m_file.setFileName(filename);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return false;
+
+    m_size = m_file.size();
+    if (m_size >= header_size)
+        m_data = m_file.map(0, m_size);
+
+    if (!m_data || memcmp(m_data, capture_magic, magic_size) != 0 || qFromBigEndian<quint16>(m_data + 8) != 1)
+    {
+        this->close();
+        return false;
+    }
+
+    m_blockSize = qFromBigEndian<quint32>(m_data + 12);
+    if (m_blockSize == 0 || (!this->readIndex() && !this->scanEntries()))
+    {
+        this->close();
+        return false;
+    }
+
+    return true;
+}
+
+bool NDEFCaptureReader::isOpen() const
+{
+    return (m_data != 0);
+}
+
+void NDEFCaptureReader::close()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar*>(m_data));
+    m_file.close();
+
+    m_data = 0;
+    m_size = 0;
+    m_end = 0;
+    m_offsets.clear();
+    m_blockTnfs.clear();
+    m_blockTypes.clear();
+}
+
+quint32 NDEFCaptureReader::blockSize() const
+{
+    return m_blockSize;
+}
+
+quint64 NDEFCaptureReader::messageCount() const
+{
+    return m_offsets.count();
+}
+
+QByteArray NDEFCaptureReader::message(quint64 index) const
+{
+    if (index >= quint64(m_offsets.count()))
+        return QByteArray();
+
+    const uchar* entry = m_data + m_offsets.at(index);
+    quint32 entry_length = qFromBigEndian<quint32>(entry);
+    quint8 reader_id_length = entry[12];
+    if (entry_length < quint32(10 + reader_id_length) || m_offsets.at(index) + 4 + entry_length > quint64(m_end))
+        return QByteArray();
+    quint8 tag_uid_length = entry[13 + reader_id_length];
+    quint32 skip = 8 + 1 + reader_id_length + 1 + tag_uid_length;
+    if (entry_length < skip)
+        return QByteArray();
+
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(entry) + 4 + skip, entry_length - skip);
+}
+
+NDEFCaptureMetadata NDEFCaptureReader::metadata(quint64 index) const
+{
+    if (index >= quint64(m_offsets.count()))
+        return NDEFCaptureMetadata();
+
+    const uchar* entry = m_data + m_offsets.at(index);
+    quint32 entry_length = qFromBigEndian<quint32>(entry);
+    quint64 timestamp = qFromBigEndian<quint64>(entry + 4);
+    quint8 reader_id_length = entry[12];
+    if (entry_length < quint32(10 + reader_id_length) || m_offsets.at(index) + 4 + entry_length > quint64(m_end))
+        return NDEFCaptureMetadata(timestamp);
+    const char* reader_id = reinterpret_cast<const char*>(entry) + 13;
+    quint8 tag_uid_length = entry[13 + reader_id_length];
+    quint32 skip = 8 + 1 + reader_id_length + 1 + tag_uid_length;
+    if (entry_length < skip)
+        return NDEFCaptureMetadata(timestamp);
+    const char* tag_uid = reader_id + reader_id_length + 1;
+
+    return NDEFCaptureMetadata(timestamp, QByteArray(reader_id, reader_id_length), QByteArray(tag_uid, tag_uid_length));
+}
+
+int NDEFCaptureReader::blockCount() const
+{
+    return m_blockTnfs.count();
+}
+
+quint64 NDEFCaptureReader::blockFirstMessage(int block) const
+{
+    Q_ASSERT(block < m_blockTnfs.count());
+    return quint64(block) * m_blockSize;
+}
+
+quint64 NDEFCaptureReader::blockMessageCount(int block) const
+{
+    Q_ASSERT(block < m_blockTnfs.count());
+    return qMin<quint64>(m_blockSize, m_offsets.count() - quint64(block) * m_blockSize);
+}
+
+/* Returns false if no message of the block has a record of the given type.
+A true result may be a false positive.
+*/
+bool NDEFCaptureReader::blockMayContain(int block, const NDEFRecordType& type) const
+{
+    Q_ASSERT(block < m_blockTnfs.count());
+
+    quint8 tnf = type.id() & 0x07;
+    QByteArray name = type.name();
+    quint64 bits = typeBits(tnf, reinterpret_cast<const uchar*>(name.constData()), name.count());
+
+    return (m_blockTnfs.at(block) & (1 << tnf)) && ((m_blockTypes.at(block) & bits) == bits);
+}
+
+bool NDEFCaptureReader::isCapture(const QByteArray& data)
+{
+    return data.startsWith(QByteArray::fromRawData(capture_magic, magic_size));
+}
+
+// Loads the index written by NDEFCaptureWriter::close().
+bool NDEFCaptureReader::readIndex()
+{
+    if (m_size < header_size + 12 + trailer_size)
+        return false;
+
+    const uchar* trailer = m_data + m_size - trailer_size;
+    if (memcmp(trailer + 8, index_magic, magic_size) != 0)
+        return false;
+
+    quint64 index_offset = qFromBigEndian<quint64>(trailer);
+    if (index_offset < quint64(header_size) || index_offset + 12 > quint64(m_size - trailer_size))
+        return false;
+
+    const uchar* index = m_data + index_offset;
+    quint64 message_count = qFromBigEndian<quint64>(index);
+    quint32 block_count = qFromBigEndian<quint32>(index + 8);
+    if (message_count > quint64(INT_MAX / 8)
+        || block_count != (message_count + m_blockSize - 1) / m_blockSize
+        || index_offset + 12 + message_count * 8 + quint64(block_count) * block_summary_size + trailer_size != quint64(m_size))
+        return false;
+
+    const uchar* offsets = index + 12;
+    m_end = index_offset;
+    m_offsets.resize(int(message_count));
+    for (quint64 i = 0; i < message_count; i++)
+    {
+        quint64 offset = qFromBigEndian<quint64>(offsets + i * 8);
+        if (offset < quint64(header_size) || offset + 14 > index_offset)
+            return false;
+        m_offsets[i] = offset;
+    }
+
+    const uchar* summaries = offsets + message_count * 8;
+    m_blockTnfs.resize(block_count);
+    m_blockTypes.resize(block_count);
+    for (quint32 i = 0; i < block_count; i++)
+    {
+        const uchar* summary = summaries + i * block_summary_size;
+        m_blockTnfs[i] = summary[12];
+        m_blockTypes[i] = qFromBigEndian<quint64>(summary + 16);
+    }
+
+    return true;
+}
+
+/* Rebuilds the index of a capture whose writer was not closed, by walking
+the entries up to the first one that is incomplete.
+*/
+bool NDEFCaptureReader::scanEntries()
+{
+    m_offsets.clear();
+    m_blockTnfs.clear();
+    m_blockTypes.clear();
+
+    qint64 offset = header_size;
+    m_end = offset;
+    while (m_size - offset >= 4)
+    {
+        quint32 entry_length = qFromBigEndian<quint32>(m_data + offset);
+        if (entry_length < 10 || m_size - offset - 4 < entry_length)
+            break;
+
+        const uchar* entry = m_data + offset;
+        quint8 reader_id_length = entry[12];
+        if (entry_length < quint32(10 + reader_id_length))
+            break;
+        quint8 tag_uid_length = entry[13 + reader_id_length];
+        if (entry_length < quint32(10 + reader_id_length + tag_uid_length))
+            break;
+
+        if ((m_offsets.count() % m_blockSize) == 0)
+        {
+            m_blockTnfs.append(0);
+            m_blockTypes.append(0);
+        }
+        m_offsets.append(offset);
+        m_end = offset + 4 + entry_length;
+
+        QByteArray message = this->message(m_offsets.count() - 1);
+        summarizeMessage(message, &m_blockTnfs.last(), &m_blockTypes.last());
+
+        offset += 4 + entry_length;
+    }
+
+    return true;
+}
@@ -0,0 +1,43 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFCORE_P_H
+#define NDEFCORE_P_H
+
+// Not part of the public API: conversions between QByteArray and the
+// views of the ndef core (include/ndef/core).
+
+#include <QtCore/QByteArray>
+#include "core/bytes.h"
+
+inline ndef::Bytes ndefBytes(const QByteArray& data)
+{
+    return ndef::Bytes(data.constData(), std::size_t(data.size()));
+}
+
+// Copies the bytes, so the result does not depend on the viewed buffer.
+inline QByteArray ndefByteArray(ndef::Bytes bytes)
+{
+    return QByteArray(reinterpret_cast<const char*>(bytes.data()), int(bytes.size()));
+}
+
+inline QByteArray ndefByteArray(std::string_view text)
+{
+    return QByteArray(text.data(), int(text.size()));
+}
+
+#endif // NDEFCORE_P_H
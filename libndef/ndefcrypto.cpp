@@ -0,0 +1,282 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefcrypto_p.h"
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+
+using namespace NDEFCrypto;
+
+static bool isRsaPss(std::uint8_t type)
+{
+    return (type == ndef::RsaPss1024) || (type == ndef::RsaPss2048);
+}
+
+// Key type a signature type needs.
+static int keyType(std::uint8_t type)
+{
+    switch (type)
+    {
+        case ndef::RsaPss1024:
+        case ndef::RsaPkcs1_1024:
+        case ndef::RsaPss2048:
+        case ndef::RsaPkcs1_2048:
+            return EVP_PKEY_RSA;
+        case ndef::Dsa1024:
+        case ndef::Dsa2048:
+            return EVP_PKEY_DSA;
+        case ndef::EcdsaP192:
+        case ndef::EcdsaP224:
+        case ndef::EcdsaK233:
+        case ndef::EcdsaB233:
+        case ndef::EcdsaP256:
+            return EVP_PKEY_EC;
+    }
+    return EVP_PKEY_NONE;
+}
+
+static bool keyMatches(EVP_PKEY* key, std::uint8_t type)
+{
+    int id = EVP_PKEY_base_id(key);
+    return (id == keyType(type)) || (id == EVP_PKEY_RSA_PSS && isRsaPss(type));
+}
+
+static X509* readCertificate(ndef::Bytes certificate)
+{
+    const unsigned char* data = certificate.data();
+    X509* x509 = d2i_X509(0, &data, long(certificate.size()));
+    if (x509)
+        return x509;
+
+    BIO* bio = BIO_new_mem_buf(certificate.data(), int(certificate.size()));
+    x509 = bio ? PEM_read_bio_X509(bio, 0, 0, 0) : 0;
+    BIO_free(bio);
+    return x509;
+}
+
+static EVP_PKEY* readPrivateKey(ndef::Bytes key)
+{
+    BIO* bio = BIO_new_mem_buf(key.data(), int(key.size()));
+    EVP_PKEY* pkey = bio ? PEM_read_bio_PrivateKey(bio, 0, 0, 0) : 0;
+    BIO_free(bio);
+    if (pkey)
+        return pkey;
+
+    const unsigned char* data = key.data();
+    return d2i_AutoPrivateKey(0, &data, long(key.size()));
+}
+
+// ECDSA signatures may come as r || s rather than DER.
+static std::vector<std::uint8_t> derSignature(std::uint8_t type, ndef::Bytes signature)
+{
+    std::vector<std::uint8_t> der(signature.begin(), signature.end());
+    if (keyType(type) != EVP_PKEY_EC || signature.empty() || signature[0] == 0x30 || (signature.size() % 2))
+        return der;
+
+    const int half = int(signature.size() / 2);
+    ECDSA_SIG* sig = ECDSA_SIG_new();
+    BIGNUM* r = BN_bin2bn(signature.data(), half, 0);
+    BIGNUM* s = BN_bin2bn(signature.data() + half, half, 0);
+    if (sig && r && s && ECDSA_SIG_set0(sig, r, s))
+    {
+        r = s = 0;
+        int length = i2d_ECDSA_SIG(sig, 0);
+        if (length > 0)
+        {
+            der.resize(std::size_t(length));
+            unsigned char* out = der.data();
+            i2d_ECDSA_SIG(sig, &out);
+        }
+    }
+    BN_free(r);
+    BN_free(s);
+    ECDSA_SIG_free(sig);
+    return der;
+}
+
+// Sets the padding of RSA-PSS signatures: MGF1 with SHA-256, salt as long as the digest.
+static bool setPadding(EVP_PKEY_CTX* context, std::uint8_t type)
+{
+    if (!isRsaPss(type))
+        return true;
+    return EVP_PKEY_CTX_set_rsa_padding(context, RSA_PKCS1_PSS_PADDING) > 0
+        && EVP_PKEY_CTX_set_rsa_pss_saltlen(context, -1) > 0;
+}
+
+TrustStore::TrustStore()
+    :   m_store(X509_STORE_new()),
+        m_count(0)
+{
+}
+
+TrustStore::~TrustStore()
+{
+    X509_STORE_free(m_store);
+}
+
+bool TrustStore::add(ndef::Bytes certificate)
+{
+    X509* x509 = readCertificate(certificate);
+    if (!x509)
+        return false;
+
+    bool added = m_store && X509_STORE_add_cert(m_store, x509) == 1;
+    X509_free(x509);
+    if (added)
+        m_count++;
+    return added;
+}
+
+int TrustStore::count() const
+{
+    return m_count;
+}
+
+X509_STORE* TrustStore::store() const
+{
+    return m_store;
+}
+
+Chain::Chain()
+    :   m_leaf(0),
+        m_intermediates(0),
+        m_key(0),
+        m_trusted(false)
+{
+}
+
+Chain::~Chain()
+{
+    EVP_PKEY_free(m_key);
+    sk_X509_pop_free(m_intermediates, X509_free);
+    X509_free(m_leaf);
+}
+
+std::shared_ptr<const Chain> Chain::load(const ndef::SignatureView& signature, const TrustStore& trust)
+{
+    // Chains given by URI are not fetched.
+    if (!signature.valid || signature.certificateFormat != ndef::X509Certificate || signature.certificateCount == 0)
+        return std::shared_ptr<const Chain>();
+
+    std::shared_ptr<Chain> chain(new Chain);
+
+    // 1) The signer's certificate and key.
+    const ndef::Bytes leaf = signature.certificate(0);
+    const unsigned char* data = leaf.data();
+    chain->m_leaf = d2i_X509(0, &data, long(leaf.size()));
+    chain->m_key = chain->m_leaf ? X509_get_pubkey(chain->m_leaf) : 0;
+    if (!chain->m_key)
+        return std::shared_ptr<const Chain>();
+
+    // 2) Intermediate certificates.
+    chain->m_intermediates = sk_X509_new_null();
+    for (std::size_t i = 1; i < signature.certificateCount; i++)
+    {
+        const ndef::Bytes certificate = signature.certificate(i);
+        data = certificate.data();
+        X509* x509 = d2i_X509(0, &data, long(certificate.size()));
+        if (!x509 || !sk_X509_push(chain->m_intermediates, x509))
+        {
+            X509_free(x509);
+            return std::shared_ptr<const Chain>();
+        }
+    }
+
+    // 3) Validation against the trusted roots, once for all.
+    if (trust.count() > 0)
+    {
+        X509_STORE_CTX* context = X509_STORE_CTX_new();
+        if (context && X509_STORE_CTX_init(context, trust.store(), chain->m_leaf, chain->m_intermediates) == 1)
+            chain->m_trusted = (X509_verify_cert(context) == 1);
+        X509_STORE_CTX_free(context);
+    }
+
+    return chain;
+}
+
+bool Chain::isTrusted() const
+{
+    return m_trusted;
+}
+
+Result Chain::verify(const ndef::SignatureView& signature, ndef::Bytes message, const ndef::SignedBlock& block) const
+{
+    if (!signature.valid || signature.signatureIsUri)
+        return signature.valid ? Unsupported : Malformed;
+    if (signature.hashType != ndef::Sha256Hash || keyType(signature.type) == EVP_PKEY_NONE)
+        return Unsupported;
+    if (!keyMatches(m_key, signature.type))
+        return BadSignature;
+
+    const std::vector<std::uint8_t> der = derSignature(signature.type, signature.signature);
+
+    EVP_MD_CTX* context = EVP_MD_CTX_new();
+    EVP_PKEY_CTX* key_context = 0;
+    bool ok = context
+        && EVP_DigestVerifyInit(context, &key_context, EVP_sha256(), 0, m_key) == 1
+        && setPadding(key_context, signature.type);
+
+    // The digest is fed straight from the encoded message.
+    ndef::forEachSignedSlice(message, block, [&](ndef::Bytes slice)
+    {
+        if (ok && !slice.empty())
+            ok = (EVP_DigestVerifyUpdate(context, slice.data(), slice.size()) == 1);
+    });
+
+    ok = ok && EVP_DigestVerifyFinal(context, der.data(), der.size()) == 1;
+    EVP_MD_CTX_free(context);
+    return ok ? Verified : BadSignature;
+}
+
+bool NDEFCrypto::sign(ndef::Bytes private_key, std::uint8_t type, ndef::Bytes message, const ndef::SignedBlock& block,
+                      std::vector<std::uint8_t>& signature)
+{
+    EVP_PKEY* key = readPrivateKey(private_key);
+    if (!key || !keyMatches(key, type))
+    {
+        EVP_PKEY_free(key);
+        return false;
+    }
+
+    EVP_MD_CTX* context = EVP_MD_CTX_new();
+    EVP_PKEY_CTX* key_context = 0;
+    bool ok = context
+        && EVP_DigestSignInit(context, &key_context, EVP_sha256(), 0, key) == 1
+        && setPadding(key_context, type);
+
+    ndef::forEachSignedSlice(message, block, [&](ndef::Bytes slice)
+    {
+        if (ok && !slice.empty())
+            ok = (EVP_DigestSignUpdate(context, slice.data(), slice.size()) == 1);
+    });
+
+    std::size_t length = 0;
+    ok = ok && EVP_DigestSignFinal(context, 0, &length) == 1;
+    if (ok)
+    {
+        signature.resize(length);
+        ok = EVP_DigestSignFinal(context, signature.data(), &length) == 1;
+        signature.resize(ok ? length : 0);
+    }
+
+    EVP_MD_CTX_free(context);
+    EVP_PKEY_free(key);
+    return ok;
+}
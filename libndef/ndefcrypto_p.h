@@ -0,0 +1,90 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFCRYPTO_P_H
+#define NDEFCRYPTO_P_H
+
+// Not part of the public API: the OpenSSL side of NDEFSignature, only
+// built with "CONFIG += ndef_openssl". It works on core views, not on Qt
+// types.
+
+#include "core/signature.h"
+#include <memory>
+#include <vector>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+namespace NDEFCrypto
+{
+    enum Result
+    {
+        Verified,
+        BadSignature,
+        Malformed,
+        Unsupported
+    };
+
+    // Trusted root certificates. Filled before use, then only read.
+    class TrustStore
+    {
+        X509_STORE* m_store;
+        int m_count;
+
+    public:
+        TrustStore();
+        ~TrustStore();
+
+        bool add(ndef::Bytes certificate);      // DER or PEM.
+        int count() const;
+        X509_STORE* store() const;
+
+    private:
+        TrustStore(const TrustStore&);
+        TrustStore& operator=(const TrustStore&);
+    };
+
+    // The parsed certificate chain of a signature; immutable once loaded,
+    // so it can be shared between threads.
+    class Chain
+    {
+        X509* m_leaf;
+        STACK_OF(X509)* m_intermediates;
+        EVP_PKEY* m_key;
+        bool m_trusted;
+
+        Chain();
+
+    public:
+        ~Chain();
+
+        // Null if the chain is missing or cannot be parsed.
+        static std::shared_ptr<const Chain> load(const ndef::SignatureView& signature, const TrustStore& trust);
+
+        bool isTrusted() const;
+        Result verify(const ndef::SignatureView& signature, ndef::Bytes message, const ndef::SignedBlock& block) const;
+
+    private:
+        Chain(const Chain&);
+        Chain& operator=(const Chain&);
+    };
+
+    // Signs the records covered by block with a PEM or DER private key.
+    bool sign(ndef::Bytes private_key, std::uint8_t type, ndef::Bytes message, const ndef::SignedBlock& block,
+              std::vector<std::uint8_t>& signature);
+}
+
+#endif // NDEFCRYPTO_P_H
@@ -0,0 +1,301 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefdecoderregistry.h"
+#include <algorithm>
+#include <string.h>
+
+/* The table is built with "hash and displace": keys are spread over buckets
+by the high half of their hash, then each bucket, largest first, gets the
+first displacement that sends all its keys to free slots. Slots are twice as
+many as keys, so displacements are found after a few tries.
+*/
+
+static const quint32 max_displacement = 1 << 16;
+static const int max_attempts = 4;
+
+static bool isCaseInsensitive(quint8 tnf)
+{
+    return (tnf == NDEFRecordType::NDEF_MIME) || (tnf == NDEFRecordType::NDEF_ExternalRTD);
+}
+
+static bool isPrefixSeparator(char c)
+{
+    return (c == ':') || (c == '/') || (c == '.');
+}
+
+static inline char foldCase(char c)
+{
+    return ((c >= 'A') && (c <= 'Z')) ? char(c - 'A' + 'a') : c;
+}
+
+// Length of the part of type to match: MIME parameters are left out.
+static int matchedLength(quint8 tnf, const char* type, int length)
+{
+    if (tnf != NDEFRecordType::NDEF_MIME)
+        return length;
+
+    const char* end = std::find(type, type + length, ';');
+    while ((end > type) && ((end[-1] == ' ') || (end[-1] == '\t')))
+        end--;
+    return int(end - type);
+}
+
+// FNV-1a over the TNF, the prefix flag and the (folded) type.
+static quint64 typeHash(quint8 tnf, bool prefix, const char* type, int length)
+{
+    bool fold = isCaseInsensitive(tnf);
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    hash = (hash ^ (tnf | (prefix ? 0x80 : 0))) * Q_UINT64_C(1099511628211);
+    for (int i = 0; i < length; i++)
+        hash = (hash ^ quint8(fold ? foldCase(type[i]) : type[i])) * Q_UINT64_C(1099511628211);
+    return hash;
+}
+
+static quint32 bucketOf(quint64 hash, int bucket_count)
+{
+    return quint32(hash >> 32) & quint32(bucket_count - 1);
+}
+
+// Slot of a key for a displacement: the hash, moved and mixed again.
+static quint32 slotOf(quint64 hash, quint32 displacement, int slot_count)
+{
+    quint64 h = hash ^ (displacement * Q_UINT64_C(0x9E3779B97F4A7C15));
+    h ^= h >> 33;
+    h *= Q_UINT64_C(0xFF51AFD7ED558CCD);
+    h ^= h >> 33;
+    h *= Q_UINT64_C(0xC4CEB9FE1A85EC53);
+    h ^= h >> 33;
+    return quint32(h) & quint32(slot_count - 1);
+}
+
+static int nextPowerOfTwo(int n)
+{
+    int power = 1;
+    while (power < n)
+        power <<= 1;
+    return power;
+}
+
+NDEFDecoderRegistry::NDEFDecoderRegistry()
+    :   m_prefixTnfs(0),
+        m_frozen(false)
+{
+}
+
+NDEFDecoderRegistry::~NDEFDecoderRegistry()
+{
+}
+
+bool NDEFDecoderRegistry::registerDecoder(NDEFRecordType::NDEFRecordTypeId tnf, const QByteArray& type, const Decoder& decoder)
+{
+    if (m_frozen || !decoder || type.isEmpty())
+        return false;
+
+    switch (tnf)
+    {
+        case NDEFRecordType::NDEF_NfcForumRTD:
+        case NDEFRecordType::NDEF_MIME:
+        case NDEFRecordType::NDEF_URI:
+        case NDEFRecordType::NDEF_ExternalRTD:
+            break;
+        default:
+            return false;
+    }
+
+    int length = matchedLength(tnf, type.constData(), type.size());
+    bool prefix = (length >= 2) && (type.at(length - 1) == '*') && isPrefixSeparator(type.at(length - 2));
+    if (prefix)
+        length--;
+    if (length == 0)
+        return false;
+
+    Entry entry;
+    entry.tnf = tnf;
+    entry.prefix = prefix;
+    entry.type = type.left(length);
+    if (isCaseInsensitive(tnf))
+    {
+        for (int i = 0; i < length; i++)
+            entry.type[i] = foldCase(entry.type.at(i));
+    }
+    entry.decoder = decoder;
+    entry.hash = typeHash(tnf, prefix, entry.type.constData(), entry.type.size());
+
+    for (int i = 0; i < m_entries.count(); i++)
+    {
+        const Entry& other = m_entries.at(i);
+        if ((other.tnf == entry.tnf) && (other.prefix == entry.prefix) && (other.type == entry.type))
+            return false;
+    }
+
+    m_entries.append(entry);
+    if (prefix)
+        m_prefixTnfs |= (1 << tnf);
+    return true;
+}
+
+bool NDEFDecoderRegistry::freeze()
+{
+    if (m_frozen)
+        return true;
+
+    const int count = m_entries.count();
+    int slot_count = nextPowerOfTwo(2 * count);
+
+    for (int attempt = 0; (count > 0) && (attempt < max_attempts); attempt++, slot_count *= 2)
+    {
+        const int bucket_count = nextPowerOfTwo(qMax(1, slot_count / 4));
+        QVector<QVector<int> > buckets(bucket_count);
+        for (int i = 0; i < count; i++)
+            buckets[bucketOf(m_entries.at(i).hash, bucket_count)].append(i);
+
+        QVector<int> order(bucket_count);
+        for (int b = 0; b < bucket_count; b++)
+            order[b] = b;
+        std::stable_sort(order.begin(), order.end(), [&buckets](int a, int b)
+        {
+            return buckets.at(a).count() > buckets.at(b).count();
+        });
+
+        QVector<quint32> displacements(bucket_count, 0);
+        QVector<qint32> slots(slot_count, -1);
+        QVector<quint32> taken;
+        bool placed = true;
+
+        for (int o = 0; placed && (o < bucket_count); o++)
+        {
+            const QVector<int>& bucket = buckets.at(order.at(o));
+            if (bucket.isEmpty())
+                break;
+
+            quint32 d = 0;
+            for (; d < max_displacement; d++)
+            {
+                taken.clear();
+                bool fits = true;
+                for (int k = 0; fits && (k < bucket.count()); k++)
+                {
+                    quint32 slot = slotOf(m_entries.at(bucket.at(k)).hash, d, slot_count);
+                    fits = (slots.at(slot) < 0) && !taken.contains(slot);
+                    taken.append(slot);
+                }
+                if (fits)
+                    break;
+            }
+
+            if (d == max_displacement)
+            {
+                placed = false;
+                break;
+            }
+
+            displacements[order.at(o)] = d;
+            for (int k = 0; k < bucket.count(); k++)
+                slots[taken.at(k)] = bucket.at(k);
+        }
+
+        if (placed)
+        {
+            m_displacements = displacements;
+            m_slots = slots;
+            m_frozen = true;
+            return true;
+        }
+    }
+
+    if (count == 0)
+        m_frozen = true;
+    return m_frozen;
+}
+
+bool NDEFDecoderRegistry::isFrozen() const
+{
+    return m_frozen;
+}
+
+int NDEFDecoderRegistry::count() const
+{
+    return m_entries.count();
+}
+
+const NDEFDecoderRegistry::Entry* NDEFDecoderRegistry::find(quint8 tnf, bool prefix, const char* type, int length) const
+{
+    const quint64 hash = typeHash(tnf, prefix, type, length);
+    const int bucket_count = m_displacements.count();
+    const int slot_count = m_slots.count();
+
+    const quint32 displacement = m_displacements.constData()[bucketOf(hash, bucket_count)];
+    const qint32 index = m_slots.constData()[slotOf(hash, displacement, slot_count)];
+    if (index < 0)
+        return 0;
+
+    const Entry& entry = m_entries.constData()[index];
+    if ((entry.hash != hash) || (entry.tnf != tnf) || (entry.prefix != prefix) || (entry.type.size() != length))
+        return 0;
+
+    const char* key = entry.type.constData();
+    if (isCaseInsensitive(tnf))
+    {
+        for (int i = 0; i < length; i++)
+            if (key[i] != foldCase(type[i]))
+                return 0;
+        return &entry;
+    }
+    return (memcmp(key, type, length) == 0) ? &entry : 0;
+}
+
+const NDEFDecoderRegistry::Decoder* NDEFDecoderRegistry::decoder(NDEFRecordType::NDEFRecordTypeId tnf, const QByteArray& type) const
+{
+    if (!m_frozen || m_slots.isEmpty() || (tnf > NDEFRecordType::NDEF_Invalid))
+        return 0;
+
+    const char* data = type.constData();
+    const int length = matchedLength(tnf, data, type.size());
+
+    // 1) The type itself.
+    const Entry* entry = find(tnf, false, data, length);
+    if (entry)
+        return &entry->decoder;
+
+    // 2) Its prefixes ending with a separator, longest first.
+    if (!(m_prefixTnfs & (1 << tnf)))
+        return 0;
+    for (int i = length - 1; i >= 0; i--)
+    {
+        if (!isPrefixSeparator(data[i]))
+            continue;
+        entry = find(tnf, true, data, i + 1);
+        if (entry)
+            return &entry->decoder;
+    }
+    return 0;
+}
+
+const NDEFDecoderRegistry::Decoder* NDEFDecoderRegistry::decoder(const NDEFRecord& record) const
+{
+    const NDEFRecordType type = record.type();
+    return decoder(type.id(), type.name());
+}
+
+QVariant NDEFDecoderRegistry::decode(const NDEFRecord& record, bool* ok) const
+{
+    const Decoder* found = decoder(record);
+    if (ok)
+        *ok = (found != 0);
+    return found ? (*found)(record) : QVariant();
+}
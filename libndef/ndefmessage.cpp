@@ -18,6 +18,18 @@
  */
 
 #include "ndefmessage.h"
+#include "core/framer.h"
+#include "core/hash.h"
+#include "ndefcore_p.h"
+#include "ndefmetrics_p.h"
+#include "ndeftrace_p.h"
+#include <QtCore/QAtomicInt>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+#include <string.h>
 
 NDEFMessage::NDEFMessage()
 {
@@ -35,7 +47,7 @@ NDEFMessage::NDEFMessage(const NDEFRecord& record)
 
 NDEFMessage::NDEFMessage(const NDEFRecordList& records)
 {
-    m_records = records;
+    m_records = records.toVector();
 }
 
 NDEFMessage::~NDEFMessage()
@@ -57,7 +69,7 @@ void NDEFMessage::insertRecord(const NDEFRecord& record, int index)
 void NDEFMessage::removeRecord(int index)
 {
     Q_ASSERT(index < m_records.count());
-    m_records.removeAt(index);
+    m_records.remove(index);
 }
 
 void NDEFMessage::setRecord(const NDEFRecord& record, int index)
@@ -93,7 +105,7 @@ NDEFRecordList NDEFMessage::record(const NDEFRecordType& type) const
 
 NDEFRecordList NDEFMessage::records() const
 {
-    return m_records;
+    return m_records.toList();
 }
 
 int NDEFMessage::recordCount() const
@@ -101,54 +113,235 @@ int NDEFMessage::recordCount() const
     return m_records.count();
 }
 
+const NDEFRecord& NDEFMessage::recordAt(int index) const
+{
+    Q_ASSERT(index < m_records.count());
+    return m_records.at(index);
+}
+
+const NDEFRecordVector& NDEFMessage::recordVector() const
+{
+    return m_records;
+}
+
+const NDEFRecord* NDEFMessage::constBegin() const
+{
+    return m_records.constData();
+}
+
+const NDEFRecord* NDEFMessage::constEnd() const
+{
+    return m_records.constData() + m_records.count();
+}
+
+const NDEFRecord* NDEFMessage::begin() const
+{
+    return constBegin();
+}
+
+const NDEFRecord* NDEFMessage::end() const
+{
+    return constEnd();
+}
+
 bool NDEFMessage::isValid() const
 {
     if (m_records.isEmpty())
         return false;
 
-    foreach (NDEFRecord record, this->records())
+    foreach (const NDEFRecord& record, m_records)
         if (!record.isValid())
             return false;
 
     return true;
 }
 
-QByteArray NDEFMessage::toByteArray() const
+bool NDEFMessage::operator==(const NDEFMessage& msg) const
+{
+    return m_records == msg.m_records;
+}
+
+bool NDEFMessage::operator!=(const NDEFMessage& msg) const
+{
+    return !(*this == msg);
+}
+
+quint64 NDEFMessage::hash() const
+{
+    // Records keep their own hash, so this only folds them.
+    quint64 hash = quint64(m_records.count());
+    for (int i = 0; i < m_records.count(); i++)
+        hash = ndef::hashCombine(hash, m_records.at(i).hash());
+    return hash;
+}
+
+// Messages from this size on have their payloads copied by several threads.
+static const int parallel_threshold = 1024 * 1024;
+// Payloads are copied in slices of at most this size.
+static const int slice_size = 256 * 1024;
+
+static int messageFlags(int index, int record_count)
 {
-    QByteArray output;
-    
-    int record_count = this->recordCount();
     int flags = 0;
+    if (index == 0)
+        flags |= NDEFRecord::NDEF_MB;
+    if (index == record_count-1)
+        flags |= NDEFRecord::NDEF_ME;
+    return flags;
+}
+
+struct NDEFCopySlice
+{
+    char* out;
+    const char* in;
+    int length;
+};
+
+// Copies the slices not taken yet, until there are none left.
+static void copySlices(const QVector<NDEFCopySlice>& slices, QAtomicInt& next)
+{
+    for (int i = next.fetchAndAddRelaxed(1); i < slices.count(); i = next.fetchAndAddRelaxed(1))
+        memcpy(slices.at(i).out, slices.at(i).in, size_t(slices.at(i).length));
+}
+
+class NDEFCopyTask : public QRunnable
+{
+    const QVector<NDEFCopySlice>& m_slices;
+    QAtomicInt& m_next;
+    QSemaphore& m_done;
+
+public:
+    NDEFCopyTask(const QVector<NDEFCopySlice>& slices, QAtomicInt& next, QSemaphore& done)
+        :   m_slices(slices),
+            m_next(next),
+            m_done(done)
+    {
+    }
+
+    void run()
+    {
+        copySlices(m_slices, m_next);
+        m_done.release();
+    }
+};
+
+QByteArray NDEFMessage::toByteArray() const
+{
+    NDEF_METRICS_TIMER(timer);
+    const int record_count = this->recordCount();
+
+    // 1) Record sizes, prefix-summed into their offsets, so that the output
+    // is allocated once.
+    QVector<int> offsets(record_count + 1);
+    offsets[0] = 0;
     for (int i = 0; i < record_count; i++)
+        offsets[i + 1] = offsets[i] + m_records.at(i).encodedSize(messageFlags(i, record_count));
+
+    QByteArray output;
+    output.resize(offsets[record_count]);
+    char* out = output.data();
+
+    // 2) Small messages: written record by record.
+    if (output.count() < parallel_threshold || QThread::idealThreadCount() < 2)
     {
-        flags = 0;
-        
-        if (i == 0)
-            flags |= NDEFRecord::NDEF_MB;
-        if (i == record_count-1)
-            flags |= NDEFRecord::NDEF_ME;
-        
-        output.append(m_records[i].toByteArray(flags));
+        for (int i = 0; i < record_count; i++)
+            m_records.at(i).writeTo(out + offsets[i], messageFlags(i, record_count));
     }
-    
+    // 3) Large messages: headers written here, payloads cut into slices and
+    // copied by this thread and by as many idle threads of the global pool.
+    // Threads are only taken if idle, so this never waits for a busy pool.
+    else
+    {
+        QVector<NDEFCopySlice> slices;
+        for (int i = 0; i < record_count; i++)
+        {
+            const NDEFRecord& record = m_records.at(i);
+            const int header_length = record.writeHeaderTo(out + offsets[i], messageFlags(i, record_count));
+            if (header_length == 0)
+                continue;
+
+            const QByteArray payload = record.payload();
+            for (int copied = 0; copied < payload.count(); copied += slice_size)
+            {
+                NDEFCopySlice slice;
+                slice.out = out + offsets[i] + header_length + copied;
+                slice.in = payload.constData() + copied;
+                slice.length = qMin(slice_size, payload.count() - copied);
+                slices.append(slice);
+            }
+        }
+
+        QAtomicInt next(0);
+        QSemaphore done;
+        const int helper_count = qMin(QThread::idealThreadCount(), slices.count()) - 1;
+        int helpers = 0;
+        for (; helpers < helper_count; helpers++)
+        {
+            NDEFCopyTask* task = new NDEFCopyTask(slices, next, done);
+            if (!QThreadPool::globalInstance()->tryStart(task))
+            {
+                delete task;
+                break;
+            }
+        }
+        copySlices(slices, next);
+        done.acquire(helpers);
+    }
+
+    NDEF_METRICS_MESSAGE(Encode, *this, output.count(), timer);
+    NDEF_TRACE2(message__encode, record_count, output.count());
     return output;
 }
 
 NDEFMessage NDEFMessage::fromByteArray(const QByteArray& data, int offset)
 {
+    NDEF_METRICS_TIMER(timer);
     NDEFMessage msg;
+    const int start = offset;
+    NDEF_TRACE2(message__begin, offset, data.count() - offset);
 
-    QByteArray buffer = data.right(data.count() - offset);
-    while (!buffer.isEmpty())
+    if (offset >= data.count())
+        NDEF_METRICS_REJECT(EmptyInput);
+
+    while (offset < data.count())
     {
-        NDEFRecord record = NDEFRecord::fromByteArray(buffer);
+        NDEFRecord record = NDEFRecord::fromByteArray(data, offset);
         if (record.type().id() == NDEFRecordType::NDEF_Invalid)
+        {
+            if ((data.count() - offset) > 2)
+                NDEF_METRICS_REJECT(ReservedTypeNameFormat);
+            else
+                NDEF_METRICS_REJECT(TruncatedHeader);
             break;
+        }
 
         msg.appendRecord(record);
-        QByteArray record_buffer = record.toByteArray();
-        buffer.remove(0, record_buffer.count());
+
+        // A truncated record is kept as the last one, as it always was.
+        int record_length = NDEFRecord::recordLength(data, offset);
+        if (record_length < 0)
+        {
+            NDEF_METRICS_REJECT(TruncatedRecord);
+            offset = data.count();
+            break;
+        }
+        offset += record_length;
     }
 
+    if (msg.recordCount() > 0)
+        NDEF_METRICS_MESSAGE(Decode, msg, offset - start, timer);
+    NDEF_TRACE3(message__end, start, offset - start, msg.recordCount());
+    Q_UNUSED(start);
     return msg;
 }
+
+NDEFMessage NDEFMessage::fromFrame(const QByteArray& data, int offset, int* length)
+{
+    ndef::MessageFrame frame;
+    const bool complete = (offset >= 0 && ndef::frameMessage(ndefBytes(data), std::size_t(offset), frame) == ndef::FrameComplete);
+    if (length)
+        *length = complete ? int(frame.size) : 0;
+    if (!complete)
+        return NDEFMessage();
+    return fromByteArray(QByteArray::fromRawData(data.constData(), int(frame.offset + frame.size)), offset);
+}
@@ -0,0 +1,306 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefmessagecache.h"
+#include "ndefcore_p.h"
+#include "core/hash.h"
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <string.h>
+
+// Estimated bookkeeping of a cached message and of each of its records.
+static const qint64 message_overhead = 128;
+static const qint64 record_overhead = 96;
+
+struct NDEFMessageCacheEntry
+{
+    quint64 hash;
+    QByteArray data;
+    NDEFMessage msg;
+    qint64 cost;
+    NDEFMessageCacheEntry* previous;    // More recently used.
+    NDEFMessageCacheEntry* next;        // Less recently used.
+};
+
+// One lock, one table and one LRU list: messages are spread over the shards
+// by the top bits of their hash.
+class NDEFMessageCacheShard
+{
+public:
+    mutable QMutex mutex;
+    QHash<quint64, NDEFMessageCacheEntry*> entries;
+    NDEFMessageCacheEntry* first;
+    NDEFMessageCacheEntry* last;
+    qint64 cost;
+    qint64 maxCost;
+    quint64 hits;
+    quint64 misses;
+    quint64 evictions;
+    quint64 skipped;
+
+    NDEFMessageCacheShard()
+        :   first(0),
+            last(0),
+            cost(0),
+            maxCost(0),
+            hits(0),
+            misses(0),
+            evictions(0),
+            skipped(0)
+    {
+    }
+
+    ~NDEFMessageCacheShard()
+    {
+        clear();
+    }
+
+    static bool sameBytes(const NDEFMessageCacheEntry* entry, const QByteArray& data)
+    {
+        return entry->data.size() == data.size()
+            && memcmp(entry->data.constData(), data.constData(), size_t(data.size())) == 0;
+    }
+
+    void unlink(NDEFMessageCacheEntry* entry)
+    {
+        if (entry->previous)
+            entry->previous->next = entry->next;
+        else
+            first = entry->next;
+        if (entry->next)
+            entry->next->previous = entry->previous;
+        else
+            last = entry->previous;
+    }
+
+    void pushFront(NDEFMessageCacheEntry* entry)
+    {
+        entry->previous = 0;
+        entry->next = first;
+        if (first)
+            first->previous = entry;
+        else
+            last = entry;
+        first = entry;
+    }
+
+    void remove(NDEFMessageCacheEntry* entry)
+    {
+        unlink(entry);
+        entries.remove(entry->hash);
+        cost -= entry->cost;
+        delete entry;
+    }
+
+    // Drops the least recently used messages until the cost fits.
+    void trim(qint64 budget)
+    {
+        while (last && cost > budget)
+        {
+            remove(last);
+            evictions++;
+        }
+    }
+
+    void clear()
+    {
+        while (last)
+            remove(last);
+    }
+};
+
+NDEFMessageCache::NDEFMessageCache(qint64 max_cost)
+    :   m_shards(new NDEFMessageCacheShard[ShardCount]),
+        m_maxCost(0)
+{
+    setMaxCost(max_cost);
+}
+
+NDEFMessageCache::~NDEFMessageCache()
+{
+    delete [] m_shards;
+}
+
+NDEFMessage NDEFMessageCache::fromByteArray(const QByteArray& data)
+{
+    const quint64 hash = ndef::hash64(ndefBytes(data));
+    NDEFMessageCacheShard& shard = m_shards[hash >> 60];
+
+    // 1) Lookup.
+    {
+        QMutexLocker locker(&shard.mutex);
+        NDEFMessageCacheEntry* entry = shard.entries.value(hash);
+        if (entry && NDEFMessageCacheShard::sameBytes(entry, data))
+        {
+            shard.hits++;
+            if (entry != shard.first)
+            {
+                shard.unlink(entry);
+                shard.pushFront(entry);
+            }
+            return entry->msg;
+        }
+        shard.misses++;
+    }
+
+    // 2) Decoded outside the lock; the bytes are copied, as data may be a
+    // view on memory the cache does not own.
+    NDEFMessageCacheEntry* entry = new NDEFMessageCacheEntry;
+    entry->hash = hash;
+    entry->msg = NDEFMessage::fromByteArray(data);
+    entry->data = QByteArray(data.constData(), data.size());
+    entry->cost = cost(data, entry->msg);
+    const NDEFMessage msg = entry->msg;
+
+    // 3) Insertion, in place of a message with the same hash.
+    QMutexLocker locker(&shard.mutex);
+    if (entry->cost > shard.maxCost)
+    {
+        shard.skipped++;
+        delete entry;
+        return msg;
+    }
+    NDEFMessageCacheEntry* previous = shard.entries.value(hash);
+    if (previous)
+        shard.remove(previous);
+    shard.trim(shard.maxCost - entry->cost);
+    shard.entries.insert(hash, entry);
+    shard.pushFront(entry);
+    shard.cost += entry->cost;
+    return msg;
+}
+
+bool NDEFMessageCache::contains(const QByteArray& data) const
+{
+    const quint64 hash = ndef::hash64(ndefBytes(data));
+    const NDEFMessageCacheShard& shard = m_shards[hash >> 60];
+
+    QMutexLocker locker(&shard.mutex);
+    const NDEFMessageCacheEntry* entry = shard.entries.value(hash);
+    return entry && NDEFMessageCacheShard::sameBytes(entry, data);
+}
+
+void NDEFMessageCache::setMaxCost(qint64 max_cost)
+{
+    m_maxCost = qMax(qint64(0), max_cost);
+    for (int i = 0; i < ShardCount; i++)
+    {
+        QMutexLocker locker(&m_shards[i].mutex);
+        m_shards[i].maxCost = m_maxCost / ShardCount;
+        m_shards[i].trim(m_shards[i].maxCost);
+    }
+}
+
+qint64 NDEFMessageCache::maxCost() const
+{
+    return m_maxCost;
+}
+
+qint64 NDEFMessageCache::totalCost() const
+{
+    qint64 total = 0;
+    for (int i = 0; i < ShardCount; i++)
+    {
+        QMutexLocker locker(&m_shards[i].mutex);
+        total += m_shards[i].cost;
+    }
+    return total;
+}
+
+int NDEFMessageCache::count() const
+{
+    int total = 0;
+    for (int i = 0; i < ShardCount; i++)
+    {
+        QMutexLocker locker(&m_shards[i].mutex);
+        total += m_shards[i].entries.count();
+    }
+    return total;
+}
+
+void NDEFMessageCache::clear()
+{
+    for (int i = 0; i < ShardCount; i++)
+    {
+        QMutexLocker locker(&m_shards[i].mutex);
+        m_shards[i].clear();
+    }
+}
+
+quint64 NDEFMessageCache::hits() const
+{
+    quint64 total = 0;
+    for (int i = 0; i < ShardCount; i++)
+    {
+        QMutexLocker locker(&m_shards[i].mutex);
+        total += m_shards[i].hits;
+    }
+    return total;
+}
+
+quint64 NDEFMessageCache::misses() const
+{
+    quint64 total = 0;
+    for (int i = 0; i < ShardCount; i++)
+    {
+        QMutexLocker locker(&m_shards[i].mutex);
+        total += m_shards[i].misses;
+    }
+    return total;
+}
+
+quint64 NDEFMessageCache::evictions() const
+{
+    quint64 total = 0;
+    for (int i = 0; i < ShardCount; i++)
+    {
+        QMutexLocker locker(&m_shards[i].mutex);
+        total += m_shards[i].evictions;
+    }
+    return total;
+}
+
+quint64 NDEFMessageCache::skipped() const
+{
+    quint64 total = 0;
+    for (int i = 0; i < ShardCount; i++)
+    {
+        QMutexLocker locker(&m_shards[i].mutex);
+        total += m_shards[i].skipped;
+    }
+    return total;
+}
+
+void NDEFMessageCache::resetStatistics()
+{
+    for (int i = 0; i < ShardCount; i++)
+    {
+        QMutexLocker locker(&m_shards[i].mutex);
+        m_shards[i].hits = m_shards[i].misses = m_shards[i].evictions = m_shards[i].skipped = 0;
+    }
+}
+
+qint64 NDEFMessageCache::cost(const QByteArray& data, const NDEFMessage& msg)
+{
+    qint64 total = message_overhead + data.size();
+    for (int i = 0; i < msg.recordCount(); i++)
+    {
+        const NDEFRecord& record = msg.recordAt(i);
+        total += record_overhead + record.type().name().size() + record.id().size() + record.payload().size();
+    }
+    return total;
+}
@@ -0,0 +1,105 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefmessageframer.h"
+#include "ndefcore_p.h"
+
+NDEFMessageFramer::NDEFMessageFramer(int max_frame_size)
+    :   m_framer(0, std::size_t(qMax(0, max_frame_size))),
+        m_error(ndef::FrameComplete)
+{
+}
+
+NDEFMessageFramer::~NDEFMessageFramer()
+{
+}
+
+void NDEFMessageFramer::append(const QByteArray& data)
+{
+    // Only the bytes of the message being framed are moved.
+    const int consumed = int(m_framer.consumed());
+    if (consumed > 0)
+    {
+        m_buffer.remove(0, consumed);
+        m_framer.discard(std::size_t(consumed));
+    }
+    m_buffer.append(data);
+}
+
+NDEFMessageFramer::Status NDEFMessageFramer::next(int* offset, int* length)
+{
+    ndef::MessageFrame frame;
+    const ndef::FrameStatus status = m_framer.next(ndefBytes(m_buffer), frame);
+    if (status == ndef::FrameNeedMoreData)
+        return NeedMoreData;
+    if (status != ndef::FrameComplete)
+    {
+        m_error = status;
+        return FramingError;
+    }
+
+    if (offset)
+        *offset = int(frame.offset);
+    if (length)
+        *length = int(frame.size);
+    return MessageReady;
+}
+
+NDEFMessage NDEFMessageFramer::nextMessage(Status* status)
+{
+    int offset = 0;
+    int length = 0;
+    const Status result = next(&offset, &length);
+    if (status)
+        *status = result;
+    if (result != MessageReady)
+        return NDEFMessage();
+    return NDEFMessage::fromByteArray(messageBytes(offset, length));
+}
+
+bool NDEFMessageFramer::skip()
+{
+    return m_framer.skip(ndefBytes(m_buffer));
+}
+
+void NDEFMessageFramer::clear()
+{
+    m_buffer.clear();
+    m_framer.reset();
+    m_error = ndef::FrameComplete;
+}
+
+const QByteArray& NDEFMessageFramer::buffer() const
+{
+    return m_buffer;
+}
+
+QByteArray NDEFMessageFramer::messageBytes(int offset, int length) const
+{
+    Q_ASSERT(offset >= 0 && offset + length <= m_buffer.count());
+    return QByteArray::fromRawData(m_buffer.constData() + offset, length);
+}
+
+int NDEFMessageFramer::pendingBytes() const
+{
+    return m_buffer.count() - int(m_framer.consumed());
+}
+
+ndef::FrameStatus NDEFMessageFramer::error() const
+{
+    return m_error;
+}
@@ -0,0 +1,389 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefmetrics.h"
+#include "ndefmetrics_p.h"
+#include "ndefmessage.h"
+#include <cstring>
+
+#ifdef NDEF_METRICS
+#include "ndefcore_p.h"
+#include "core/record.h"
+#include <QtCore/QAtomicInteger>
+
+// Live counters, one copy per process. Each field mirrors the NDEFMetrics
+// member of the same name.
+static struct
+{
+    QAtomicInteger<quint64> messages[NDEFMetrics::OperationCount];
+    QAtomicInteger<quint64> bytes[NDEFMetrics::OperationCount];
+    QAtomicInteger<quint64> records[NDEFMetrics::OperationCount][8];
+    QAtomicInteger<quint64> wellKnownRecords[NDEFMetrics::OperationCount][NDEFMetrics::WellKnownTypeCount];
+    QAtomicInteger<quint64> payloadBytes[NDEFMetrics::OperationCount][8];
+    QAtomicInteger<quint64> wellKnownPayloadBytes[NDEFMetrics::OperationCount][NDEFMetrics::WellKnownTypeCount];
+    QAtomicInteger<quint64> rejections[NDEFMetrics::RejectReasonCount];
+    QAtomicInteger<quint64> chunkedRecords[NDEFMetrics::OperationCount];
+    QAtomicInteger<quint64> chunkSequences[NDEFMetrics::OperationCount];
+    QAtomicInteger<quint64> nestingDepths[NDEFMetrics::MaxNestingDepth + 1];
+    QAtomicInteger<quint64> latencyBuckets[NDEFMetrics::OperationCount][NDEFMetrics::LatencyBucketCount];
+    QAtomicInteger<quint64> latencySum[NDEFMetrics::OperationCount];
+} live;
+
+template <int N>
+static void loadCounters(quint64 (&to)[N], QAtomicInteger<quint64> (&from)[N])
+{
+    for (int i = 0; i < N; i++)
+        to[i] = from[i].loadAcquire();
+}
+
+template <int N>
+static void resetCounters(QAtomicInteger<quint64> (&counters)[N])
+{
+    for (int i = 0; i < N; i++)
+        counters[i].storeRelease(0);
+}
+
+static NDEFMetrics::WellKnownType wellKnownType(const QByteArray& name)
+{
+    if (name == "T")
+        return NDEFMetrics::Text;
+    if (name == "U")
+        return NDEFMetrics::Uri;
+    if (name == "Sp")
+        return NDEFMetrics::SmartPoster;
+    if (name == "Gc")
+        return NDEFMetrics::GenericControl;
+    return NDEFMetrics::OtherWellKnownType;
+}
+
+/* Returns how deep Smart Posters nest in data, a message found at depth.
+Only record headers are read, so that measuring a message does not decode
+(and count) its nested messages.
+*/
+static int nestingDepth(ndef::Bytes data, int depth)
+{
+    int deepest = depth;
+    for (const ndef::RecordView& record : ndef::RecordRange(data))
+    {
+        if (deepest >= NDEFMetrics::MaxNestingDepth)
+            break;
+        if (record.header.tnf == ndef::WellKnown && record.type.toStringView() == "Sp")
+            deepest = qMax(deepest, nestingDepth(record.payload, depth + 1));
+    }
+    return deepest;
+}
+
+void NDEFMetricsPrivate::countMessage(NDEFMetrics::Operation operation, const NDEFMessage& msg, qint64 bytes, qint64 nsecs)
+{
+    live.messages[operation].fetchAndAddRelaxed(1);
+    live.bytes[operation].fetchAndAddRelaxed(bytes);
+
+    int depth = 0;
+    bool in_chunk = false;
+    for (int i = 0; i < msg.recordCount(); i++)
+    {
+        const NDEFRecord& record = msg.recordAt(i);
+        const NDEFRecordType type = record.type();
+        const quint64 payload_bytes = quint64(record.payload().size());
+        live.records[operation][type.id()].fetchAndAddRelaxed(1);
+        live.payloadBytes[operation][type.id()].fetchAndAddRelaxed(payload_bytes);
+
+        if (type.id() == NDEFRecordType::NDEF_NfcForumRTD)
+        {
+            NDEFMetrics::WellKnownType well_known = wellKnownType(type.name());
+            live.wellKnownRecords[operation][well_known].fetchAndAddRelaxed(1);
+            live.wellKnownPayloadBytes[operation][well_known].fetchAndAddRelaxed(payload_bytes);
+            if (operation == NDEFMetrics::Decode && well_known == NDEFMetrics::SmartPoster)
+                depth = qMax(depth, nestingDepth(ndefBytes(record.payload()), 1));
+        }
+
+        // A chunk sequence ends with the first record without the CF flag.
+        if (record.isChuncked())
+        {
+            live.chunkedRecords[operation].fetchAndAddRelaxed(1);
+            in_chunk = true;
+        }
+        else if (in_chunk)
+        {
+            live.chunkSequences[operation].fetchAndAddRelaxed(1);
+            in_chunk = false;
+        }
+    }
+    if (operation == NDEFMetrics::Decode)
+        live.nestingDepths[depth].fetchAndAddRelaxed(1);
+
+    int bucket = 0;
+    while (bucket < NDEFMetrics::LatencyBucketCount - 1 && (quint64(1) << bucket) <= quint64(nsecs))
+        bucket++;
+    live.latencyBuckets[operation][bucket].fetchAndAddRelaxed(1);
+    live.latencySum[operation].fetchAndAddRelaxed(nsecs);
+}
+
+void NDEFMetricsPrivate::countRejection(NDEFMetrics::RejectReason reason)
+{
+    live.rejections[reason].fetchAndAddRelaxed(1);
+}
+#endif // NDEF_METRICS
+
+NDEFMetrics::NDEFMetrics()
+{
+    memset(m_messages, 0, sizeof(m_messages));
+    memset(m_bytes, 0, sizeof(m_bytes));
+    memset(m_records, 0, sizeof(m_records));
+    memset(m_wellKnownRecords, 0, sizeof(m_wellKnownRecords));
+    memset(m_payloadBytes, 0, sizeof(m_payloadBytes));
+    memset(m_wellKnownPayloadBytes, 0, sizeof(m_wellKnownPayloadBytes));
+    memset(m_rejections, 0, sizeof(m_rejections));
+    memset(m_chunkedRecords, 0, sizeof(m_chunkedRecords));
+    memset(m_chunkSequences, 0, sizeof(m_chunkSequences));
+    memset(m_nestingDepths, 0, sizeof(m_nestingDepths));
+    memset(m_latencyBuckets, 0, sizeof(m_latencyBuckets));
+    memset(m_latencySum, 0, sizeof(m_latencySum));
+}
+
+quint64 NDEFMetrics::messages(Operation operation) const
+{
+    return m_messages[operation];
+}
+
+quint64 NDEFMetrics::bytes(Operation operation) const
+{
+    return m_bytes[operation];
+}
+
+quint64 NDEFMetrics::records(Operation operation, NDEFRecordType::NDEFRecordTypeId tnf) const
+{
+    return m_records[operation][tnf & 0x07];
+}
+
+quint64 NDEFMetrics::wellKnownRecords(Operation operation, WellKnownType type) const
+{
+    return m_wellKnownRecords[operation][type];
+}
+
+quint64 NDEFMetrics::payloadBytes(Operation operation, NDEFRecordType::NDEFRecordTypeId tnf) const
+{
+    return m_payloadBytes[operation][tnf & 0x07];
+}
+
+quint64 NDEFMetrics::wellKnownPayloadBytes(Operation operation, WellKnownType type) const
+{
+    return m_wellKnownPayloadBytes[operation][type];
+}
+
+quint64 NDEFMetrics::rejections(RejectReason reason) const
+{
+    return m_rejections[reason];
+}
+
+quint64 NDEFMetrics::chunkedRecords(Operation operation) const
+{
+    return m_chunkedRecords[operation];
+}
+
+quint64 NDEFMetrics::chunkSequences(Operation operation) const
+{
+    return m_chunkSequences[operation];
+}
+
+quint64 NDEFMetrics::nestingDepth(int depth) const
+{
+    if (depth < 0 || depth > MaxNestingDepth)
+        return 0;
+    return m_nestingDepths[depth];
+}
+
+quint64 NDEFMetrics::latencyBucket(Operation operation, int bucket) const
+{
+    if (bucket < 0 || bucket >= LatencyBucketCount)
+        return 0;
+    return m_latencyBuckets[operation][bucket];
+}
+
+quint64 NDEFMetrics::latencySum(Operation operation) const
+{
+    return m_latencySum[operation];
+}
+
+/* Formats the snapshot in the Prometheus text exposition format, every
+metric name starting with prefix. Latencies are exported as histograms in
+seconds, with power of two buckets.
+*/
+QByteArray NDEFMetrics::toPrometheus(const QByteArray& prefix) const
+{
+    static const char* const operations[OperationCount] = { "decode", "encode" };
+    static const char* const tnfs[8] = {
+        "empty", "well_known", "mime", "uri", "external", "unknown", "unchanged", "reserved"
+    };
+    static const char* const well_known_types[WellKnownTypeCount] = { "T", "U", "Sp", "Gc", "other" };
+    static const char* const reasons[RejectReasonCount] = {
+        "empty_input", "truncated_header", "truncated_record", "reserved_tnf"
+    };
+
+    QByteArray output;
+    QByteArray name;
+
+    // 1) Messages and bytes.
+    name = prefix + "_messages_total";
+    output += "# HELP " + name + " NDEF messages decoded or encoded.\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; op++)
+        output += name + "{operation=\"" + operations[op] + "\"} " + QByteArray::number(m_messages[op]) + "\n";
+
+    name = prefix + "_bytes_total";
+    output += "# HELP " + name + " Bytes of NDEF messages decoded or encoded.\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; op++)
+        output += name + "{operation=\"" + operations[op] + "\"} " + QByteArray::number(m_bytes[op]) + "\n";
+
+    // 2) Records and their payload bytes per TNF and per well-known type.
+    name = prefix + "_records_total";
+    output += "# HELP " + name + " NDEF records decoded or encoded, per type name format.\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; op++)
+        for (int tnf = 0; tnf < 8; tnf++)
+            output += name + "{operation=\"" + operations[op] + "\",tnf=\"" + tnfs[tnf] + "\"} "
+                    + QByteArray::number(m_records[op][tnf]) + "\n";
+
+    name = prefix + "_well_known_records_total";
+    output += "# HELP " + name + " NFC Forum well-known records decoded or encoded, per type.\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; op++)
+        for (int type = 0; type < WellKnownTypeCount; type++)
+            output += name + "{operation=\"" + operations[op] + "\",type=\"" + well_known_types[type] + "\"} "
+                    + QByteArray::number(m_wellKnownRecords[op][type]) + "\n";
+
+    name = prefix + "_payload_bytes_total";
+    output += "# HELP " + name + " Payload bytes of the records decoded or encoded, per type name format.\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; op++)
+        for (int tnf = 0; tnf < 8; tnf++)
+            output += name + "{operation=\"" + operations[op] + "\",tnf=\"" + tnfs[tnf] + "\"} "
+                    + QByteArray::number(m_payloadBytes[op][tnf]) + "\n";
+
+    name = prefix + "_well_known_payload_bytes_total";
+    output += "# HELP " + name + " Payload bytes of the NFC Forum well-known records decoded or encoded, per type.\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; op++)
+        for (int type = 0; type < WellKnownTypeCount; type++)
+            output += name + "{operation=\"" + operations[op] + "\",type=\"" + well_known_types[type] + "\"} "
+                    + QByteArray::number(m_wellKnownPayloadBytes[op][type]) + "\n";
+
+    // 3) Rejections.
+    name = prefix + "_rejections_total";
+    output += "# HELP " + name + " Inputs on which decoding stopped early, per reason.\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int reason = 0; reason < RejectReasonCount; reason++)
+        output += name + "{reason=\"" + reasons[reason] + "\"} " + QByteArray::number(m_rejections[reason]) + "\n";
+
+    // 4) Chunks and nesting.
+    name = prefix + "_chunked_records_total";
+    output += "# HELP " + name + " Records with the CF flag set.\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; op++)
+        output += name + "{operation=\"" + operations[op] + "\"} " + QByteArray::number(m_chunkedRecords[op]) + "\n";
+
+    name = prefix + "_chunk_sequences_total";
+    output += "# HELP " + name + " Complete chunked payloads (chunk sequences ended by their last chunk).\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int op = 0; op < OperationCount; op++)
+        output += name + "{operation=\"" + operations[op] + "\"} " + QByteArray::number(m_chunkSequences[op]) + "\n";
+
+    name = prefix + "_decoded_messages_by_nesting_depth_total";
+    output += "# HELP " + name + " Decoded messages per Smart Poster nesting depth (the last one counts deeper ones).\n";
+    output += "# TYPE " + name + " counter\n";
+    for (int depth = 0; depth <= MaxNestingDepth; depth++)
+        output += name + "{depth=\"" + QByteArray::number(depth) + "\"} " + QByteArray::number(m_nestingDepths[depth]) + "\n";
+
+    // 5) Latencies.
+    name = prefix + "_latency_seconds";
+    output += "# HELP " + name + " Time spent decoding or encoding a message.\n";
+    output += "# TYPE " + name + " histogram\n";
+    for (int op = 0; op < OperationCount; op++)
+    {
+        quint64 count = 0;
+        for (int bucket = 0; bucket < LatencyBucketCount - 1; bucket++)
+        {
+            count += m_latencyBuckets[op][bucket];
+            output += name + "_bucket{operation=\"" + operations[op] + "\",le=\""
+                    + QByteArray::number(double(quint64(1) << bucket) / 1e9, 'g', 9) + "\"} "
+                    + QByteArray::number(count) + "\n";
+        }
+        count += m_latencyBuckets[op][LatencyBucketCount - 1];
+        output += name + "_bucket{operation=\"" + operations[op] + "\",le=\"+Inf\"} " + QByteArray::number(count) + "\n";
+        output += name + "_sum{operation=\"" + operations[op] + "\"} "
+                + QByteArray::number(double(m_latencySum[op]) / 1e9, 'g', 9) + "\n";
+        output += name + "_count{operation=\"" + operations[op] + "\"} " + QByteArray::number(count) + "\n";
+    }
+
+    return output;
+}
+
+bool NDEFMetrics::isEnabled()
+{
+#ifdef NDEF_METRICS
+    return true;
+#else
+    return false;
+#endif
+}
+
+NDEFMetrics NDEFMetrics::snapshot()
+{
+    NDEFMetrics metrics;
+
+#ifdef NDEF_METRICS
+    loadCounters(metrics.m_messages, live.messages);
+    loadCounters(metrics.m_bytes, live.bytes);
+    loadCounters(metrics.m_rejections, live.rejections);
+    loadCounters(metrics.m_chunkedRecords, live.chunkedRecords);
+    loadCounters(metrics.m_chunkSequences, live.chunkSequences);
+    loadCounters(metrics.m_nestingDepths, live.nestingDepths);
+    loadCounters(metrics.m_latencySum, live.latencySum);
+    for (int op = 0; op < OperationCount; op++)
+    {
+        loadCounters(metrics.m_records[op], live.records[op]);
+        loadCounters(metrics.m_wellKnownRecords[op], live.wellKnownRecords[op]);
+        loadCounters(metrics.m_payloadBytes[op], live.payloadBytes[op]);
+        loadCounters(metrics.m_wellKnownPayloadBytes[op], live.wellKnownPayloadBytes[op]);
+        loadCounters(metrics.m_latencyBuckets[op], live.latencyBuckets[op]);
+    }
+#endif
+
+    return metrics;
+}
+
+void NDEFMetrics::reset()
+{
+#ifdef NDEF_METRICS
+    resetCounters(live.messages);
+    resetCounters(live.bytes);
+    resetCounters(live.rejections);
+    resetCounters(live.chunkedRecords);
+    resetCounters(live.chunkSequences);
+    resetCounters(live.nestingDepths);
+    resetCounters(live.latencySum);
+    for (int op = 0; op < OperationCount; op++)
+    {
+        resetCounters(live.records[op]);
+        resetCounters(live.wellKnownRecords[op]);
+        resetCounters(live.payloadBytes[op]);
+        resetCounters(live.wellKnownPayloadBytes[op]);
+        resetCounters(live.latencyBuckets[op]);
+    }
+#endif
+}
@@ -0,0 +1,53 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFMETRICS_P_H
+#define NDEFMETRICS_P_H
+
+// Not part of the public API: hooks used by the library to feed NDEFMetrics.
+// They expand to nothing unless the library is built with NDEF_METRICS.
+
+#include "ndefmetrics.h"
+
+#ifdef NDEF_METRICS
+
+#include <QtCore/QElapsedTimer>
+
+class NDEFMessage;
+
+namespace NDEFMetricsPrivate
+{
+    void countMessage(NDEFMetrics::Operation operation, const NDEFMessage& msg, qint64 bytes, qint64 nsecs);
+    void countRejection(NDEFMetrics::RejectReason reason);
+}
+
+#define NDEF_METRICS_TIMER(timer) \
+    QElapsedTimer timer; timer.start()
+#define NDEF_METRICS_MESSAGE(operation, msg, bytes, timer) \
+    NDEFMetricsPrivate::countMessage(NDEFMetrics::operation, msg, bytes, timer.nsecsElapsed())
+#define NDEF_METRICS_REJECT(reason) \
+    NDEFMetricsPrivate::countRejection(NDEFMetrics::reason)
+
+#else
+
+#define NDEF_METRICS_TIMER(timer)
+#define NDEF_METRICS_MESSAGE(operation, msg, bytes, timer) do {} while (0)
+#define NDEF_METRICS_REJECT(reason) do {} while (0)
+
+#endif // NDEF_METRICS
+
+#endif // NDEFMETRICS_P_H
@@ -18,19 +18,43 @@
  */
 
 #include "ndefrecord.h"
+#include "ndefcore_p.h"
+#include "ndeftrace_p.h"
+#include "core/handover.h"
+#include "core/hash.h"
+#include "core/record.h"
+#include "core/signature.h"
+#include "core/text.h"
+#include "core/uri.h"
 #include <QtCore/QBuffer>
 #include <QtCore/QDataStream>
-#include <QtCore/QStringList>
 #include <QtCore/QTextCodec>
+#include <string.h>
 
 NDEFRecord::NDEFRecord()
-    :   m_chuncked(false)
+    :   m_chuncked(false),
+        m_hashLow(0),
+        m_hashHigh(0)
 {
 }
 
+NDEFRecord::NDEFRecord(const NDEFRecord& record)
+    :   m_type(record.m_type),
+        m_id(record.m_id),
+        m_payload(record.m_payload),
+        m_chuncked(record.m_chuncked),
+        m_hashLow(0),
+        m_hashHigh(0)
+{
+    if (const quint64 hash = record.cachedHash())
+        storeHash(hash);
+}
+
 NDEFRecord::NDEFRecord(const QByteArray& data, const NDEFRecordType& type, int offset, bool chuncked)
         :   m_type(type),
-            m_chuncked(chuncked)
+            m_chuncked(chuncked),
+            m_hashLow(0),
+            m_hashHigh(0)
 {
     this->setPayload(data.right(data.size() - offset));
 }
@@ -38,7 +62,9 @@ NDEFRecord::NDEFRecord(const QByteArray& data, const NDEFRecordType& type, int o
 NDEFRecord::NDEFRecord(const NDEFRecordType& type, const QByteArray& id, const QByteArray& payload, bool chuncked)
         :   m_type(type),
             m_id(id),
-            m_chuncked(chuncked)
+            m_chuncked(chuncked),
+            m_hashLow(0),
+            m_hashHigh(0)
 {
     this->setPayload(payload);
 }
@@ -47,6 +73,68 @@ NDEFRecord::~NDEFRecord()
 {
 }
 
+NDEFRecord& NDEFRecord::operator=(const NDEFRecord& record)
+{
+    m_type = record.m_type;
+    m_id = record.m_id;
+    m_payload = record.m_payload;
+    m_chuncked = record.m_chuncked;
+    const quint64 hash = record.cachedHash();
+    if (hash)
+        storeHash(hash);
+    else
+        m_hashHigh.store(0, std::memory_order_relaxed);
+    return *this;
+}
+
+bool NDEFRecord::operator==(const NDEFRecord& record) const
+{
+    // Hashes already computed tell most different records apart at once.
+    const quint64 hash = cachedHash();
+    const quint64 other_hash = record.cachedHash();
+    if (hash && other_hash && hash != other_hash)
+        return false;
+
+    return m_chuncked == record.m_chuncked
+        && m_type == record.m_type
+        && m_id == record.m_id
+        && m_payload == record.m_payload;
+}
+
+bool NDEFRecord::operator!=(const NDEFRecord& record) const
+{
+    return !(*this == record);
+}
+
+quint64 NDEFRecord::hash() const
+{
+    // Threads racing here compute and store the same value.
+    quint64 hash = cachedHash();
+    if (!hash)
+    {
+        // The top bit is set, so that a high half of 0 means "not computed".
+        hash = ndef::hash64(ndefBytes(m_payload), ndef::hash64(ndefBytes(m_id), m_type.hash()));
+        hash |= Q_UINT64_C(1) << 63;
+        storeHash(hash);
+    }
+    return hash;
+}
+
+quint64 NDEFRecord::cachedHash() const
+{
+    // The low half is stored first, and published by the high one.
+    const quint32 high = m_hashHigh.load(std::memory_order_acquire);
+    if (!high)
+        return 0;
+    return (quint64(high) << 32) | m_hashLow.load(std::memory_order_relaxed);
+}
+
+void NDEFRecord::storeHash(quint64 hash) const
+{
+    m_hashLow.store(quint32(hash), std::memory_order_relaxed);
+    m_hashHigh.store(quint32(hash >> 32), std::memory_order_release);
+}
+
 void NDEFRecord::setId(const QByteArray& id)
 {
     m_id = id;
@@ -136,40 +224,21 @@ int NDEFRecord::payloadLength() const
     return m_payload.count();
 }
 
-QByteArray NDEFRecord::toByteArray(int flags) const
+// The type and ID written for the record's TNF; false if it has none (NDEF_Invalid).
+bool NDEFRecord::encodedParts(const NDEFRecord& record, QByteArray& type_name, QByteArray& id)
 {
-    QByteArray byte_array;
-    QBuffer buffer(&byte_array);
-    buffer.open(QIODevice::WriteOnly);
-    QDataStream out(&buffer);
-    
-    // 1) Flags (5 bits) + TNF (3 bits)
-    quint8 final_flags = (flags | this->flags());
-    quint8 byte = (final_flags & 0xF8) | m_type.id();
-    out << byte;
-    
-    // 2) Type length, payload length, ID length, type, ID and payload.
-    switch (m_type.id())
+    switch (record.m_type.id())
     {
         // NDEF_Empty:
         // -- Type length = 0 (8 bits)
         // -- Payload length = 0 (8 bits)
-        // -- ID length = 0 (8 bits)
+        // -- ID length = 0 (8 bits, only when there is an ID)
         // -- No type
         // -- No ID
         // -- No payload
         case NDEFRecordType::NDEF_Empty:
-        {
-            out << (quint8)0;
-            out << (quint8)0;
+            break;
 
-            // ID length field is present, only when it's non-zero
-            if (m_id.count() != 0){
-                out << (quint8)0;
-            }
-        }
-        break;
-        
         // NDEF_NfcForumRTD, NDEF_MIME, NDEF_URI, NDEF_ExternalRTD:
         // -- Type length = 8 bits
         // -- Payload length = 8 or 32 bits
@@ -181,69 +250,89 @@ QByteArray NDEFRecord::toByteArray(int flags) const
         case NDEFRecordType::NDEF_MIME:
         case NDEFRecordType::NDEF_URI:
         case NDEFRecordType::NDEF_ExternalRTD:
-        {
-            QByteArray type_name = m_type.name();
-            
-            out << (quint8)type_name.count();
-            if (this->isShort())
-            {
-                // Payload length
-                out << (quint8)m_payload.count();
-                // ID Length (optional)
-                if (m_id.count() != 0) {
-                    out << (quint8)m_id.count();
-                }
-                byte_array.append(type_name);
-                byte_array.append(m_id);
-                byte_array.append(m_payload);
-            }
-            else
-            {
-                // Payload length
-                out << (quint32)m_payload.count();
-                // ID Length (optional)
-                if (m_id.count() != 0) {
-                    out << (quint8)m_id.count();
-                }
-                byte_array.append(type_name);
-                byte_array.append(m_id);
-                byte_array.append(m_payload);
-            }
-        }
-        break;
-        
+            type_name = record.m_type.name();
+            id = record.m_id;
+            break;
+
         // NDEF_Unknown, NDEF_Unchanged:
         // -- Type length = 0 (8 bits)
-        // -- Payload length = 32 bits
+        // -- Payload length = 8 or 32 bits
         // -- ID length = N bits (optional)
         // -- No type
         // -- ID = (id length) bytes
         // -- Payload = (payload length) bytes
         case NDEFRecordType::NDEF_Unknown:
         case NDEFRecordType::NDEF_Unchanged:
-        {
-            out << (quint8)0;
-            out << (quint32)m_payload.count();
-            if (m_id.count() != 0) {
-                out << (quint8)m_id.count();
-            }
-            byte_array.append(m_id);
-            byte_array.append(m_payload);
-        }
-        break;
+            id = record.m_id;
+            break;
 
         // NDEF Invalid: empty buffer.
         case NDEFRecordType::NDEF_Invalid:
-            return QByteArray();
+            return false;
     }
 
-    return buffer.data();
+    return true;
+}
+
+int NDEFRecord::encodedSize(int flags) const
+{
+    QByteArray type_name;
+    QByteArray id;
+    if (!encodedParts(*this, type_name, id))
+        return 0;
+    return int(ndef::encodedRecordLength((flags | this->flags()) & 0xF8, type_name.count(), id.count(), m_payload.count()));
+}
+
+int NDEFRecord::writeHeaderTo(char* out, int flags) const
+{
+    // 1) Flags (5 bits) + TNF (3 bits)
+    quint8 final_flags = (flags | this->flags()) & 0xF8;
+
+    // 2) Type length, payload length, ID length, type and ID.
+    QByteArray type_name;
+    QByteArray id;
+    if (!encodedParts(*this, type_name, id))
+        return 0;
+
+    // The SR flag is set from isShort(), so the payload length follows it.
+    uchar* const begin = reinterpret_cast<uchar*>(out);
+    uchar* position = begin + ndef::encodeHeader(begin, final_flags, ndef::TypeNameFormat(m_type.id()),
+                                                 quint8(type_name.count()), quint32(m_payload.count()), quint8(id.count()));
+    position = ndef::copyBytes(position, ndefBytes(type_name));
+    position = ndef::copyBytes(position, ndefBytes(id));
+
+    const int length = int(position - begin);
+    NDEF_TRACE3(record__encode, m_type.id(), m_payload.count(), length + m_payload.count());
+    return length;
+}
+
+int NDEFRecord::writeTo(char* out, int flags) const
+{
+    const int header_length = writeHeaderTo(out, flags);
+    if (header_length == 0)
+        return 0;
+
+    // 3) Payload.
+    memcpy(out + header_length, m_payload.constData(), size_t(m_payload.count()));
+    return header_length + m_payload.count();
+}
+
+QByteArray NDEFRecord::toByteArray(int flags) const
+{
+    QByteArray byte_array;
+    byte_array.resize(encodedSize(flags));
+    if (!byte_array.isEmpty())
+        writeTo(byte_array.data(), flags);
+    return byte_array;
 }
 
 void NDEFRecord::checkConsistency()
 {
     int payload_size = m_payload.count();
 
+    // Every change of the type, ID or payload ends here.
+    m_hashHigh.store(0, std::memory_order_relaxed);
+
     // Check the record type.
     if (payload_size > 0 && (m_type.id() == NDEFRecordType::NDEF_Empty))
         m_type = NDEFRecordType(NDEFRecordType::NDEF_Unknown);
@@ -251,66 +340,52 @@ void NDEFRecord::checkConsistency()
 
 NDEFRecord NDEFRecord::fromByteArray(const QByteArray& data, int offset)
 {
-    NDEFRecordType type = NDEFRecordType::fromByteArray(data, offset);
-
-    // 1) Type.
     NDEFRecord record;
-    record.setType(type);
+    const ndef::Bytes bytes = ndefBytes(data);
 
-    if (type.id() != NDEFRecordType::NDEF_Invalid)
+    // 1) Type.
+    if (offset < 0 || !ndef::hasRecord(bytes, offset))
     {
-        QByteArray data_buffer = data.right(data.count() - offset);
-        QBuffer buffer(&data_buffer);
-        buffer.open(QIODevice::ReadOnly);
-        QDataStream stream(&buffer);
-        quint8 byte;
-
-        // 2) Flags.
-        stream >> byte;
-        quint8 flags = (quint8)byte;
-        bool cf = flags & NDEFRecord::NDEF_CF;
-        bool sr = flags & NDEFRecord::NDEF_SR;
-        bool il = flags & NDEFRecord::NDEF_IL;
-        record.setChuncked(cf);
-
-        // 3) Type length.
-        stream >> byte;
-        quint8 type_length = (quint8)byte;
-
-        // 3) Payload length.
-        quint32 payload_length = 0;
-        if (sr)
-        {
-            stream >> byte;
-            payload_length = (quint32)byte;
-        }
-        else
-        {
-            stream >> payload_length;
-        }
-        
-        // 5) ID.
-        quint8 id_length = 0;
-        if (il)
-        {
-            stream >> byte;
-            id_length = (quint8)byte;
-        }
-        
-        // 4) Skip type bytes.
-        stream.skipRawData(type_length);
-        if (il)
-        {
-            record.setId(buffer.read(id_length));
-        }
-
-        // 6) Payload.
-        record.setPayload(buffer.read(payload_length));
+        record.setType(NDEFRecordType(NDEFRecordType::NDEF_Invalid));
+        return record;
     }
 
+    // Read in place: only the type, ID and payload are copied out of data.
+    const ndef::RecordView view = ndef::decodeRecord(bytes, offset);
+    NDEF_TRACE5(record__header, offset, view.header.tnf, view.header.typeLength,
+                view.header.payloadLength, view.header.idLength);
+    record.setType(NDEFRecordType(NDEFRecordType::NDEFRecordTypeId(view.header.tnf), ndefByteArray(view.type)));
+
+    // 2) Flags.
+    record.setChuncked(view.header.isChunk());
+
+    // 3) ID.
+    if (view.header.hasId())
+        record.setId(ndefByteArray(view.id));
+
+    // 4) Payload.
+    record.setPayload(ndefByteArray(view.payload));
+
+    NDEF_TRACE5(record__done, offset, view.header.tnf, view.size(), view.type.data(), view.type.size());
+    if (view.header.isChunk() || view.header.tnf == ndef::Unchanged)
+        NDEF_TRACE4(chunk, offset, view.header.tnf, view.payload.size(), !view.header.isChunk());
+
     return record;
 }
 
+/* Returns the size in bytes of the record encoded at offset, as declared by
+its header, or -1 if data does not hold the whole record (yet). Only the
+header is read, so it can be used to walk a buffer without decoding it.
+*/
+int NDEFRecord::recordLength(const QByteArray& data, int offset)
+{
+    if (offset < 0)
+        return -1;
+
+    std::size_t length = ndef::recordLength(ndefBytes(data), offset);
+    return (length > 0) ? int(length) : -1;
+}
+
 NDEFRecord NDEFRecord::createMimeRecord(const QString& mime_type, const QByteArray& payload)
 {
     NDEFRecord record;
@@ -340,10 +415,7 @@ NDEFRecord NDEFRecord::createTextRecord(const QString& text, const QString& loca
 
     // 2) Payload.
     QByteArray payload;
-    unsigned char status_byte = 0;
-    status_byte |= locale_size;
-    status_byte |= (unsigned char)codec;
-    payload.append(status_byte);
+    payload.append(char(ndef::textStatusByte(codec == NDEF_UTF16, locale_size)));
     payload.append(locale.left(locale_size));
     if (codec == NDEF_UTF16)
     {
@@ -366,24 +438,21 @@ NDEFRecord NDEFRecord::createTextRecord(const QString& text, const QString& loca
 
 QByteArray NDEFRecord::textLocale(const QByteArray& payload)
 {
-    int locale_length = payload.at(0) & 0x1f;
-    return payload.mid(1, locale_length);
+    return ndefByteArray(ndef::decodeText(ndefBytes(payload)).locale);
 }
 
 QString NDEFRecord::textText(const QByteArray& payload)
 {
-    const unsigned char status_byte = payload.at(0);
-    const unsigned char locale_length = status_byte & 0x1f;
-    const QByteArray encoded_text = payload.right(payload.size() - (1 + locale_length));
-    if (status_byte & NDEF_UTF16) // UTF-16 case
+    const ndef::TextView text = ndef::decodeText(ndefBytes(payload));
+    const char* encoded_text = reinterpret_cast<const char*>(text.text.data());
+    if (text.utf16) // UTF-16 case
     {
         QTextCodec *codec = QTextCodec::codecForName("UTF-16BE");
-        QString text = codec->toUnicode(encoded_text);
-        return text;
+        return codec->toUnicode(encoded_text, int(text.text.size()));
     }
     else
     {
-        return QString::fromUtf8 (encoded_text.data(), encoded_text.size());
+        return QString::fromUtf8 (encoded_text, int(text.text.size()));
     }
 }
 
@@ -392,67 +461,17 @@ NDEFRecord NDEFRecord::createUriRecord(const QString& uri)
 {
     NDEFRecord record;
 
-    int uri_size = uri.count();
-
     // 1) Type.
     record.setType(NDEFRecordType::uriRecordType());
 
-    // 2) Payload.
-    QByteArray payload;
-
-    QStringList uri_identifiers;
-    uri_identifiers.append("http://www.");
-    uri_identifiers.append("https://www.");
-    uri_identifiers.append("http://");
-    uri_identifiers.append("https://");
-    uri_identifiers.append("tel:");
-    uri_identifiers.append("mailto:");
-    uri_identifiers.append("ftp://anonymous:anonymous@");
-    uri_identifiers.append("ftp://ftp.");
-    uri_identifiers.append("ftps://");
-    uri_identifiers.append("sftp://");
-    uri_identifiers.append("smb://");
-    uri_identifiers.append("nfs://");
-    uri_identifiers.append("ftp://");
-    uri_identifiers.append("dav://");
-    uri_identifiers.append("news:");
-    uri_identifiers.append("telnet://");
-    uri_identifiers.append("imap:");
-    uri_identifiers.append("rtsp://");
-    uri_identifiers.append("urn:");
-    uri_identifiers.append("pop:");
-    uri_identifiers.append("sip:");
-    uri_identifiers.append("sips:");
-    uri_identifiers.append("tftp:");
-    uri_identifiers.append("btspp://");
-    uri_identifiers.append("btl2cap://");
-    uri_identifiers.append("btgoep://");
-    uri_identifiers.append("tcpobex://");
-    uri_identifiers.append("irdaobex://");
-    uri_identifiers.append("file://");
-    uri_identifiers.append("urn:epc:id:");
-    uri_identifiers.append("urn:epc:tag:");
-    uri_identifiers.append("urn:epc:pat:");
-    uri_identifiers.append("urn:epc:raw:");
-    uri_identifiers.append("urn:epc:");
-    uri_identifiers.append("urn:nfc:");
-
-    int num_identifiers = uri_identifiers.count();
-    char uri_identifier = 0;
-    int uri_identifier_size = 0;
-    for (int i = 0; i < num_identifiers; i++)
-    {
-        QString identifier = uri_identifiers.at(i);
-        int size = identifier.count();
-        if ((size > uri_identifier_size) && uri.startsWith(identifier))
-        {
-            uri_identifier_size = size;
-            uri_identifier = i+1;
-        }
-    }
+    // 2) Payload: the identifier code of the longest matching prefix, then
+    // the rest of the URI.
+    const QByteArray encoded_uri = uri.toUtf8();
+    const std::uint8_t uri_identifier = ndef::uriPrefixCode(ndefBytes(encoded_uri).toStringView());
 
-    payload.append(uri_identifier);
-    payload.append(uri.right(uri_size - uri_identifier_size).toUtf8());
+    QByteArray payload;
+    payload.append(char(uri_identifier));
+    payload.append(encoded_uri.mid(int(ndef::uriPrefix(uri_identifier).size())));
     record.setPayload(payload);
 
     return record;
@@ -460,53 +479,7 @@ NDEFRecord NDEFRecord::createUriRecord(const QString& uri)
 
 QByteArray NDEFRecord::uriProtocol(const QByteArray& payload)
 {
-    QStringList uri_identifiers;
-    uri_identifiers.append("http://www.");
-    uri_identifiers.append("https://www.");
-    uri_identifiers.append("http://");
-    uri_identifiers.append("https://");
-    uri_identifiers.append("tel:");
-    uri_identifiers.append("mailto:");
-    uri_identifiers.append("ftp://anonymous:anonymous@");
-    uri_identifiers.append("ftp://ftp.");
-    uri_identifiers.append("ftps://");
-    uri_identifiers.append("sftp://");
-    uri_identifiers.append("smb://");
-    uri_identifiers.append("nfs://");
-    uri_identifiers.append("ftp://");
-    uri_identifiers.append("dav://");
-    uri_identifiers.append("news:");
-    uri_identifiers.append("telnet://");
-    uri_identifiers.append("imap:");
-    uri_identifiers.append("rtsp://");
-    uri_identifiers.append("urn:");
-    uri_identifiers.append("pop:");
-    uri_identifiers.append("sip:");
-    uri_identifiers.append("sips:");
-    uri_identifiers.append("tftp:");
-    uri_identifiers.append("btspp://");
-    uri_identifiers.append("btl2cap://");
-    uri_identifiers.append("btgoep://");
-    uri_identifiers.append("tcpobex://");
-    uri_identifiers.append("irdaobex://");
-    uri_identifiers.append("file://");
-    uri_identifiers.append("urn:epc:id:");
-    uri_identifiers.append("urn:epc:tag:");
-    uri_identifiers.append("urn:epc:pat:");
-    uri_identifiers.append("urn:epc:raw:");
-    uri_identifiers.append("urn:epc:");
-    uri_identifiers.append("urn:nfc:");
-
-    int protocol_index = payload.at(0);
-    if (protocol_index > 0 && protocol_index <= uri_identifiers.count()){
-#if (QT_VERSION < QT_VERSION_CHECK(5, 0, 0))
-        return uri_identifiers.at(protocol_index-1).toAscii();
-#else
-        return uri_identifiers.at(protocol_index-1).toLatin1();
-#endif
-    }
-
-    return QByteArray();
+    return ndefByteArray(ndef::decodeUri(ndefBytes(payload)).prefix);
 }
 
 NDEFRecord NDEFRecord::createSmartPosterRecord(const QString& uri)
@@ -928,3 +901,245 @@ NDEFRecord NDEFRecord::createGcDataRecord(const NDEFRecord& data)
 
     return record;
 }
+
+// Encodes records as a message: MB on the first one, ME on the last one.
+static QByteArray localMessage(const QList<NDEFRecord>& records)
+{
+    QByteArray message;
+    int record_count = records.count();
+    for (int i = 0; i < record_count; i++)
+    {
+        int flags = ((i == 0) ? NDEFRecord::NDEF_MB : 0) | ((i == record_count - 1) ? NDEFRecord::NDEF_ME : 0);
+        message.append(records.at(i).toByteArray(flags));
+    }
+    return message;
+}
+
+// Appends an EIR/AD structure, unless value is empty. Returns false if value
+// does not fit one, or is not length bytes long when length is given.
+static bool appendBluetoothData(QByteArray& data, quint8 type, const QByteArray& value, int length = 0)
+{
+    if (value.isEmpty())
+        return true;
+    if (value.size() > 0xFE || (length > 0 && value.size() != length))
+        return false;
+    data.append(char(value.size() + 1));
+    data.append(char(type));
+    data.append(value);
+    return true;
+}
+
+// Bluetooth addresses go least significant byte first on the wire.
+static QByteArray bluetoothAddress(const QByteArray& address)
+{
+    QByteArray reversed;
+    for (int i = address.size() - 1; i >= 0; i--)
+        reversed.append(address.at(i));
+    return reversed;
+}
+
+NDEFRecord NDEFRecord::createHandoverSelectRecord(const QList<NDEFRecord>& alternative_carriers, quint8 version)
+{
+    NDEFRecord record;
+
+    // 1) Type.
+    record.setType(NDEFRecordType::handoverSelectRecordType());
+
+    // 2) Payload: the version, then the Alternative Carrier records.
+    QByteArray payload;
+    payload.append(char(version));
+    payload.append(localMessage(alternative_carriers));
+    record.setPayload(payload);
+
+    return record;
+}
+
+NDEFRecord NDEFRecord::createHandoverRequestRecord(quint16 random_number, const QList<NDEFRecord>& alternative_carriers, quint8 version)
+{
+    // A request needs at least one carrier.
+    if (alternative_carriers.isEmpty())
+        return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+
+    NDEFRecord record;
+
+    // 1) Type.
+    record.setType(NDEFRecordType::handoverRequestRecordType());
+
+    // 2) Payload: the version, the Collision Resolution record, then the
+    // Alternative Carrier records.
+    QList<NDEFRecord> records;
+    records << NDEFRecord::createCollisionResolutionRecord(random_number) << alternative_carriers;
+
+    QByteArray payload;
+    payload.append(char(version));
+    payload.append(localMessage(records));
+    record.setPayload(payload);
+
+    return record;
+}
+
+NDEFRecord NDEFRecord::createAlternativeCarrierRecord(NDEFCarrierPowerState power_state, const QByteArray& carrier_data_reference, const QList<QByteArray>& auxiliary_data_references)
+{
+    if (carrier_data_reference.isEmpty() || carrier_data_reference.size() > 0xFF || auxiliary_data_references.count() > 0xFF)
+        return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+
+    NDEFRecord record;
+
+    // 1) Type.
+    record.setType(NDEFRecordType::alternativeCarrierRecordType());
+
+    // 2) Payload.
+    QByteArray payload;
+
+    // 2.1) Carrier power state.
+    payload.append(char(power_state & 0x03));
+
+    // 2.2) Carrier data reference.
+    payload.append(char(carrier_data_reference.size()));
+    payload.append(carrier_data_reference);
+
+    // 2.3) Auxiliary data references.
+    payload.append(char(auxiliary_data_references.count()));
+    for (int i = 0; i < auxiliary_data_references.count(); i++)
+    {
+        const QByteArray& reference = auxiliary_data_references.at(i);
+        if (reference.size() > 0xFF)
+            return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+        payload.append(char(reference.size()));
+        payload.append(reference);
+    }
+    record.setPayload(payload);
+
+    return record;
+}
+
+NDEFRecord NDEFRecord::createCollisionResolutionRecord(quint16 random_number)
+{
+    NDEFRecord record;
+
+    // 1) Type.
+    record.setType(NDEFRecordType::collisionResolutionRecordType());
+
+    // 2) Payload.
+    QByteArray payload;
+    QBuffer buffer(&payload);
+    buffer.open(QIODevice::WriteOnly);
+    QDataStream stream(&buffer);
+    stream << random_number;
+    record.setPayload(payload);
+
+    return record;
+}
+
+NDEFRecord NDEFRecord::createHandoverCarrierRecord(const NDEFRecordType& carrier_type, const QByteArray& carrier_data)
+{
+    const QByteArray type_name = carrier_type.name();
+    if (type_name.size() > 0xFF || carrier_type.id() == NDEFRecordType::NDEF_Invalid)
+        return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+
+    NDEFRecord record;
+
+    // 1) Type.
+    record.setType(NDEFRecordType::handoverCarrierRecordType());
+
+    // 2) Payload: carrier type format, carrier type and carrier data.
+    QByteArray payload;
+    payload.append(char(carrier_type.id() & 0x07));
+    payload.append(char(type_name.size()));
+    payload.append(type_name);
+    payload.append(carrier_data);
+    record.setPayload(payload);
+
+    return record;
+}
+
+NDEFRecord NDEFRecord::createBluetoothOobRecord(const QByteArray& id, const QByteArray& address, quint32 class_of_device, const QString& name, const QByteArray& hash, const QByteArray& randomizer)
+{
+    if (address.size() != 6)
+        return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+
+    // 1) Extended Inquiry Response data.
+    QByteArray eir;
+    if (class_of_device)
+    {
+        QByteArray value;
+        value.append(char(class_of_device));
+        value.append(char(class_of_device >> 8));
+        value.append(char(class_of_device >> 16));
+        appendBluetoothData(eir, ndef::BluetoothClassOfDevice, value);
+    }
+    if (!appendBluetoothData(eir, ndef::BluetoothCompleteLocalName, name.toUtf8())
+        || !appendBluetoothData(eir, ndef::BluetoothSimplePairingHash, hash, 16)
+        || !appendBluetoothData(eir, ndef::BluetoothSimplePairingRandomizer, randomizer, 16))
+        return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+
+    // 2) Payload: OOB data length (little-endian), address, EIR data.
+    const int length = 2 + 6 + eir.size();
+    if (length > 0xFFFF)
+        return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+
+    QByteArray payload;
+    payload.append(char(length));
+    payload.append(char(length >> 8));
+    payload.append(bluetoothAddress(address));
+    payload.append(eir);
+
+    return NDEFRecord(NDEFRecordType::bluetoothOobRecordType(), id, payload);
+}
+
+NDEFRecord NDEFRecord::createBluetoothLeOobRecord(const QByteArray& id, const QByteArray& address, bool random_address, NDEFBluetoothLeRole role, const QString& name, const QByteArray& temporary_key, const QByteArray& confirmation, const QByteArray& random)
+{
+    if (address.size() != 6)
+        return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+
+    // Payload: AD structures only, the address and the role first.
+    QByteArray payload;
+    appendBluetoothData(payload, ndef::BluetoothLeDeviceAddress, bluetoothAddress(address) + char(random_address ? 1 : 0));
+    appendBluetoothData(payload, ndef::BluetoothLeRole, QByteArray(1, char(role)));
+    if (!appendBluetoothData(payload, ndef::BluetoothCompleteLocalName, name.toUtf8())
+        || !appendBluetoothData(payload, ndef::BluetoothSecurityManagerTk, temporary_key, 16)
+        || !appendBluetoothData(payload, ndef::BluetoothLeSecureConnectionsConfirmation, confirmation, 16)
+        || !appendBluetoothData(payload, ndef::BluetoothLeSecureConnectionsRandom, random, 16))
+        return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+
+    return NDEFRecord(NDEFRecordType::bluetoothLeOobRecordType(), id, payload);
+}
+
+NDEFRecord NDEFRecord::createSignatureRecord(quint8 signature_type, const QByteArray& signature, const QList<QByteArray>& certificates)
+{
+    if (signature_type > 0x7F || signature.size() > 0xFFFF || certificates.count() > 0x0F)
+        return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+
+    NDEFRecord record;
+
+    // 1) Type.
+    record.setType(NDEFRecordType::signatureRecordType());
+
+    // 2) Payload.
+    QByteArray payload;
+    QBuffer buffer(&payload);
+    buffer.open(QIODevice::WriteOnly);
+    QDataStream stream(&buffer);
+
+    // 2.1) Version and signature field.
+    stream << quint8(ndef::signatureVersion);
+    stream << quint8(signature_type);
+    stream << quint8((signature_type == ndef::NoSignature) ? 0 : ndef::Sha256Hash);
+    stream << quint16(signature.size());
+    stream.writeRawData(signature.constData(), signature.size());
+
+    // 2.2) Certificate chain field: X.509, the signer's certificate first.
+    stream << quint8((ndef::X509Certificate << 4) | certificates.count());
+    for (int i = 0; i < certificates.count(); i++)
+    {
+        const QByteArray& certificate = certificates.at(i);
+        if (certificate.size() > 0xFFFF)
+            return NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Invalid, ""));
+        stream << quint16(certificate.size());
+        stream.writeRawData(certificate.constData(), certificate.size());
+    }
+    buffer.close();
+    record.setPayload(payload);
+
+    return record;
+}
@@ -0,0 +1,267 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefrecordbatch.h"
+#include "core/record.h"
+#include "core/text.h"
+
+NDEFRecordBatch::NDEFRecordBatch(int fields)
+    :   m_fields(fields)
+{
+    m_messageOffsets.append(0);
+    m_messageRecords.append(0);
+}
+
+NDEFRecordBatch::~NDEFRecordBatch()
+{
+}
+
+int NDEFRecordBatch::append(const QByteArray& data)
+{
+    const quint32 base = quint32(m_arena.count());
+    const quint32 message_index = quint32(messageCount());
+    m_arena.append(data);
+
+    // 1) One row per record, read from the copy in the arena.
+    const uchar* arena = reinterpret_cast<const uchar*>(m_arena.constData());
+    const ndef::Bytes bytes(arena + base, std::size_t(data.count()));
+    int count = 0;
+    for (const ndef::RecordView& record : ndef::RecordRange(bytes))
+    {
+        const quint8 tnf = record.header.tnf;
+        m_messageIndexes.append(message_index);
+        m_tnfs.append(tnf);
+        m_flags.append(record.header.flags);
+        m_types.append(intern(reinterpret_cast<const char*>(record.type.data()), int(record.type.size()),
+                              m_typeNames, m_typeIndexes));
+        m_idOffsets.append(quint32(record.id.data() - arena));
+        m_idLengths.append(quint8(record.id.size()));
+        m_payloadOffsets.append(quint32(record.payload.data() - arena));
+        m_payloadLengths.append(quint32(record.payload.size()));
+
+        // 2) Fields of well-known records, when asked for.
+        const bool well_known = (tnf == ndef::WellKnown && record.type.size() == 1);
+        if (m_fields & UriCodes)
+        {
+            const bool uri = (well_known && record.type[0] == 'U' && !record.payload.empty());
+            m_uriCodes.append(uri ? record.payload[0] : NoUriCode);
+        }
+        if (m_fields & TextLocales)
+        {
+            quint16 locale = NoLocale;
+            if (well_known && record.type[0] == 'T' && !record.payload.empty())
+            {
+                const ndef::TextView text = ndef::decodeText(record.payload);
+                locale = intern(reinterpret_cast<const char*>(text.locale.data()), int(text.locale.size()),
+                                m_localeNames, m_localeIndexes);
+            }
+            m_locales.append(locale);
+        }
+        count++;
+    }
+
+    m_messageOffsets.append(quint32(m_arena.count()));
+    m_messageRecords.append(quint32(recordCount()));
+    return count;
+}
+
+// Past 0xFFFF distinct values, the others all get 0xFFFF (no name).
+quint16 NDEFRecordBatch::intern(const char* data, int length, QVector<QByteArray>& names, QHash<QByteArray, quint16>& indexes)
+{
+    // Looked up through a view on the bytes: only new values are copied.
+    const QByteArray key = QByteArray::fromRawData(length ? data : "", length);
+    QHash<QByteArray, quint16>::const_iterator it = indexes.constFind(key);
+    if (it != indexes.constEnd())
+        return it.value();
+    if (names.count() >= OtherIndex)
+        return OtherIndex;
+
+    const quint16 index = quint16(names.count());
+    const QByteArray name(key.constData(), key.count());
+    names.append(name);
+    indexes.insert(name, index);
+    return index;
+}
+
+void NDEFRecordBatch::reserve(int messages, int records, int bytes)
+{
+    m_arena.reserve(bytes);
+    m_messageOffsets.reserve(messages + 1);
+    m_messageRecords.reserve(messages + 1);
+    m_messageIndexes.reserve(records);
+    m_tnfs.reserve(records);
+    m_flags.reserve(records);
+    m_types.reserve(records);
+    m_idOffsets.reserve(records);
+    m_idLengths.reserve(records);
+    m_payloadOffsets.reserve(records);
+    m_payloadLengths.reserve(records);
+    if (m_fields & UriCodes)
+        m_uriCodes.reserve(records);
+    if (m_fields & TextLocales)
+        m_locales.reserve(records);
+}
+
+void NDEFRecordBatch::clear()
+{
+    m_arena.clear();
+    m_messageOffsets.resize(1);
+    m_messageRecords.resize(1);
+    m_messageIndexes.clear();
+    m_tnfs.clear();
+    m_flags.clear();
+    m_types.clear();
+    m_idOffsets.clear();
+    m_idLengths.clear();
+    m_payloadOffsets.clear();
+    m_payloadLengths.clear();
+    m_uriCodes.clear();
+    m_locales.clear();
+    m_typeNames.clear();
+    m_typeIndexes.clear();
+    m_localeNames.clear();
+    m_localeIndexes.clear();
+}
+
+int NDEFRecordBatch::fields() const
+{
+    return m_fields;
+}
+
+int NDEFRecordBatch::messageCount() const
+{
+    return m_messageOffsets.count() - 1;
+}
+
+int NDEFRecordBatch::recordCount() const
+{
+    return m_tnfs.count();
+}
+
+const QByteArray& NDEFRecordBatch::arena() const
+{
+    return m_arena;
+}
+
+const quint32* NDEFRecordBatch::messageOffsets() const
+{
+    return m_messageOffsets.constData();
+}
+
+const quint32* NDEFRecordBatch::messageRecords() const
+{
+    return m_messageRecords.constData();
+}
+
+const quint32* NDEFRecordBatch::messageIndexes() const
+{
+    return m_messageIndexes.constData();
+}
+
+const quint8* NDEFRecordBatch::tnfs() const
+{
+    return m_tnfs.constData();
+}
+
+const quint8* NDEFRecordBatch::flags() const
+{
+    return m_flags.constData();
+}
+
+const quint16* NDEFRecordBatch::types() const
+{
+    return m_types.constData();
+}
+
+const quint32* NDEFRecordBatch::idOffsets() const
+{
+    return m_idOffsets.constData();
+}
+
+const quint8* NDEFRecordBatch::idLengths() const
+{
+    return m_idLengths.constData();
+}
+
+const quint32* NDEFRecordBatch::payloadOffsets() const
+{
+    return m_payloadOffsets.constData();
+}
+
+const quint32* NDEFRecordBatch::payloadLengths() const
+{
+    return m_payloadLengths.constData();
+}
+
+const quint8* NDEFRecordBatch::uriCodes() const
+{
+    return (m_fields & UriCodes) ? m_uriCodes.constData() : 0;
+}
+
+const quint16* NDEFRecordBatch::locales() const
+{
+    return (m_fields & TextLocales) ? m_locales.constData() : 0;
+}
+
+int NDEFRecordBatch::typeCount() const
+{
+    return m_typeNames.count();
+}
+
+QByteArray NDEFRecordBatch::typeName(int type) const
+{
+    return m_typeNames.value(type);
+}
+
+int NDEFRecordBatch::typeIndex(const QByteArray& name) const
+{
+    return m_typeIndexes.contains(name) ? int(m_typeIndexes.value(name)) : -1;
+}
+
+int NDEFRecordBatch::localeCount() const
+{
+    return m_localeNames.count();
+}
+
+QByteArray NDEFRecordBatch::localeName(int locale) const
+{
+    return m_localeNames.value(locale);
+}
+
+int NDEFRecordBatch::localeIndex(const QByteArray& name) const
+{
+    return m_localeIndexes.contains(name) ? int(m_localeIndexes.value(name)) : -1;
+}
+
+QByteArray NDEFRecordBatch::message(int message) const
+{
+    Q_ASSERT(message < messageCount());
+    return QByteArray::fromRawData(m_arena.constData() + m_messageOffsets.at(message),
+                                   int(m_messageOffsets.at(message + 1) - m_messageOffsets.at(message)));
+}
+
+QByteArray NDEFRecordBatch::id(int row) const
+{
+    Q_ASSERT(row < recordCount());
+    return QByteArray::fromRawData(m_arena.constData() + m_idOffsets.at(row), m_idLengths.at(row));
+}
+
+QByteArray NDEFRecordBatch::payload(int row) const
+{
+    Q_ASSERT(row < recordCount());
+    return QByteArray::fromRawData(m_arena.constData() + m_payloadOffsets.at(row), int(m_payloadLengths.at(row)));
+}
@@ -18,8 +18,9 @@
  */
 
 #include "ndefrecordtype.h"
-#include <QtCore/QBuffer>
-#include <QtCore/QDataStream>
+#include "ndefcore_p.h"
+#include "core/hash.h"
+#include "core/record.h"
 
 NDEFRecordType::NDEFRecordType(NDEFRecordTypeId id, const QByteArray& name)
         :   m_id(id),
@@ -56,43 +57,20 @@ bool NDEFRecordType::operator!=(const NDEFRecordType& type) const
     return ((type.id() != m_id) || (type.name() != m_name));
 }
 
+quint64 NDEFRecordType::hash(quint64 seed) const
+{
+    return ndef::hash64(ndefBytes(m_name), seed ^ quint64(m_id));
+}
+
 NDEFRecordType NDEFRecordType::fromByteArray(const QByteArray& data, int offset)
 {
-    unsigned int total_size = data.count() - offset;
+    const ndef::Bytes bytes = ndefBytes(data);
 
-    if (total_size > 2)
+    if (offset >= 0 && ndef::hasRecord(bytes, offset))
     {
-        QByteArray data_buffer = data.right(total_size);
-        QBuffer buffer(&data_buffer);
-        buffer.open(QIODevice::ReadOnly);
-        QDataStream stream(&buffer);
-        quint8 byte;
-
-        // 1) TNF & flags.
-        stream >> byte;
-        quint8 tnf = byte & 0x07;
-        bool has_id = byte & 0x08;
-        bool short_record = byte & 0x10;
-
-        // 2) Type length.
-        stream >> byte;
-        quint8 type_length = byte;
-
-        // 3) Payload length.
-        stream.skipRawData(short_record ? 1 : 4);
-
-        // 4) ID Length.
-        stream.skipRawData(has_id ? 1 : 0);
-
-        // 5) Type.
-        QByteArray type_name;
-        for (quint8 i = 0; i < type_length; i++)
-        {
-            stream >> byte;
-            type_name.append(byte);
-        }
-
-        return NDEFRecordType((NDEFRecordTypeId)tnf, type_name);
+        // Only the header and the type are read.
+        const ndef::RecordView record = ndef::decodeRecord(bytes, offset);
+        return NDEFRecordType(NDEFRecordTypeId(record.header.tnf), ndefByteArray(record.type));
     }
 
     // Invalid record.
@@ -149,3 +127,42 @@ NDEFRecordType NDEFRecordType::gcDataRecordType()
     return NDEFRecordType(NDEFRecordType::NDEF_NfcForumRTD, "d");
 }
 
+NDEFRecordType NDEFRecordType::handoverSelectRecordType()
+{
+    return NDEFRecordType(NDEFRecordType::NDEF_NfcForumRTD, "Hs");
+}
+
+NDEFRecordType NDEFRecordType::handoverRequestRecordType()
+{
+    return NDEFRecordType(NDEFRecordType::NDEF_NfcForumRTD, "Hr");
+}
+
+NDEFRecordType NDEFRecordType::alternativeCarrierRecordType()
+{
+    return NDEFRecordType(NDEFRecordType::NDEF_NfcForumRTD, "ac");
+}
+
+NDEFRecordType NDEFRecordType::collisionResolutionRecordType()
+{
+    return NDEFRecordType(NDEFRecordType::NDEF_NfcForumRTD, "cr");
+}
+
+NDEFRecordType NDEFRecordType::handoverCarrierRecordType()
+{
+    return NDEFRecordType(NDEFRecordType::NDEF_NfcForumRTD, "Hc");
+}
+
+NDEFRecordType NDEFRecordType::bluetoothOobRecordType()
+{
+    return NDEFRecordType(NDEFRecordType::NDEF_MIME, "application/vnd.bluetooth.ep.oob");
+}
+
+NDEFRecordType NDEFRecordType::bluetoothLeOobRecordType()
+{
+    return NDEFRecordType(NDEFRecordType::NDEF_MIME, "application/vnd.bluetooth.le.oob");
+}
+
+NDEFRecordType NDEFRecordType::signatureRecordType()
+{
+    return NDEFRecordType(NDEFRecordType::NDEF_NfcForumRTD, "Sig");
+}
@@ -0,0 +1,342 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefsignature.h"
+#include "ndefcore_p.h"
+#include "core/signature.h"
+#include <QtCore/QHash>
+#include <QtCore/QReadWriteLock>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+#ifdef NDEF_OPENSSL
+#include "ndefcrypto_p.h"
+#endif
+
+// Chains kept by a verifier; the cache is emptied when it would grow past it.
+static const int max_cached_chains = 1024;
+
+// Messages per task of a batch, at least.
+static const int min_batch_size = 16;
+
+// The "Sig" record of message at index signature, and what it covers.
+static bool signedBlock(const QByteArray& message, int signature, ndef::SignedBlock& block)
+{
+    int index = 0;
+    bool found = false;
+    ndef::forEachSignature(ndefBytes(message), [&](const ndef::SignedBlock& current)
+    {
+        if (index++ == signature)
+        {
+            block = current;
+            found = true;
+        }
+    });
+    return found;
+}
+
+bool NDEFSignature::isAvailable()
+{
+#ifdef NDEF_OPENSSL
+    return true;
+#else
+    return false;
+#endif
+}
+
+int NDEFSignature::signatureCount(const QByteArray& message)
+{
+    return int(ndef::forEachSignature(ndefBytes(message), [](const ndef::SignedBlock&) {}));
+}
+
+QList<int> NDEFSignature::signedRecords(const QByteArray& message, int signature)
+{
+    QList<int> records;
+    ndef::SignedBlock block;
+    if (signedBlock(message, signature, block) && !block.signature.isMarker())
+    {
+        for (std::size_t i = 0; i < block.recordCount; i++)
+            records.append(int(block.firstRecord + i));
+    }
+    return records;
+}
+
+QList<QByteArray> NDEFSignature::signedData(const QByteArray& message, int signature)
+{
+    QList<QByteArray> slices;
+    ndef::SignedBlock block;
+    if (signedBlock(message, signature, block) && !block.signature.isMarker())
+    {
+        ndef::forEachSignedSlice(ndefBytes(message), block, [&slices](ndef::Bytes slice)
+        {
+            slices.append(QByteArray::fromRawData(reinterpret_cast<const char*>(slice.data()), int(slice.size())));
+        });
+    }
+    return slices;
+}
+
+NDEFMessage NDEFSignature::sign(const NDEFMessage& message, SignatureType type, const QByteArray& private_key, const QList<QByteArray>& certificates)
+{
+#ifdef NDEF_OPENSSL
+    if (type == NoSignature || certificates.count() > 0x0F)
+        return NDEFMessage();
+
+    const QByteArray encoded = message.toByteArray();
+    const ndef::Bytes bytes = ndefBytes(encoded);
+
+    // 1) The records after the last "Sig" record.
+    ndef::SignedBlock block;
+    block.end = bytes.size();
+    for (const ndef::RecordView& record : ndef::RecordRange(bytes))
+    {
+        if (ndef::isSignatureRecord(record))
+            block.begin = record.offset + record.size();
+    }
+    if (block.begin >= block.end)
+        return NDEFMessage();
+
+    // 2) The signature, appended as a "Sig" record.
+    std::vector<std::uint8_t> signature;
+    if (!NDEFCrypto::sign(ndefBytes(private_key), type, bytes, block, signature))
+        return NDEFMessage();
+
+    NDEFMessage signed_message(message);
+    signed_message.appendRecord(NDEFRecord::createSignatureRecord(type, ndefByteArray(ndef::Bytes(signature.data(), signature.size())), certificates));
+    return signed_message;
+#else
+    Q_UNUSED(message);
+    Q_UNUSED(type);
+    Q_UNUSED(private_key);
+    Q_UNUSED(certificates);
+    return NDEFMessage();
+#endif
+}
+
+class NDEFSignatureCache
+{
+public:
+    QThreadPool pool;
+#ifdef NDEF_OPENSSL
+    NDEFCrypto::TrustStore trust;
+    QReadWriteLock lock;
+    QHash<QByteArray, std::shared_ptr<const NDEFCrypto::Chain> > chains;
+
+    // The parsed chain of a signature, from the cache if it was seen before.
+    std::shared_ptr<const NDEFCrypto::Chain> chain(const ndef::SignatureView& signature)
+    {
+        const ndef::Bytes field = signature.certificateChain;
+        const QByteArray key = QByteArray::fromRawData(reinterpret_cast<const char*>(field.data()), int(field.size()));
+        {
+            QReadLocker locker(&lock);
+            QHash<QByteArray, std::shared_ptr<const NDEFCrypto::Chain> >::const_iterator it = chains.constFind(key);
+            if (it != chains.constEnd())
+                return it.value();
+        }
+
+        // Parsed outside the lock: two threads may parse the same chain once each.
+        std::shared_ptr<const NDEFCrypto::Chain> loaded = NDEFCrypto::Chain::load(signature, trust);
+        if (loaded)
+        {
+            QWriteLocker locker(&lock);
+            if (chains.count() >= max_cached_chains)
+                chains.clear();
+            chains.insert(ndefByteArray(field), loaded);
+        }
+        return loaded;
+    }
+#endif
+};
+
+// Verifies a slice of a batch.
+class NDEFVerifyTask : public QRunnable
+{
+    const NDEFSignatureVerifier* m_verifier;
+    const QVector<QByteArray>& m_messages;
+    QVector<NDEFSignatureVerifier::Status>& m_results;
+    int m_begin;
+    int m_end;
+    QSemaphore& m_done;
+
+public:
+    NDEFVerifyTask(const NDEFSignatureVerifier* verifier, const QVector<QByteArray>& messages,
+                   QVector<NDEFSignatureVerifier::Status>& results, int begin, int end, QSemaphore& done)
+        :   m_verifier(verifier),
+            m_messages(messages),
+            m_results(results),
+            m_begin(begin),
+            m_end(end),
+            m_done(done)
+    {
+    }
+
+    void run()
+    {
+        for (int i = m_begin; i < m_end; i++)
+            m_results[i] = m_verifier->verify(m_messages.at(i));
+        m_done.release();
+    }
+};
+
+NDEFSignatureVerifier::NDEFSignatureVerifier()
+    :   m_cache(new NDEFSignatureCache)
+{
+    m_cache->pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount()));
+}
+
+NDEFSignatureVerifier::~NDEFSignatureVerifier()
+{
+    m_cache->pool.waitForDone();
+    delete m_cache;
+}
+
+bool NDEFSignatureVerifier::addTrustedCertificate(const QByteArray& certificate)
+{
+#ifdef NDEF_OPENSSL
+    // Cached chains were validated against the previous roots.
+    clearCache();
+    return m_cache->trust.add(ndefBytes(certificate));
+#else
+    Q_UNUSED(certificate);
+    return false;
+#endif
+}
+
+void NDEFSignatureVerifier::setThreadCount(int count)
+{
+    m_cache->pool.setMaxThreadCount(qMax(1, count));
+}
+
+int NDEFSignatureVerifier::threadCount() const
+{
+    return m_cache->pool.maxThreadCount();
+}
+
+// How bad a status is, when a message has several signatures.
+static int statusRank(NDEFSignatureVerifier::Status status)
+{
+    switch (status)
+    {
+        case NDEFSignatureVerifier::Unsigned:               return 0;
+        case NDEFSignatureVerifier::Valid:                  return 1;
+        case NDEFSignatureVerifier::Unavailable:            return 2;
+        case NDEFSignatureVerifier::Unsupported:            return 3;
+        case NDEFSignatureVerifier::UntrustedCertificate:   return 4;
+        case NDEFSignatureVerifier::Malformed:              return 5;
+        case NDEFSignatureVerifier::BadSignature:           return 6;
+    }
+    return 0;
+}
+
+#ifdef NDEF_OPENSSL
+static NDEFSignatureVerifier::Status verifyBlock(NDEFSignatureCache* cache, ndef::Bytes message, const ndef::SignedBlock& block)
+{
+    if (block.signature.signatureIsUri || block.signature.certificateFormat != ndef::X509Certificate
+        || block.signature.certificateCount == 0)
+        return NDEFSignatureVerifier::Unsupported;
+
+    std::shared_ptr<const NDEFCrypto::Chain> chain = cache->chain(block.signature);
+    if (!chain)
+        return NDEFSignatureVerifier::Malformed;
+
+    switch (chain->verify(block.signature, message, block))
+    {
+        case NDEFCrypto::Verified:
+            return chain->isTrusted() ? NDEFSignatureVerifier::Valid : NDEFSignatureVerifier::UntrustedCertificate;
+        case NDEFCrypto::BadSignature:  return NDEFSignatureVerifier::BadSignature;
+        case NDEFCrypto::Malformed:     return NDEFSignatureVerifier::Malformed;
+        case NDEFCrypto::Unsupported:   return NDEFSignatureVerifier::Unsupported;
+    }
+    return NDEFSignatureVerifier::Malformed;
+}
+#endif
+
+NDEFSignatureVerifier::Status NDEFSignatureVerifier::verify(const QByteArray& message) const
+{
+    const ndef::Bytes bytes = ndefBytes(message);
+    Status status = Unsigned;
+
+    ndef::forEachSignature(bytes, [&](const ndef::SignedBlock& block)
+    {
+        // Nothing is worse than a bad signature.
+        if (block.signature.isMarker() || status == BadSignature)
+            return;
+
+        Status block_status = Valid;
+        if (!block.signature.valid || block.recordCount == 0)
+        {
+            block_status = Malformed;
+        }
+        else
+        {
+#ifdef NDEF_OPENSSL
+            block_status = verifyBlock(m_cache, bytes, block);
+#else
+            block_status = Unavailable;
+#endif
+        }
+
+        if (statusRank(block_status) > statusRank(status))
+            status = block_status;
+    });
+
+    return status;
+}
+
+QVector<NDEFSignatureVerifier::Status> NDEFSignatureVerifier::verify(const QVector<QByteArray>& messages) const
+{
+    QVector<Status> results(messages.count(), Unsigned);
+    const int count = messages.count();
+    const int threads = m_cache->pool.maxThreadCount();
+
+    // Small batches are not worth the hand-off.
+    if (threads == 1 || count < 2 * min_batch_size)
+    {
+        for (int i = 0; i < count; i++)
+            results[i] = verify(messages.at(i));
+        return results;
+    }
+
+    // A few tasks per thread, so that slow messages do not hold a whole share.
+    const int size = qMax(min_batch_size, (count + threads * 4 - 1) / (threads * 4));
+    QSemaphore done;
+    int tasks = 0;
+    for (int begin = 0; begin < count; begin += size, tasks++)
+        m_cache->pool.start(new NDEFVerifyTask(this, messages, results, begin, qMin(count, begin + size), done));
+    done.acquire(tasks);
+
+    return results;
+}
+
+int NDEFSignatureVerifier::cachedChainCount() const
+{
+#ifdef NDEF_OPENSSL
+    QReadLocker locker(&m_cache->lock);
+    return m_cache->chains.count();
+#else
+    return 0;
+#endif
+}
+
+void NDEFSignatureVerifier::clearCache()
+{
+#ifdef NDEF_OPENSSL
+    QWriteLocker locker(&m_cache->lock);
+    m_cache->chains.clear();
+#endif
+}
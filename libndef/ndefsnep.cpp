@@ -0,0 +1,468 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefsnep.h"
+#include "ndefcore_p.h"
+#include <QtCore/QMutex>
+#include <QtCore/QQueue>
+#include <QtCore/QWaitCondition>
+#include <limits.h>
+#include <string.h>
+
+// A request or response without information: Continue, Reject, the answer to a Put...
+static bool sendSnepHeader(NDEFSnepTransport* transport, quint8 code)
+{
+    quint8 head[ndef::snepHeaderLength];
+    ndef::encodeSnepHeader(head, code, 0);
+    return transport->send(ndef::Bytes(head, sizeof(head)), ndef::Bytes());
+}
+
+/* Sends a request or response: its first fragment, then, once the peer
+answered continue_code, the others without waiting for anything. False if
+the link failed, or if the peer answered something else, which is in reply.
+*/
+static bool sendSnep(NDEFSnepTransport* transport, quint8 code, ndef::Bytes information, quint32 acceptable_length,
+                     quint8 continue_code, int timeout, QByteArray* reply)
+{
+    ndef::SnepFragmenter fragmenter(code, information, std::size_t(transport->miu()), acceptable_length);
+    ndef::SnepFragment fragment;
+
+    reply->clear();
+    fragmenter.next(fragment);
+    if (!transport->send(fragment.head, fragment.body))
+        return false;
+    if (!fragmenter.needsContinue())
+        return true;
+
+    ndef::SnepHeader header;
+    if (!transport->receive(reply, timeout))
+        return false;
+    if (!ndef::decodeSnepHeader(ndefBytes(*reply), header) || header.code != continue_code)
+        return false;
+    reply->clear();
+
+    while (fragmenter.next(fragment))
+        if (!transport->send(fragment.head, fragment.body))
+            return false;
+    return true;
+}
+
+/* Receives a request or response, answering continue_code to its first
+fragment if more are coming. After an Error past the first fragment, the
+rest is received and dropped, so that the peer can be answered. False if
+the link failed.
+*/
+static bool receiveSnep(NDEFSnepTransport* transport, NDEFSnepReassembler* reassembler, quint8 continue_code,
+                        int timeout, NDEFSnepReassembler::Status* status)
+{
+    QByteArray pdu;
+
+    reassembler->reset();
+    for (bool first = true; ; first = false)
+    {
+        if (!transport->receive(&pdu, timeout))
+            return false;
+        *status = reassembler->feed(pdu);
+
+        if (*status == NDEFSnepReassembler::Error && !first)
+        {
+            while (!reassembler->isFinished())
+            {
+                if (!transport->receive(&pdu, timeout))
+                    return false;
+                reassembler->feed(pdu);
+            }
+        }
+        if (*status != NDEFSnepReassembler::NeedMoreData)
+            return true;
+        if (first && !sendSnepHeader(transport, continue_code))
+            return false;
+    }
+}
+
+NDEFSnepTransport::~NDEFSnepTransport()
+{
+}
+
+class NDEFSnepLoopbackQueue
+{
+public:
+    QMutex mutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+    QQueue<QByteArray> pdus;
+    int window;
+    bool closed;
+
+    NDEFSnepLoopbackQueue()
+        :   window(1),
+            closed(false)
+    {
+    }
+};
+
+class NDEFSnepLoopbackEnd : public NDEFSnepTransport
+{
+protected:
+    NDEFSnepLoopbackQueue* m_in;
+    NDEFSnepLoopbackQueue* m_out;
+    int m_miu;
+
+public:
+    NDEFSnepLoopbackEnd(NDEFSnepLoopbackQueue* in, NDEFSnepLoopbackQueue* out, int miu)
+        :   m_in(in),
+            m_out(out),
+            m_miu(miu)
+    {
+    }
+
+    int miu() const
+    {
+        return m_miu;
+    }
+
+    bool send(ndef::Bytes head, ndef::Bytes body)
+    {
+        Q_ASSERT(head.size() + body.size() <= std::size_t(m_miu));
+
+        // The one copy of the bytes, as into the link layer's buffers.
+        QByteArray pdu;
+        pdu.resize(int(head.size() + body.size()));
+        if (!head.empty())
+            memcpy(pdu.data(), head.data(), head.size());
+        if (!body.empty())
+            memcpy(pdu.data() + head.size(), body.data(), body.size());
+
+        QMutexLocker locker(&m_out->mutex);
+        while (!m_out->closed && m_out->pdus.count() >= m_out->window)
+            m_out->notFull.wait(&m_out->mutex);
+        if (m_out->closed)
+            return false;
+        m_out->pdus.enqueue(pdu);
+        m_out->notEmpty.wakeOne();
+        return true;
+    }
+
+    bool receive(QByteArray* pdu, int timeout)
+    {
+        QMutexLocker locker(&m_in->mutex);
+        while (!m_in->closed && m_in->pdus.isEmpty())
+            if (!m_in->notEmpty.wait(&m_in->mutex, timeout < 0 ? ULONG_MAX : ulong(timeout)))
+                return false;
+        if (m_in->pdus.isEmpty())
+            return false;
+        *pdu = m_in->pdus.dequeue();
+        m_in->notFull.wakeOne();
+        return true;
+    }
+};
+
+NDEFSnepLoopback::NDEFSnepLoopback(int miu, int window)
+    :   m_queues(new NDEFSnepLoopbackQueue[2])
+{
+    m_queues[0].window = m_queues[1].window = qMax(1, window);
+    m_client = new NDEFSnepLoopbackEnd(&m_queues[1], &m_queues[0], miu);
+    m_server = new NDEFSnepLoopbackEnd(&m_queues[0], &m_queues[1], miu);
+}
+
+NDEFSnepLoopback::~NDEFSnepLoopback()
+{
+    delete m_client;
+    delete m_server;
+    delete [] m_queues;
+}
+
+NDEFSnepTransport* NDEFSnepLoopback::client() const
+{
+    return m_client;
+}
+
+NDEFSnepTransport* NDEFSnepLoopback::server() const
+{
+    return m_server;
+}
+
+void NDEFSnepLoopback::close()
+{
+    for (int i = 0; i < 2; i++)
+    {
+        QMutexLocker locker(&m_queues[i].mutex);
+        m_queues[i].closed = true;
+        m_queues[i].notEmpty.wakeAll();
+        m_queues[i].notFull.wakeAll();
+    }
+}
+
+// The framer needs no limit of its own: messages are bounded by m_maxLength.
+NDEFSnepReassembler::NDEFSnepReassembler(quint32 max_length)
+    :   m_framer(INT_MAX),
+        m_maxLength(max_length)
+{
+    reset();
+}
+
+NDEFSnepReassembler::~NDEFSnepReassembler()
+{
+}
+
+NDEFSnepReassembler::Status NDEFSnepReassembler::feed(const QByteArray& fragment)
+{
+    const char* data = fragment.constData();
+    quint32 size = quint32(fragment.count());
+
+    // 1) The header, in the first fragment.
+    if (!m_started)
+    {
+        ndef::SnepHeader header;
+        if (!ndef::decodeSnepHeader(ndefBytes(fragment), header))
+            return fail(ndef::SnepBadRequest);
+        m_started = true;
+        m_code = ndef::SnepCode(header.code);
+        m_length = header.length;
+        if (!header.isSupported())
+            return fail(ndef::SnepUnsupportedVersion);
+        if (m_length > m_maxLength)
+            return fail(ndef::SnepResponseReject);
+        data += ndef::snepHeaderLength;
+        size -= ndef::snepHeaderLength;
+
+        if (m_code == ndef::SnepGet)
+        {
+            if (m_length < 4 || size < 4)
+                return fail(ndef::SnepBadRequest);
+            m_acceptableLength = ndef::readUInt32(reinterpret_cast<const quint8*>(data));
+            m_received = 4;
+            data += 4;
+            size -= 4;
+        }
+    }
+
+    // 2) The message, framed as it comes in.
+    m_received += size;
+    if (m_status == Error)
+        return Error;
+    if (m_received > m_length)
+        return fail(ndef::SnepBadRequest);
+    if (size > 0)
+        m_framer.append(QByteArray::fromRawData(data, int(size)));
+    if (m_frameLength < 0 && m_framer.pendingBytes() > 0)
+    {
+        int length = 0;
+        const NDEFMessageFramer::Status status = m_framer.next(0, &length);
+        if (status == NDEFMessageFramer::FramingError)
+            return fail(ndef::SnepBadRequest);
+        if (status == NDEFMessageFramer::MessageReady)
+            m_frameLength = length;
+    }
+    if (m_received < m_length)
+        return NeedMoreData;
+
+    // 3) Nothing after the message.
+    const quint32 message_length = m_length - (m_code == ndef::SnepGet ? 4 : 0);
+    if (message_length > 0 && quint32(m_frameLength) != message_length)
+        return fail(ndef::SnepBadRequest);
+    m_status = Complete;
+    return Complete;
+}
+
+void NDEFSnepReassembler::reset()
+{
+    m_framer.clear();
+    m_length = 0;
+    m_received = 0;
+    m_acceptableLength = 0;
+    m_frameLength = -1;
+    m_code = ndef::SnepContinue;
+    m_error = ndef::SnepSuccess;
+    m_started = false;
+    m_status = NeedMoreData;
+}
+
+void NDEFSnepReassembler::setMaxLength(quint32 max_length)
+{
+    m_maxLength = max_length;
+}
+
+bool NDEFSnepReassembler::isFinished() const
+{
+    return m_started && m_received >= m_length;
+}
+
+ndef::SnepCode NDEFSnepReassembler::code() const
+{
+    return m_code;
+}
+
+quint32 NDEFSnepReassembler::acceptableLength() const
+{
+    return m_acceptableLength;
+}
+
+NDEFMessage NDEFSnepReassembler::message() const
+{
+    if (m_status != Complete || m_frameLength < 0)
+        return NDEFMessage();
+    return NDEFMessage::fromFrame(m_framer.buffer());
+}
+
+QByteArray NDEFSnepReassembler::messageBytes() const
+{
+    if (m_status != Complete || m_frameLength < 0)
+        return QByteArray();
+    return m_framer.buffer();
+}
+
+ndef::SnepCode NDEFSnepReassembler::error() const
+{
+    return m_error;
+}
+
+NDEFSnepReassembler::Status NDEFSnepReassembler::fail(ndef::SnepCode error)
+{
+    m_error = error;
+    m_status = Error;
+    return Error;
+}
+
+NDEFSnepClient::NDEFSnepClient(NDEFSnepTransport* transport, int timeout)
+    :   m_transport(transport),
+        m_timeout(timeout)
+{
+}
+
+NDEFSnepClient::~NDEFSnepClient()
+{
+}
+
+bool NDEFSnepClient::put(const NDEFMessage& msg, ndef::SnepCode* response)
+{
+    return put(msg.toByteArray(), response);
+}
+
+bool NDEFSnepClient::put(const QByteArray& data, ndef::SnepCode* response)
+{
+    return request(ndef::SnepPut, data, 0, 0, response);
+}
+
+bool NDEFSnepClient::get(const NDEFMessage& request, NDEFMessage* msg, ndef::SnepCode* response, quint32 acceptable_length)
+{
+    return this->request(ndef::SnepGet, request.toByteArray(), acceptable_length, msg, response);
+}
+
+bool NDEFSnepClient::request(ndef::SnepCode code, const QByteArray& data, quint32 acceptable_length,
+                             NDEFMessage* msg, ndef::SnepCode* response)
+{
+    ndef::SnepCode answer = ndef::SnepResponseReject;
+    QByteArray reply;
+    NDEFSnepReassembler reassembler(acceptable_length);
+    NDEFSnepReassembler::Status status = NDEFSnepReassembler::Error;
+    bool ok = false;
+
+    // 1) The request; the server may turn it down after its first fragment.
+    if (!sendSnep(m_transport, code, ndefBytes(data), acceptable_length, ndef::SnepResponseContinue, m_timeout, &reply))
+    {
+        ndef::SnepHeader header;
+        if (ndef::decodeSnepHeader(ndefBytes(reply), header))
+            answer = ndef::SnepCode(header.code);
+    }
+    // 2) The response, with the message of a Get.
+    else if (receiveSnep(m_transport, &reassembler, ndef::SnepContinue, m_timeout, &status))
+    {
+        if (status == NDEFSnepReassembler::Complete)
+        {
+            answer = reassembler.code();
+            ok = (answer == ndef::SnepSuccess);
+            if (ok && msg)
+                *msg = reassembler.message();
+        }
+        else if (!reassembler.isFinished())
+        {
+            sendSnepHeader(m_transport, ndef::SnepReject);
+        }
+    }
+
+    if (response)
+        *response = answer;
+    return ok;
+}
+
+NDEFSnepServer::NDEFSnepServer(NDEFSnepTransport* transport, int timeout)
+    :   m_transport(transport),
+        m_timeout(timeout)
+{
+}
+
+NDEFSnepServer::~NDEFSnepServer()
+{
+}
+
+void NDEFSnepServer::setPutHandler(const PutHandler& handler)
+{
+    m_putHandler = handler;
+}
+
+void NDEFSnepServer::setGetHandler(const GetHandler& handler)
+{
+    m_getHandler = handler;
+}
+
+void NDEFSnepServer::setMaxLength(quint32 max_length)
+{
+    m_reassembler.setMaxLength(max_length);
+}
+
+bool NDEFSnepServer::serveOne()
+{
+    NDEFSnepReassembler::Status status;
+    if (!receiveSnep(m_transport, &m_reassembler, ndef::SnepResponseContinue, m_timeout, &status))
+        return false;
+    if (status == NDEFSnepReassembler::Error)
+        return sendSnepHeader(m_transport, m_reassembler.error());
+
+    switch (m_reassembler.code())
+    {
+    case ndef::SnepPut:
+        if (!m_putHandler)
+            return sendSnepHeader(m_transport, ndef::SnepNotImplemented);
+        return sendSnepHeader(m_transport, m_putHandler(m_reassembler.message()));
+
+    case ndef::SnepGet:
+    {
+        if (!m_getHandler)
+            return sendSnepHeader(m_transport, ndef::SnepNotImplemented);
+        NDEFMessage msg;
+        const ndef::SnepCode response = m_getHandler(m_reassembler.message(), &msg);
+        if (response != ndef::SnepSuccess)
+            return sendSnepHeader(m_transport, response);
+
+        const QByteArray data = msg.toByteArray();
+        if (quint32(data.count()) > m_reassembler.acceptableLength())
+            return sendSnepHeader(m_transport, ndef::SnepExcessData);
+        // A Reject from the client ends the response, not the link.
+        QByteArray reply;
+        return sendSnep(m_transport, ndef::SnepSuccess, ndefBytes(data), 0, ndef::SnepContinue, m_timeout, &reply)
+            || !reply.isEmpty();
+    }
+
+    case ndef::SnepContinue:
+    case ndef::SnepReject:
+        return sendSnepHeader(m_transport, ndef::SnepBadRequest);
+
+    default:
+        return sendSnepHeader(m_transport, ndef::SnepNotImplemented);
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFTRACE_P_H
+#define NDEFTRACE_P_H
+
+/* USDT probes (provider "libndef"), built with qmake CONFIG+=ndef_usdt.
+A probe is a single nop in the code until a tracer attaches to it, and its
+arguments are values the surrounding code already has at hand. Without the
+option the macros expand to nothing and the arguments are not evaluated.
+
+    message__begin      (offset, length)
+    message__end        (offset, bytes consumed, record count)
+    record__header      (offset, tnf, type length, payload length, id length)
+    record__done        (offset, tnf, record length, type, type length)
+    chunk               (offset, tnf, payload length, last chunk)
+    tlv__found          (offset, tlv type, value length)
+    record__encode      (tnf, payload length, encoded length)
+    message__encode     (record count, encoded length)
+
+Offsets are relative to the start of the buffer being decoded; "type" is a
+pointer to the (not terminated) type bytes, valid during the probe only.
+See tools/ndef-record-latency.bt for an example.
+*/
+
+#ifdef NDEF_USDT
+
+#include <sys/sdt.h>
+
+#define NDEF_TRACE2(probe, a, b) \
+    DTRACE_PROBE2(libndef, probe, a, b)
+#define NDEF_TRACE3(probe, a, b, c) \
+    DTRACE_PROBE3(libndef, probe, a, b, c)
+#define NDEF_TRACE4(probe, a, b, c, d) \
+    DTRACE_PROBE4(libndef, probe, a, b, c, d)
+#define NDEF_TRACE5(probe, a, b, c, d, e) \
+    DTRACE_PROBE5(libndef, probe, a, b, c, d, e)
+
+#else
+
+#define NDEF_TRACE2(probe, a, b) do {} while (0)
+#define NDEF_TRACE3(probe, a, b, c) do {} while (0)
+#define NDEF_TRACE4(probe, a, b, c, d) do {} while (0)
+#define NDEF_TRACE5(probe, a, b, c, d, e) do {} while (0)
+
+#endif // NDEF_USDT
+
+#endif // NDEFTRACE_P_H
@@ -18,6 +18,10 @@
  */
 
 #include "tlv.h"
+#include "ndefcore_p.h"
+#include "ndeftrace_p.h"
+#include "core/hash.h"
+#include "core/tlv.h"
 
 Tlv::Tlv(quint8 type, const QByteArray& value)
     :   m_type(type),
@@ -62,36 +66,14 @@ QByteArray Tlv::value() const
 
 QByteArray Tlv::toByteArray() const
 {
-    QByteArray buffer;
+    quint16 length = this->length();
 
-    switch (m_type)
-    {
-        case Tlv::Null:
-        case Tlv::Terminator:
-            buffer.append(m_type);
-            break;
+    QByteArray buffer;
+    buffer.resize(ndef::tlvHeaderLength(m_type, length));
+    ndef::encodeTlvHeader(reinterpret_cast<uchar*>(buffer.data()), m_type, length);
 
-        default:
-        {
-            buffer.append(m_type);
-            quint16 length = this->length();
-
-            if (length <= 0xFE)
-            {
-                buffer.append((quint8)length);
-            }
-            else
-            {
-                buffer.append((quint8)0xFF);
-                buffer.append((quint8)(length >> 8));
-                buffer.append((quint8)(length & 0xFF));
-            }
-
-            if (this->length() > 0)
-                buffer.append(m_value);
-        }
-        break;
-    }
+    if (length > 0)
+        buffer.append(m_value);
 
     return buffer;
 }
@@ -100,63 +82,43 @@ TlvList Tlv::fromByteArray(const QByteArray& data, quint64 offset)
 {
     TlvList list;
 
-    QByteArray buffer = data.left(data.count() - offset);
-    qint32 count = buffer.count();
-    qint32 index = 0;
-
-    while (count > index)
+    for (const ndef::TlvView& tlv : ndef::TlvRange(ndefBytes(data), offset))
     {
-        quint8 type = buffer.at(index);
-        ++index;
-
-        switch (type)
+        switch (tlv.type)
         {
             case Tlv::Null:
                 break;
 
             case Tlv::Terminator:
-            {
                 list.append(Tlv::createTerminatorTlv());
-                index = count;
-            }
-            break;
+                break;
 
             default:
-            {
-                if ((count - index) > 0)
-                {
-                    quint16 length = buffer.at(index);
-                    ++index;
-
-                    if (length > 0xFE)
-                    {
-                        length = 0;
-
-                        if ((count - index) > 2)
-                        {
-                            length = (quint8(buffer.at(index)) << 8) | quint8(buffer.at(index + 1));
-                            index += 2;
-                        }
-                    }
-
-                    if ((count - index) >= length)
-                    {
-                        list.append(Tlv(type, buffer.mid(index, length)));
-                        index += length;
-                    }
-                    else
-                    {
-                        index = count;
-                    }
-                }
-            }
-            break;
+                list.append(Tlv(tlv.type, ndefByteArray(tlv.value)));
+                NDEF_TRACE3(tlv__found, tlv.offset, tlv.type, tlv.value.size());
+                break;
         }
     }
 
     return list;
 }
 
+// Null and Terminator TLVs have no value, whatever they were given.
+bool Tlv::operator==(const Tlv& tlv) const
+{
+    return m_type == tlv.m_type && this->value() == tlv.value();
+}
+
+bool Tlv::operator!=(const Tlv& tlv) const
+{
+    return !(*this == tlv);
+}
+
+quint64 Tlv::hash() const
+{
+    return ndef::hash64(ndefBytes(this->value()), m_type);
+}
+
 Tlv Tlv::createNullTlv()
 {
     return Tlv(Tlv::Null);
@@ -20,13 +20,28 @@
 #include <QTextStream>
 #include <QFile>
 #include <QDataStream>
+#include <cstdio>
+#include <errno.h>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include <QtCore/QCoreApplication>
 #include <QDebug>
 #include <QStringList>
 #include <QFile>
+#include <QHash>
+#include <QScopedPointer>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QLocalSocket>
  
 #include <ndef/ndefmessage.h>
+#include <ndef/ndefcapture.h>
+#include <ndef/ndefvisit.h>
+
+#include "ndefoutput.h"
 
 QTextStream out(stdout);
 QTextStream err(stderr);
@@ -34,6 +49,9 @@ QTextStream info(stderr);
 
 QFile output;
 
+// Structured output (--format=jsonl|cbor), or null for the text report.
+NDEFWriter* writer = 0;
+
 const QString toTypeNameFormat (int id)
 {
     switch(id)
@@ -50,73 +68,194 @@ const QString toTypeNameFormat (int id)
     return QString("Invalid");
 }
 
-void decodeNDEFMessage (const QByteArray data, int depth = 0)
+void decodeNDEFMessage (const QByteArray& data, int depth = 0);
+
+// The bytes of a view, without copying them.
+static QByteArray viewBytes (ndef::Bytes bytes)
+{
+    return QByteArray::fromRawData (reinterpret_cast<const char*>(bytes.data()), int(bytes.size()));
+}
+
+static ndef::Bytes bytesOf (const QByteArray& data)
+{
+    return ndef::Bytes (data.constData(), std::size_t(data.size()));
+}
+
+int writeNDEFRecords (ndef::Bytes data, ndef::RecordContext context);
+
+// Writes a record to the structured output: its header fields, its payload,
+// then what is decoded from it.
+void writeNDEFRecord (const ndef::RecordView& record, ndef::RecordContext context)
+{
+    writer->beginRecord();
+    writer->numberField ("tnf", record.header.tnf);
+    writer->textField ("type", record.type);
+    if (record.header.hasId())
+        writer->bytesField ("id", record.id);
+    writer->bytesField ("payload", record.payload);
+
+    ndef::visitRecord (record, context, ndef::Overloaded {
+        [](const ndef::TextRecordView& text)
+        {
+            writer->textField ("language", text.locale);
+            if (text.utf16)
+            {
+                const QByteArray utf8 = NDEFRecord::textText (viewBytes (text.record.payload)).toUtf8();
+                writer->textField ("text", bytesOf (utf8));
+            }
+            else
+            {
+                writer->textField ("text", text.text);
+            }
+        },
+        [](const ndef::UriRecordView& uri)
+        {
+            writer->textField ("uri", ndef::Bytes (uri.prefix), uri.rest);
+        },
+        [](const ndef::SmartPosterRecordView& sp)
+        {
+            writeNDEFRecords (sp.record.payload, ndef::RecordContext::SmartPoster);
+        },
+        [](const ndef::SpActionRecordView& action)
+        {
+            writer->numberField ("action", action.action);
+        },
+        [](const ndef::SpSizeRecordView& size)
+        {
+            writer->numberField ("size", size.size);
+        },
+        [](const ndef::SpTypeRecordView& type)
+        {
+            writer->textField ("mime_type", type.mimeType);
+        },
+        [](const ndef::MimeRecordView& mime)
+        {
+            // -o FILE gets the first MIME payload, as with the text report.
+            if (output.isOpen())
+            {
+                output.write (viewBytes (mime.payload));
+                output.close();
+            }
+        }
+    });
+
+    writer->endRecord();
+}
+
+// Writes the "records" of a message or of a Smart Poster, and returns how many
+// there are. Like walkNDEFRecords(), stops at a reserved TNF.
+int writeNDEFRecords (ndef::Bytes data, ndef::RecordContext context)
+{
+    int count = 0;
+    writer->beginRecords ("records");
+    for (const ndef::RecordView& record : ndef::RecordRange (data))
+    {
+        if (record.header.tnf == NDEFRecordType::NDEF_Invalid)
+            break;
+        writeNDEFRecord (record, context);
+        count++;
+    }
+    writer->endRecords();
+    return count;
+}
+
+void decodeNDEFRecord (const NDEFRecord& record, int i, int depth)
 {
-    NDEFMessage msg = NDEFMessage::fromByteArray (data);
     QString prefix("");
     for (int d=0; d<depth; d++) prefix.append("    ");
-    
-    if (msg.isValid()) {
-        info << prefix << "NDEF message is valid and contains " << msg.recordCount() << " NDEF record(s)." << endl;
-        int i = 0;
-        foreach (const NDEFRecord& record, msg.records())
-        {
-            i++;
-            info << prefix << "NDEF record (" << i << ") type name format: " << toTypeNameFormat(record.type().id()) << endl;
-            const QString type_name = record.type().name();
-            info << prefix << "NDEF record (" << i << ") type: " << type_name << endl;
-            
-            switch (record.type().id())
+
+    info << prefix << "NDEF record (" << i << ") type name format: " << toTypeNameFormat(record.type().id()) << endl;
+    const QString type_name = record.type().name();
+    info << prefix << "NDEF record (" << i << ") type: " << type_name << endl;
+
+    // Smart Poster local types are only decoded inside a Smart Poster.
+    const ndef::RecordContext context = (depth > 0) ? ndef::RecordContext::SmartPoster : ndef::RecordContext::Message;
+    ndefVisit (record, context, ndef::Overloaded {
+        [&](const ndef::SmartPosterRecordView& sp)
+        {
+            decodeNDEFMessage (viewBytes (sp.record.payload), depth + 1);
+        },
+        [&](const ndef::TextRecordView& text)
+        {
+            const QString locale_string = QString::fromLatin1 (viewBytes (text.locale)).replace('-', '_');
+            QLocale locale(locale_string);
+            info << prefix << "NDEF record (" << i << ") payload (language): " << QLocale::languageToString (locale.language()) << " (" << locale_string << ")" << endl;
+            info << prefix << "NDEF record (" << i << ") payload (text): " << NDEFRecord::textText(viewBytes (text.record.payload)) << endl;
+        },
+        [&](const ndef::UriRecordView& uri)
+        {
+            info << prefix << "NDEF record (" << i << ") payload (uri): " << QByteArray (uri.prefix.data(), int(uri.prefix.size())) << viewBytes (uri.rest) << endl;
+        },
+        [&](const ndef::SpActionRecordView& action)
+        {
+            info << prefix << "NDEF record (" << i << ") payload (action code): " << action.action << endl;
+        },
+        [&](const ndef::SpSizeRecordView& size)
+        {
+            info << prefix << "NDEF record (" << i << ") payload (size): " << qint32(size.size) << endl;
+        },
+        [&](const ndef::SpTypeRecordView& type)
+        {
+            info << prefix << "NDEF record (" << i << ") payload (type): " << QString::fromUtf8(viewBytes (type.mimeType)) << endl;
+        },
+        [&](const ndef::MimeRecordView& mime)
+        {
+            if (output.isOpen())
             {
-                case NDEFRecordType::NDEF_NfcForumRTD:
-                    if (type_name == QString("Sp"))
-                    {
-                        decodeNDEFMessage (record.payload(), ++depth);
-                    }
-                    else if (type_name == QString("T"))
-                    {
-                        const QString locale_string = NDEFRecord::textLocale(record.payload()).replace('-', '_');
-                        // const QString locale_string = NDEFRecord::textLocale(record.payload());
-                        // const QString locale_string = record.payload().toHex();
-                        QLocale locale(locale_string);
-                        info << prefix << "NDEF record (" << i << ") payload (language): " << QLocale::languageToString (locale.language()) << " (" << locale_string << ")" << endl;
-                        info << prefix << "NDEF record (" << i << ") payload (text): " << NDEFRecord::textText(record.payload()) << endl;
-                    }
-                    else if (type_name == QString("U"))
-                    {
-                        info << prefix << "NDEF record (" << i << ") payload (uri): " << NDEFRecord::uriProtocol (record.payload()) << record.payload().mid(1) << endl;
-                    }
-                    else if ((depth > 0) && (type_name == QString("act")))
-                    {
-                        quint8 action = record.payload().at(0);
-                        info << prefix << "NDEF record (" << i << ") payload (action code): " << action << endl;
-                    }
-                    else if ((depth > 0) && (type_name == QString("s")))
-                    {
-                        QDataStream stream(record.payload());
-                        qint32 size;
-                        stream >> size;
-                        info << prefix << "NDEF record (" << i << ") payload (size): " << size << endl;
-                    }
-                    else if ((depth > 0) && (type_name == QString("t")))
-                    {
-                        info << prefix << "NDEF record (" << i << ") payload (type): " << QString::fromUtf8(record.payload()) << endl;
-                    }
-                    else
-                    {
-                        info << prefix << "NDEF record (" << i << ") payload (hex): " << record.payload().toHex() << endl;
-                    }
-                break;
-                case NDEFRecordType::NDEF_MIME:
-                    if (output.isOpen())
-                    {
-                        output.write (record.payload());
-                        output.close();
-                    }
-                default:
-                    info << prefix << "NDEF record (" << i << ") payload (hex): " << record.payload().toHex() << endl;
+                output.write (viewBytes (mime.payload));
+                output.close();
             }
+            info << prefix << "NDEF record (" << i << ") payload (hex): " << viewBytes (mime.payload).toHex() << endl;
+        },
+        [&](const ndef::RecordView& other)
+        {
+            info << prefix << "NDEF record (" << i << ") payload (hex): " << viewBytes (other.payload).toHex() << endl;
         }
+    });
+}
+
+// Walks the records of data the same way NDEFMessage::fromByteArray() does and
+// returns how many there are. Each record is decoded in turn if decode is set.
+int walkNDEFRecords (const QByteArray& data, int depth, bool decode)
+{
+    int count = 0;
+    int offset = 0;
+    while ((data.count() - offset) > 2)
+    {
+        if ((data.at(offset) & 0x07) == NDEFRecordType::NDEF_Invalid)
+            break;
+
+        count++;
+        if (decode)
+            decodeNDEFRecord (NDEFRecord::fromByteArray (data, offset), count, depth);
+
+        int record_length = NDEFRecord::recordLength (data, offset);
+        if (record_length < 0)
+            break;
+        offset += record_length;
+    }
+    return count;
+}
+
+// Decodes a message already in memory (a mapped file or a Smart Poster
+// payload) one record at a time, without building a NDEFMessage first.
+void decodeNDEFMessage (const QByteArray& data, int depth)
+{
+    if (writer)
+    {
+        writer->beginMessage();
+        int count = writeNDEFRecords (bytesOf (data), ndef::RecordContext::Message);
+        writer->endMessage (count > 0);
+        return;
+    }
+
+    QString prefix("");
+    for (int d=0; d<depth; d++) prefix.append("    ");
+
+    int count = walkNDEFRecords (data, depth, false);
+    if (count > 0) {
+        info << prefix << "NDEF message is valid and contains " << count << " NDEF record(s)." << endl;
+        walkNDEFRecords (data, depth, true);
     }
     else
     {
@@ -124,6 +263,321 @@ void decodeNDEFMessage (const QByteArray data, int depth = 0)
     }
 }
 
+// Decodes the record at offset of a stream buffer.
+static void decodeStreamRecord (const QByteArray& buffer, int offset, int count)
+{
+    if (writer)
+        writeNDEFRecord (ndef::decodeRecord (bytesOf (buffer), std::size_t(offset)), ndef::RecordContext::Message);
+    else
+        decodeNDEFRecord (NDEFRecord::fromByteArray (buffer, offset), count, 0);
+}
+
+// Reads what has arrived on file, up to max bytes, waiting only for the
+// first one. QFile::read() on pipes and terminals waits for all max bytes or
+// for the end of the input. Returns an empty array at the end or on error.
+static QByteArray readAvailable (QFile& file, int max)
+{
+    QByteArray data;
+    data.resize (max);
+    qint64 length;
+    do
+    {
+#ifdef Q_OS_WIN
+        length = _read (file.handle(), data.data(), unsigned(max));
+#else
+        length = ::read (file.handle(), data.data(), size_t(max));
+#endif
+    }
+    while (length < 0 && errno == EINTR);
+    data.resize (length > 0 ? int(length) : 0);
+    return data;
+}
+
+// Records declaring more bytes than this are rejected instead of buffered.
+static const quint64 max_record_size = 16 * 1024 * 1024;
+
+// Decodes a message read from a sequential device (stdin, a pipe...). Each
+// record is printed as soon as it has been received and then dropped, so
+// memory use is bounded by the largest record rather than by the input size.
+int decodeNDEFStream (QFile& device)
+{
+    const int chunk_size = 64 * 1024;
+    QByteArray buffer;
+    int offset = 0;
+    int count = 0;
+    qint64 total = 0;
+    bool at_end = false;
+
+    if (writer)
+    {
+        writer->beginMessage();
+        writer->beginRecords ("records");
+    }
+
+    forever
+    {
+        int record_length = NDEFRecord::recordLength (buffer, offset);
+        if (record_length < 0)
+        {
+            ndef::RecordHeader header;
+            if (ndef::decodeHeader (bytesOf (buffer), std::size_t(offset), header) && header.recordLength() > max_record_size)
+            {
+                err << "Record " << (count + 1) << " is too large (" << header.recordLength() << " bytes)." << endl;
+                break;
+            }
+
+            if (at_end)
+            {
+                // Keep a truncated last record, as NDEFMessage::fromByteArray() does.
+                if ((buffer.count() - offset) > 2 && (buffer.at(offset) & 0x07) != NDEFRecordType::NDEF_Invalid)
+                    decodeStreamRecord (buffer, offset, ++count);
+                break;
+            }
+
+            buffer.remove (0, offset);
+            offset = 0;
+
+            QByteArray chunk = readAvailable (device, chunk_size);
+            if (chunk.isEmpty())
+                at_end = true;
+            total += chunk.count();
+            buffer.append (chunk);
+            continue;
+        }
+
+        if ((buffer.at(offset) & 0x07) == NDEFRecordType::NDEF_Invalid)
+            break;
+
+        count++;
+        decodeStreamRecord (buffer, offset, count);
+        offset += record_length;
+    }
+
+    if (writer)
+    {
+        writer->endRecords();
+        writer->endMessage (count > 0);
+        writer->flush();
+    }
+
+    if (total == 0)
+    {
+        err << "No data to decode." << endl;
+        return 1;
+    }
+
+    if (writer)
+        return 0;
+    if (count > 0)
+        info << "NDEF message is valid and contains " << count << " NDEF record(s)." << endl;
+    else
+        err << "Invalid NDEF message." << endl;
+    return 0;
+}
+
+// Decodes the messages of a capture file, or only the one at index if it is
+// not negative.
+int decodeNDEFCapture (const QString& filename, qint64 index)
+{
+    NDEFCaptureReader capture;
+    if (!capture.open (filename))
+    {
+        err << "Invalid capture file \"" << filename << "\"." << endl;
+        return 1;
+    }
+
+    quint64 first = 0;
+    quint64 last = capture.messageCount();
+    if (index >= 0)
+    {
+        if (quint64(index) >= last)
+        {
+            err << "Capture contains only " << last << " message(s)." << endl;
+            return 1;
+        }
+        first = index;
+        last = index + 1;
+    }
+
+    for (quint64 i = first; i < last; i++)
+    {
+        NDEFCaptureMetadata metadata = capture.metadata (i);
+        if (writer)
+        {
+            const QByteArray message = capture.message (i);
+            const QByteArray reader = metadata.readerId();
+            const QByteArray uid = metadata.tagUid();
+            writer->beginMessage();
+            writer->numberField ("index", i);
+            writer->numberField ("timestamp", metadata.timestamp());
+            writer->textField ("reader", bytesOf (reader));
+            writer->bytesField ("tag_uid", bytesOf (uid));
+            int count = writeNDEFRecords (bytesOf (message), ndef::RecordContext::Message);
+            writer->endMessage (count > 0);
+            continue;
+        }
+        info << "Capture message (" << i << ") timestamp: " << metadata.timestamp() << endl;
+        info << "Capture message (" << i << ") reader: " << QString::fromUtf8 (metadata.readerId()) << endl;
+        info << "Capture message (" << i << ") tag UID: " << metadata.tagUid().toHex() << endl;
+        decodeNDEFMessage (capture.message (i));
+    }
+    return 0;
+}
+
+/* Server mode (-s): requests and responses are frames, a 4-byte big-endian
+length followed by that many bytes. A request holds a NDEF message; its
+response holds, in UTF-8, the report decoding it would print. Responses come
+in the order of the requests, so clients may send several requests without
+waiting. Frames larger than max_frame_size close the connection.
+*/
+static const quint32 max_frame_size = 16 * 1024 * 1024;
+
+// What the decoders print in server mode, instead of stderr.
+static QString report;
+
+// The frames received on one connection so far. The buffers are kept from
+// one request to the next.
+class DecodeSession
+{
+    QByteArray m_buffer;
+    QByteArray m_responses;
+
+public:
+    // Decodes the complete requests of data and what was left of the previous
+    // ones. Returns false if a request is too large.
+    bool feed (const QByteArray& data)
+    {
+        m_buffer.append (data);
+
+        int offset = 0;
+        bool ok = true;
+        while ((m_buffer.count() - offset) >= 4)
+        {
+            const uchar* header = reinterpret_cast<const uchar*>(m_buffer.constData() + offset);
+            const quint32 length = (quint32(header[0]) << 24) | (quint32(header[1]) << 16) | (quint32(header[2]) << 8) | header[3];
+            if (length > max_frame_size)
+            {
+                ok = false;
+                break;
+            }
+            if (quint32(m_buffer.count() - offset - 4) < length)
+                break;
+
+            // Decoded in place.
+            report.clear();
+            decodeNDEFMessage (QByteArray::fromRawData (m_buffer.constData() + offset + 4, int(length)));
+            info.flush();
+            err.flush();
+            offset += 4 + int(length);
+
+            const QByteArray response = writer ? writer->takeBuffer() : report.toUtf8();
+            const quint32 response_length = quint32(response.count());
+            m_responses.append (char(response_length >> 24));
+            m_responses.append (char(response_length >> 16));
+            m_responses.append (char(response_length >> 8));
+            m_responses.append (char(response_length));
+            m_responses.append (response);
+        }
+
+        m_buffer.remove (0, offset);
+        return ok;
+    }
+
+    // The responses of the requests decoded so far.
+    QByteArray takeResponses ()
+    {
+        const QByteArray responses = m_responses;
+        m_responses.clear();
+        return responses;
+    }
+};
+
+// Serves any number of clients on a Unix domain socket (a named pipe on
+// Windows), from the event loop.
+class DecodeServer : public QObject
+{
+    Q_OBJECT
+
+    QLocalServer m_server;
+    QHash<QLocalSocket*, DecodeSession*> m_sessions;
+
+public:
+    bool listen (const QString& name)
+    {
+        // Left behind by a server that did not exit cleanly.
+        QLocalServer::removeServer (name);
+        connect (&m_server, SIGNAL(newConnection()), this, SLOT(acceptConnections()));
+        return m_server.listen (name);
+    }
+
+    QString errorString () const
+    {
+        return m_server.errorString();
+    }
+
+    ~DecodeServer ()
+    {
+        qDeleteAll (m_sessions);
+    }
+
+private slots:
+    void acceptConnections ()
+    {
+        while (QLocalSocket* socket = m_server.nextPendingConnection())
+        {
+            m_sessions.insert (socket, new DecodeSession);
+            connect (socket, SIGNAL(readyRead()), this, SLOT(readRequests()));
+            connect (socket, SIGNAL(disconnected()), this, SLOT(closeConnection()));
+        }
+    }
+
+    void readRequests ()
+    {
+        QLocalSocket* socket = qobject_cast<QLocalSocket*>(sender());
+        DecodeSession* session = m_sessions.value (socket);
+        if (!session)
+            return;
+
+        bool ok = session->feed (socket->readAll());
+        socket->write (session->takeResponses());
+        if (!ok)
+            socket->disconnectFromServer();
+    }
+
+    void closeConnection ()
+    {
+        QLocalSocket* socket = qobject_cast<QLocalSocket*>(sender());
+        delete m_sessions.take (socket);
+        socket->deleteLater();
+    }
+};
+
+// Serves one client on stdin and stdout, until stdin is closed.
+int serveStdio ()
+{
+    QFile input;
+    QFile output;
+    // Read with readAvailable(), so that each request is answered as soon as
+    // it is complete, whether or not the client sends more.
+    if (!input.open (fileno(stdin), QIODevice::ReadOnly | QIODevice::Unbuffered)
+        || !output.open (fileno(stdout), QIODevice::WriteOnly))
+        return 1;
+
+    DecodeSession session;
+    forever
+    {
+        const QByteArray data = readAvailable (input, 64 * 1024);
+        if (data.isEmpty())
+            return 0;
+
+        bool ok = session.feed (data);
+        output.write (session.takeResponses());
+        output.flush();
+        if (!ok)
+            return 1;
+    }
+}
+
 int main(int argc, char *argv[])
 {
     QCoreApplication app (argc, argv);
@@ -131,10 +585,42 @@ int main(int argc, char *argv[])
     QStringList arguments = app.arguments();
 
     QFile input;
+    qint64 capture_index = -1;
+    QString server_name;
+    QString format ("text");
+    NDEFWriter::Encoding payload_encoding = NDEFWriter::Hex;
 
     for (int i=1; i<arguments.count(); i++)
     {
-        if (arguments.at(i).at(0) == '-')
+        if (arguments.at(i).startsWith ("--"))
+        {
+            const QString argument = arguments.at(i);
+            if (argument.startsWith ("--format="))
+            {
+                format = argument.mid (9);
+                if (format != "text" && format != "jsonl" && format != "cbor")
+                {
+                    err << "Unknown format: " << format << " (text, jsonl or cbor)" << endl;
+                    return 1;
+                }
+            }
+            else if (argument.startsWith ("--payload="))
+            {
+                const QString encoding = argument.mid (10);
+                if (encoding != "hex" && encoding != "base64")
+                {
+                    err << "Unknown payload encoding: " << encoding << " (hex or base64)" << endl;
+                    return 1;
+                }
+                payload_encoding = (encoding == "base64") ? NDEFWriter::Base64 : NDEFWriter::Hex;
+            }
+            else
+            {
+                err << "Unknown option: " << argument << endl;
+                return 1;
+            }
+        }
+        else if (arguments.at(i).at(0) == '-')
         {
             if (arguments.at(i).at(1) == 'o')
             {
@@ -153,6 +639,30 @@ int main(int argc, char *argv[])
                     return 1;
                 }
             }
+            else if (arguments.at(i).at(1) == 'n')
+            {
+                bool ok = false;
+                if ((i+1) < arguments.size())
+                {
+                    i++;
+                    capture_index = arguments.at(i).toLongLong(&ok);
+                }
+                if (!ok || capture_index < 0)
+                {
+                    err << "-n option requires a message index (e.g. 0)" << endl;
+                    return 1;
+                }
+            }
+            else if (arguments.at(i).at(1) == 's')
+            {
+                if ((i+1) >= arguments.size())
+                {
+                    err << "-s option requires a socket name (or - for stdin and stdout)" << endl;
+                    return 1;
+                }
+                i++;
+                server_name = arguments.at(i);
+            }
             else
             {
                 err << "Unknown option: " << arguments.at(i).at(1) << endl;
@@ -172,21 +682,73 @@ int main(int argc, char *argv[])
         }
     }
 
+    // Structured output goes to stdout through the writer's buffer, or into
+    // the responses in server mode.
+    QFile standard_output;
+    QScopedPointer<NDEFWriter> writer_owner;
+    if (format != "text")
+    {
+        QIODevice* device = 0;
+        if (server_name.isEmpty())
+        {
+            standard_output.open (fileno(stdout), QIODevice::WriteOnly | QIODevice::Unbuffered);
+            device = &standard_output;
+        }
+        if (format == "cbor")
+            writer = new NDEFCborWriter (device);
+        else
+            writer = new NDEFJsonWriter (device, payload_encoding);
+        writer_owner.reset (writer);
+    }
+
+    if (!server_name.isEmpty())
+    {
+        // Reports go into the responses from now on.
+        QTextStream log(stderr);
+        info.setString (&report);
+        err.setString (&report);
+
+        if (server_name == "-")
+            return serveStdio();
+
+        DecodeServer server;
+        if (!server.listen (server_name))
+        {
+            log << "Unable to listen on \"" << server_name << "\": " << server.errorString() << endl;
+            return 1;
+        }
+        return app.exec();
+    }
+
     if (!input.isOpen())
     {
         qDebug() << "Use stdin as input file";
-        input.open ( stdin, QIODevice::ReadOnly );
+        // Streamed with readAvailable(), so that records are decoded as they arrive.
+        input.open ( fileno(stdin), QIODevice::ReadOnly | QIODevice::Unbuffered );
     }
 
-    if (input.isOpen ()) {
-        QByteArray data = input.readAll();
-        if (data.isEmpty())
+    if (!input.isOpen ())
+        return 1;
+
+    // Regular files are mapped and decoded in place, anything else is streamed.
+    if (!input.isSequential() && input.size() > 0)
+    {
+        uchar* map = input.map (0, input.size());
+        if (map)
         {
-            err << "No data to decode." << endl;
-            return 1;
+            const QByteArray data = QByteArray::fromRawData (reinterpret_cast<const char*>(map), input.size());
+            if (NDEFCaptureReader::isCapture (data))
+            {
+                input.unmap (map);
+                return decodeNDEFCapture (input.fileName(), capture_index);
+            }
+            decodeNDEFMessage (data);
+            input.unmap (map);
+            return 0;
         }
-        decodeNDEFMessage (data);
     }
-    return 0;
+
+    return decodeNDEFStream (input);
 }
 
+#include "ndef-decode.moc"
@@ -19,18 +19,21 @@
 ##
 
 QT       -= gui
+QT       += network
 
 TARGET = ndef-decode
 CONFIG   += console
 CONFIG   -= app_bundle
 
 TEMPLATE = app
+greaterThan(QT_MAJOR_VERSION, 4): CONFIG += c++17
+else: QMAKE_CXXFLAGS += -std=c++17
 
 INCLUDEPATH += ../include
 
 win32: {
     LIBS += -L../libndef/release/
-    LIBS += -lndef1
+    LIBS += -lndef2
 }
 
 unix: {
@@ -43,7 +46,9 @@ unix: {
     PRE_TARGETDEPS += ../libndef/libndef.so
 }
 
-SOURCES += ndef-decode.cpp
+HEADERS += ndefoutput.h
+SOURCES += ndef-decode.cpp \
+    ndefoutput.cpp
 
 unix: {
     # install binairies
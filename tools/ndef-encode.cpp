@@ -21,8 +21,11 @@
 #include <QDebug>
 #include <QStringList>
 #include <QFile>
+#include <QDateTime>
  
 #include <ndef/ndefmessage.h>
+#include <ndef/ndefcapture.h>
+#include <ndef/core/record.h>
 
 QTextStream out(stdout);
 QTextStream err(stderr);
@@ -32,6 +35,70 @@ QFile output;
 
 typedef QList<NDEFRecord> NDEFRecordList;
 
+// Writes data in pieces, so that a mapped file is paged in as it is written.
+static bool writeBytes(QIODevice& device, const char* data, qint64 length)
+{
+    const qint64 piece_size = 1024 * 1024;
+    for (qint64 offset = 0; offset < length; offset += piece_size)
+    {
+        const qint64 size = qMin(piece_size, length - offset);
+        if (device.write(data + offset, size) != size)
+            return false;
+    }
+    return true;
+}
+
+// Writes one record, or chunk of a record, from its parts.
+static bool writeRecordPart(QIODevice& device, quint8 flags, ndef::TypeNameFormat tnf, const QByteArray& type, const QByteArray& id, const char* payload, qint64 length)
+{
+    uchar header[7];
+    flags = ndef::recordFlags(flags, id.count(), std::size_t(length));
+    const qint64 header_length = qint64(ndef::encodeHeader(header, flags, tnf, quint8(type.count()), quint32(length), quint8(id.count())));
+    return device.write(reinterpret_cast<const char*>(header), header_length) == header_length
+        && device.write(type) == type.count()
+        && device.write(id) == id.count()
+        && writeBytes(device, payload, length);
+}
+
+/* Writes a record. Large payloads (those of MIME files) are written after
+the header, straight from their mapping, instead of being copied into an
+encoded record first. If chunk_size is positive, payloads larger than that are
+written as chunked records: the first chunk has the type and ID, the next
+ones TNF Unchanged.
+*/
+static bool writeRecord(QIODevice& device, const NDEFRecord& record, quint8 flags, int chunk_size)
+{
+    const NDEFRecordType type = record.type();
+    const QByteArray payload = record.payload();
+    const ndef::TypeNameFormat tnf = ndef::TypeNameFormat(type.id());
+    const QByteArray type_name = (tnf == ndef::Unknown || tnf == ndef::Unchanged) ? QByteArray() : type.name();
+
+    if (chunk_size <= 0 || payload.count() <= chunk_size)
+    {
+        if (payload.count() < 64 * 1024)
+        {
+            const QByteArray data = record.toByteArray(flags);
+            return device.write(data) == data.count();
+        }
+        return writeRecordPart(device, flags, tnf, type_name, record.id(), payload.constData(), payload.count());
+    }
+
+    const quint8 message_begin = flags & NDEFRecord::NDEF_MB;
+    const quint8 message_end = flags & NDEFRecord::NDEF_ME;
+    for (int offset = 0; offset < payload.count(); offset += chunk_size)
+    {
+        const int length = qMin(chunk_size, payload.count() - offset);
+        const bool first = (offset == 0);
+        const bool last = (offset + length == payload.count());
+        const quint8 chunk_flags = (first ? message_begin : 0) | (last ? message_end : NDEFRecord::NDEF_CF);
+        if (!writeRecordPart(device, chunk_flags, first ? tnf : ndef::Unchanged,
+                             first ? type_name : QByteArray(), first ? record.id() : QByteArray(),
+                             payload.constData() + offset, length))
+            return false;
+    }
+    return true;
+}
+
 void print_usage(const QString& appName)
 {
         err << "Usage: " << appName << " [OUTPUT] OPTIONS" << endl;
@@ -41,16 +108,23 @@ void print_usage(const QString& appName)
         err << "  -t TEXT LOCALE		create new TextRecord" << endl;
         err << "  -u URI			create new UriRecord" << endl;
         err << "  -m MIME-TYPE FILE		create new MimeRecord" << endl;
+        err << "  -k SIZE			write payloads larger than SIZE bytes as chunked records" << endl;
         err << "  -sp URI			create and open a new SmartPosterRecord" << endl;
         err << "  -s-				close current SmartPoster" << endl;
         err << "  -sa ACTION			create new SpActionRecord" << endl;
         err << "  -ss SIZE			create new SpSizeRecord" << endl;
-        err << "  -st TYPE			create new SpTypeRecord" << endl << endl;
+        err << "  -st TYPE			create new SpTypeRecord" << endl;
+        err << "  -c CAPTURE			append the message to a capture file instead of OUTPUT" << endl;
+        err << "  -cr READER			reader ID stored with the captured message" << endl;
+        err << "  -cu UID			tag UID (hex) stored with the captured message" << endl;
+        err << "  -ct TIMESTAMP		capture time in ms since epoch (default: now)" << endl << endl;
         err << "Examples:" << endl;
         err << "  Create a NDEF Message than contains an URL:" << endl;
         err << "    " << appName << " libndef_website.ndef -sp \"http://libndef.googlecode.com\" -t \"libndef\" \"en-US\" -s-" << endl;
         err << "  Create a NDEF Message than contains an electronic card (vCard):" << endl;
         err << "    " << appName << " myvcard.ndef -m \"text/x-vCard\" ./my_vcard.vcf" << endl;
+        err << "  Append a NDEF Message to a capture file:" << endl;
+        err << "    " << appName << " -c taps.ndefcap -cr \"gate-1\" -cu 04a224b1c25e80 -u \"http://libnfc.org\"" << endl;
 }
 
 typedef enum {
@@ -81,6 +155,12 @@ int main(int argc, char *argv[])
 
     QString current_sp_uri;
 
+    QString capture_filename;
+    QByteArray capture_reader_id;
+    QByteArray capture_tag_uid;
+    quint64 capture_timestamp = QDateTime::currentMSecsSinceEpoch();
+    int chunk_size = 0;
+
     for (int i=1; i<arguments.count(); i++)
     {
         if (arguments.at(i).at(0) == '-')
@@ -129,15 +209,28 @@ int main(int argc, char *argv[])
                 const QString mimetype = arguments.at(i);
                 i++;
                 const QString mimefilename = arguments.at(i);
-                QFile mimefile;
-                mimefile.setFileName(mimefilename);
-                mimefile.open (QIODevice::ReadOnly );
-                if (!mimefile.isOpen())
+                // The file stays mapped until exit and the record refers to the
+                // mapping: its payload is only copied if the record has to be
+                // put into a Smart Poster or a capture file.
+                QFile* mimefile = new QFile(mimefilename, &app);
+                mimefile->open (QIODevice::ReadOnly );
+                if (!mimefile->isOpen())
                 {
                     err << "Unable to load MIME file: " << mimefilename << endl;
                     return 1;
                 }
-                ndef_containers.last().append(NDEFRecord::createMimeRecord(mimetype, mimefile.readAll()));
+                if (mimefile->size() > 0x7FFFFFFF)
+                {
+                    err << "MIME file too large: " << mimefilename << endl;
+                    return 1;
+                }
+                QByteArray payload;
+                uchar* map = (mimefile->size() > 0) ? mimefile->map(0, mimefile->size()) : 0;
+                if (map)
+                    payload = QByteArray::fromRawData(reinterpret_cast<const char*>(map), int(mimefile->size()));
+                else
+                    payload = mimefile->readAll();
+                ndef_containers.last().append(NDEFRecord::createMimeRecord(mimetype, payload));
             }
                 break;
             case 's': // SmartPosterRecord
@@ -244,6 +337,62 @@ int main(int argc, char *argv[])
                 }
             }
                 break;
+            case 'c': // Capture file
+            {
+                char c_option = (arguments.at(i).size() > 2) ? arguments.at(i).at(2).toLatin1() : 0;
+                if ((i+1) >= arguments.size())
+                {
+                    err << arguments.at(i) << " option requires an argument" << endl;
+                    return 1;
+                }
+                i++;
+                switch (c_option)
+                {
+                case 0: // -c: capture file
+                    capture_filename = arguments.at(i);
+                    break;
+                case 'r': // -cr: reader ID
+                    capture_reader_id = arguments.at(i).toUtf8();
+                    break;
+                case 'u': // -cu: tag UID
+#if (QT_VERSION < QT_VERSION_CHECK(5, 0, 0))
+                    capture_tag_uid = QByteArray::fromHex(arguments.at(i).toAscii());
+#else
+                    capture_tag_uid = QByteArray::fromHex(arguments.at(i).toLatin1());
+#endif
+                    break;
+                case 't': // -ct: timestamp
+                {
+                    bool ok;
+                    capture_timestamp = arguments.at(i).toULongLong(&ok);
+                    if (!ok)
+                    {
+                        err << "-ct option requires a timestamp in ms since epoch (e.g. 1300000000000)" << endl;
+                        return 1;
+                    }
+                    break;
+                }
+                default:
+                    err << "-c option need a suffix (e.g. -c (capture file), -cr (reader ID), -cu (tag UID) or -ct (timestamp))" << endl;
+                    return 1;
+                }
+            }
+                break;
+            case 'k': // Chunk size
+            {
+                bool ok = false;
+                if ((i+1) < arguments.size())
+                {
+                    i++;
+                    chunk_size = arguments.at(i).toInt(&ok);
+                }
+                if (!ok || chunk_size <= 0)
+                {
+                    err << "-k option requires a chunk size in bytes (e.g. 4096)" << endl;
+                    return 1;
+                }
+            }
+                break;
             case 'h':
             {
                 print_usage (arguments.at(0));
@@ -293,14 +442,39 @@ int main(int argc, char *argv[])
         print_usage(arguments.at(0));
         return 1;
     }
+    if (!capture_filename.isEmpty())
+    {
+        NDEFCaptureWriter capture;
+        if (!capture.open(capture_filename))
+        {
+            err << "Unable to open capture file \"" << capture_filename << "\"." << endl;
+            return 1;
+        }
+        NDEFMessage msg(ndef_containers.last());
+        if (!capture.append(msg, NDEFCaptureMetadata(capture_timestamp, capture_reader_id, capture_tag_uid)) || !capture.close())
+        {
+            err << "Unable to write capture file \"" << capture_filename << "\"." << endl;
+            return 1;
+        }
+        return 0;
+    }
     if (!output.isOpen())
     {
         output.open ( stdout, QIODevice::WriteOnly );
     }
     if (output.isOpen ()) {
-        // NDEFMessage contains data
-        NDEFMessage msg(ndef_containers.last());
-        output.write(msg.toByteArray());
+        // Written record by record: peak memory does not depend on the size
+        // of MIME files.
+        const NDEFRecordList& records = ndef_containers.last();
+        for (int i = 0; i < records.count(); i++)
+        {
+            const quint8 flags = ((i == 0) ? NDEFRecord::NDEF_MB : 0) | ((i == records.count() - 1) ? NDEFRecord::NDEF_ME : 0);
+            if (!writeRecord(output, records.at(i), flags, chunk_size))
+            {
+                err << "Unable to write output." << endl;
+                return 1;
+            }
+        }
     }
     return 0;
 }
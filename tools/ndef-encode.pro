@@ -25,12 +25,14 @@ CONFIG   += console
 CONFIG   -= app_bundle
 
 TEMPLATE = app
+greaterThan(QT_MAJOR_VERSION, 4): CONFIG += c++17
+else: QMAKE_CXXFLAGS += -std=c++17
 
 INCLUDEPATH += ../include
 
 win32: {
     LIBS += -L../libndef/release/
-    LIBS += -lndef1
+    LIBS += -lndef2
 }
 
 unix: {
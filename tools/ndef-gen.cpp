@@ -0,0 +1,476 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QDebug>
+#include <QStringList>
+#include <QTextStream>
+#include <QtCore/qmath.h>
+
+#include <ndef/ndefmessage.h>
+#include <ndef/ndefcapture.h>
+#include <ndef/tlv.h>
+
+QTextStream err(stderr);
+
+// Reader IDs stored with each generated message, telling how it was wrapped.
+static const char plain_reader[] = "ndef-gen";
+static const char tlv_reader[] = "ndef-gen/tlv";
+static const char corrupt_reader[] = "ndef-gen/corrupt";
+
+enum RecordKind
+{
+    UriKind,
+    TextKind,
+    MimeKind,
+    SmartPosterKind,
+    GenericControlKind,
+    ChunkedKind,
+    KindCount
+};
+
+static const char* kind_names[KindCount] = { "uri", "text", "mime", "sp", "gc", "chunked" };
+
+/* xorshift64* seeded through splitmix64: the same seed gives the same corpus
+on every platform and Qt version, which qrand() does not guarantee.
+*/
+class Random
+{
+protected:
+    quint64 m_state;
+
+public:
+    Random(quint64 seed)
+    {
+        quint64 z = seed + Q_UINT64_C(0x9E3779B97F4A7C15);
+        z = (z ^ (z >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+        m_state = (z ^ (z >> 31)) | 1;
+    }
+
+    quint64 next()
+    {
+        m_state ^= m_state >> 12;
+        m_state ^= m_state << 25;
+        m_state ^= m_state >> 27;
+        return m_state * Q_UINT64_C(0x2545F4914F6CDD1D);
+    }
+
+    // Uniform in [min, max].
+    int range(int min, int max)
+    {
+        return min + int(next() % quint64(max - min + 1));
+    }
+
+    // Log-uniform in [min, max]: small payloads are the most frequent, as on tags.
+    int logRange(int min, int max)
+    {
+        double low = qLn(qMax(min, 1));
+        double high = qLn(qMax(max, 1));
+        double x = low + (high - low) * (double(next() >> 11) / double(Q_UINT64_C(1) << 53));
+        return qBound(min, int(qExp(x)), max);
+    }
+
+    bool percent(int p)
+    {
+        return range(0, 99) < p;
+    }
+
+    QByteArray bytes(int size)
+    {
+        QByteArray data(size, Qt::Uninitialized);
+        for (int i = 0; i < size; i++)
+            data[i] = char(next() >> 56);
+        return data;
+    }
+};
+
+class Generator
+{
+public:
+    Random random;
+    int weights[KindCount];
+    int min_records;
+    int max_records;
+    int min_payload;
+    int max_payload;
+
+    Generator(quint64 seed)
+        :   random(seed),
+            min_records(1),
+            max_records(4),
+            min_payload(8),
+            max_payload(4096)
+    {
+        const int default_weights[KindCount] = { 40, 25, 10, 15, 5, 5 };
+        for (int i = 0; i < KindCount; i++)
+            weights[i] = default_weights[i];
+    }
+
+    RecordKind pickKind()
+    {
+        int total = 0;
+        for (int i = 0; i < KindCount; i++)
+            total += weights[i];
+
+        int x = random.range(0, total - 1);
+        for (int i = 0; i < KindCount; i++)
+        {
+            if (x < weights[i])
+                return RecordKind(i);
+            x -= weights[i];
+        }
+        return UriKind;
+    }
+
+    QString uri()
+    {
+        static const char* prefixes[] = { "http://www.", "https://www.", "http://", "https://", "tel:+39", "mailto:", "urn:epc:id:sgtin:", "geo:" };
+        static const char* hosts[] = { "libnfc.org", "example.com", "nfc-forum.org", "shop.example.net" };
+        const int prefix = random.range(0, 7);
+
+        QString path;
+        int segments = random.range(0, 3);
+        for (int i = 0; i < segments; i++)
+            path += "/" + QString::number(random.next() % 100000, 36);
+
+        // One draw per statement: the evaluation order of operands is unspecified.
+        const int a = random.range(0, 999999);
+        const int b = random.range(0, 999999);
+        const char* host = hosts[random.range(0, 3)];
+
+        switch (prefix)
+        {
+            case 4: return QString(prefixes[prefix]) + QString::number(a) + QString::number(b);
+            case 5: return QString(prefixes[prefix]) + "user" + QString::number(a % 1000) + "@" + host;
+            case 6: return QString(prefixes[prefix]) + QString::number(a) + "." + QString::number(b);
+            case 7: return QString(prefixes[prefix]) + QString::number(a % 181 - 90) + "," + QString::number(b % 361 - 180);
+            default: return QString(prefixes[prefix]) + host + path;
+        }
+    }
+
+    NDEFRecord textRecord(int size)
+    {
+        static const char* locales[] = { "en-US", "fr", "de-DE", "it", "ja", "zh-CN", "ar", "ru" };
+        static const char* samples[] = {
+            "Welcome, tap to continue. ",
+            "Bienvenue, touchez pour continuer. ",
+            "Willkommen, zum Fortfahren tippen. ",
+            "Benvenuto, tocca per continuare. ",
+            "\xe3\x82\x88\xe3\x81\x86\xe3\x81\x93\xe3\x81\x9d ",
+            "\xe6\xac\xa2\xe8\xbf\x8e ",
+            "\xd9\x85\xd8\xb1\xd8\xad\xd8\xa8\xd8\xa7 ",
+            "\xd0\x94\xd0\xbe\xd0\xb1\xd1\x80\xd0\xbe \xd0\xbf\xd0\xbe\xd0\xb6\xd0\xb0\xd0\xbb\xd0\xbe\xd0\xb2\xd0\xb0\xd1\x82\xd1\x8c " };
+        const int locale = random.range(0, 7);
+
+        const QString sample = QString::fromUtf8(samples[locale]);
+        QString text;
+        while (text.count() < size)
+            text += sample;
+        text.truncate(qMax(size, 1));
+
+        NDEFRecord::NDEFRecordTextCodec codec = random.percent(20) ? NDEFRecord::NDEF_UTF16 : NDEFRecord::NDEF_UTF8;
+        return NDEFRecord::createTextRecord(text, locales[locale], codec);
+    }
+
+    NDEFRecord mimeRecord(int size)
+    {
+        static const char* types[] = { "text/vcard", "application/json", "image/png", "application/vnd.bluetooth.ep.oob", "application/octet-stream" };
+        return NDEFRecord::createMimeRecord(types[random.range(0, 4)], random.bytes(size));
+    }
+
+    NDEFRecord smartPosterRecord(int depth)
+    {
+        NDEFRecordList records;
+        records.append(textRecord(random.logRange(4, 64)));
+        if (random.percent(50))
+            records.append(NDEFRecord::createSpActionRecord(NDEFRecord::NDEFRecordAction(random.range(0, 2))));
+        if (random.percent(30))
+            records.append(NDEFRecord::createSpSizeRecord(random.range(0, 1 << 20)));
+        if (random.percent(30))
+            records.append(NDEFRecord::createSpTypeRecord("text/html"));
+        // Nested Smart Posters are unusual but legal.
+        if (depth < 2 && random.percent(10))
+            records.append(smartPosterRecord(depth + 1));
+
+        return NDEFRecord::createSmartPosterRecord(uri(), records);
+    }
+
+    NDEFRecord genericControlRecord()
+    {
+        NDEFRecord target = random.percent(70) ? NDEFRecord::createUriRecord(uri()) : textRecord(random.logRange(4, 32));
+        NDEFRecord data = random.percent(50) ? textRecord(random.logRange(4, 64)) : NDEFRecord();
+        quint8 config = random.percent(50) ? NDEFRecord::CheckExitCondition : 0;
+        return NDEFRecord::createGenericControlRecord(config, target, NDEFRecord::NDEFRecordAction(random.range(0, 2)), data);
+    }
+
+    // A MIME payload split into a chunk series: typed first chunk, then
+    // TNF Unchanged chunks, the last one without the CF flag.
+    NDEFRecordList chunkedRecords(int size)
+    {
+        NDEFRecordList records;
+        QByteArray payload = random.bytes(size);
+        int chunk_size = qMax(1, random.range(qMax(size / 8, 1), qMax(size / 2, 1)));
+
+        NDEFRecord first = mimeRecord(0);
+        first.setPayload(payload.left(chunk_size));
+        first.setChuncked(true);
+        records.append(first);
+
+        for (int offset = chunk_size; offset < payload.count(); offset += chunk_size)
+            records.append(NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Unchanged), QByteArray(), payload.mid(offset, chunk_size), true));
+
+        if (records.count() == 1)
+            records.append(NDEFRecord(NDEFRecordType(NDEFRecordType::NDEF_Unchanged), QByteArray(), QByteArray(), false));
+        else
+            records.last().setChuncked(false);
+        return records;
+    }
+
+    QByteArray message()
+    {
+        NDEFMessage msg;
+        int record_count = random.range(min_records, max_records);
+        for (int i = 0; i < record_count; i++)
+        {
+            switch (pickKind())
+            {
+                case UriKind:            msg.appendRecord(NDEFRecord::createUriRecord(uri())); break;
+                case TextKind:           msg.appendRecord(textRecord(random.logRange(min_payload, max_payload))); break;
+                case MimeKind:           msg.appendRecord(mimeRecord(random.logRange(min_payload, max_payload))); break;
+                case SmartPosterKind:    msg.appendRecord(smartPosterRecord(0)); break;
+                case GenericControlKind: msg.appendRecord(genericControlRecord()); break;
+                case ChunkedKind:
+                    foreach (const NDEFRecord& record, chunkedRecords(random.logRange(qMax(min_payload, 2), max_payload)))
+                        msg.appendRecord(record);
+                    break;
+                default: break;
+            }
+        }
+        return msg.toByteArray();
+    }
+
+    // A Type 2 tag memory dump: NULL TLV padding, the NDEF TLV, a terminator
+    // and zeroed memory up to a multiple of 16 bytes.
+    QByteArray tlvDump(const QByteArray& message)
+    {
+        QByteArray dump(random.range(0, 8), char(Tlv::Null));
+        dump.append(Tlv(Tlv::NDEF, message).toByteArray());
+        dump.append(Tlv::createTerminatorTlv().toByteArray());
+        dump.append(QByteArray((16 - dump.count() % 16) % 16 + 16 * random.range(0, 4), 0));
+        return dump;
+    }
+
+    QByteArray corrupt(QByteArray data)
+    {
+        if (data.isEmpty())
+            return data;
+
+        switch (random.range(0, 3))
+        {
+            case 0: // Truncated.
+                data.truncate(random.range(0, data.count() - 1));
+                break;
+            case 1: // Flipped byte.
+            {
+                int offset = random.range(0, data.count() - 1);
+                data[offset] = char(data.at(offset) ^ (1 << random.range(0, 7)));
+            }
+                break;
+            case 2: // Reserved TNF.
+                data[0] = char(data.at(0) | 0x07);
+                break;
+            case 3: // Payload length larger than the data.
+                if (data.count() > 2)
+                    data[2] = char(0xFF);
+                break;
+        }
+        return data;
+    }
+};
+
+void print_usage(const QString& appName)
+{
+        err << "Usage: " << appName << " OUTPUT [OPTIONS]" << endl;
+        err << "Generate a reproducible corpus of NDEF messages in the capture file OUTPUT." << endl << endl;
+        err << "Options:" << endl;
+        err << "  -n COUNT		number of messages (default: 1000)" << endl;
+        err << "  -s SEED		random seed (default: 1)" << endl;
+        err << "  -w KIND=WEIGHT	relative weight of a record kind: uri, text, mime, sp, gc, chunked" << endl;
+        err << "			(default: uri=40 text=25 mime=10 sp=15 gc=5 chunked=5)" << endl;
+        err << "  -r MIN:MAX		records per message (default: 1:4)" << endl;
+        err << "  -p MIN:MAX		Text and MIME payload size in bytes, log-uniform (default: 8:4096)" << endl;
+        err << "  -t PERCENT		share of messages stored as a padded TLV dump (default: 0)" << endl;
+        err << "  -c PERCENT		share of corrupted messages (default: 0)" << endl << endl;
+        err << "The reader ID of each message is \"" << plain_reader << "\", \"" << tlv_reader << "\" or \"" << corrupt_reader << "\"." << endl;
+}
+
+static bool parseRange(const QString& value, int* min, int* max)
+{
+    QStringList parts = value.split(':');
+    if (parts.count() != 2)
+        return false;
+
+    bool ok_min, ok_max;
+    *min = parts.at(0).toInt(&ok_min);
+    *max = parts.at(1).toInt(&ok_max);
+    return ok_min && ok_max && *min >= 0 && *min <= *max;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app (argc, argv);
+
+    QStringList arguments = app.arguments();
+
+    QString output_filename;
+    int count = 1000;
+    quint64 seed = 1;
+    int tlv_percent = 0;
+    int corrupt_percent = 0;
+    QStringList weight_options;
+    QString record_range;
+    QString payload_range;
+
+    for (int i=1; i<arguments.count(); i++)
+    {
+        if (arguments.at(i).at(0) == '-')
+        {
+            char option = arguments.at(i).size() > 1 ? arguments.at(i).at(1).toLatin1() : 0;
+            if (option == 'h')
+            {
+                print_usage(arguments.at(0));
+                return 0;
+            }
+            if ((i+1) >= arguments.size())
+            {
+                err << arguments.at(i) << " option requires an argument" << endl;
+                return 1;
+            }
+            i++;
+            const QString value = arguments.at(i);
+            bool ok = true;
+            switch (option)
+            {
+                case 'n': count = value.toInt(&ok); ok = ok && count >= 0; break;
+                case 's': seed = value.toULongLong(&ok); break;
+                case 't': tlv_percent = value.toInt(&ok); break;
+                case 'c': corrupt_percent = value.toInt(&ok); break;
+                case 'w': weight_options.append(value); break;
+                case 'r': record_range = value; break;
+                case 'p': payload_range = value; break;
+                default:
+                    err << "Unknown option: " << arguments.at(i-1) << endl;
+                    return 1;
+            }
+            if (!ok)
+            {
+                err << "Invalid value for " << arguments.at(i-1) << ": " << value << endl;
+                return 1;
+            }
+        }
+        else
+        {
+            output_filename = arguments.at(i);
+        }
+    }
+
+    if (output_filename.isEmpty())
+    {
+        print_usage(arguments.at(0));
+        return 1;
+    }
+
+    Generator generator(seed);
+
+    foreach (const QString& option, weight_options)
+    {
+        QStringList parts = option.split('=');
+        int kind = 0;
+        while (kind < KindCount && (parts.count() != 2 || parts.at(0) != kind_names[kind]))
+            kind++;
+        bool ok = false;
+        if (kind < KindCount)
+            generator.weights[kind] = parts.at(1).toInt(&ok);
+        if (!ok || generator.weights[kind] < 0)
+        {
+            err << "Invalid weight: " << option << endl;
+            return 1;
+        }
+    }
+    int total_weight = 0;
+    for (int i = 0; i < KindCount; i++)
+        total_weight += generator.weights[i];
+    if (total_weight == 0)
+    {
+        err << "At least one record kind needs a weight." << endl;
+        return 1;
+    }
+
+    if ((!record_range.isEmpty() && !parseRange(record_range, &generator.min_records, &generator.max_records))
+        || (!payload_range.isEmpty() && !parseRange(payload_range, &generator.min_payload, &generator.max_payload)))
+    {
+        err << "Ranges must be given as MIN:MAX." << endl;
+        return 1;
+    }
+    generator.min_records = qMax(generator.min_records, 1);
+    generator.max_records = qMax(generator.max_records, 1);
+
+    // The capture is rewritten from scratch so that it only depends on the seed.
+    QFile::remove(output_filename);
+    NDEFCaptureWriter capture;
+    if (!capture.open(output_filename))
+    {
+        err << "Unable to open output file." << endl;
+        return 1;
+    }
+
+    // Fixed timestamps, one second apart, keep the output reproducible.
+    const quint64 timestamp = Q_UINT64_C(1300000000000);
+    for (int i = 0; i < count; i++)
+    {
+        QByteArray message = generator.message();
+        const char* reader = plain_reader;
+
+        if (generator.random.percent(tlv_percent))
+        {
+            message = generator.tlvDump(message);
+            reader = tlv_reader;
+        }
+        if (generator.random.percent(corrupt_percent))
+        {
+            message = generator.corrupt(message);
+            reader = corrupt_reader;
+        }
+
+        QByteArray uid = generator.random.bytes(7);
+        uid[0] = 0x04; // NXP manufacturer code, as on most Type 2 tags.
+
+        if (!capture.append(message, NDEFCaptureMetadata(timestamp + quint64(i) * 1000, reader, uid)))
+        {
+            err << "Unable to write output file." << endl;
+            return 1;
+        }
+    }
+
+    if (!capture.close())
+    {
+        err << "Unable to write output file." << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,322 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QRegularExpression>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include "ndefcorpus.h"
+#include <ndef/ndefrecord.h>
+#include <ndef/core/record.h>
+#include <ndef/core/text.h>
+#include <ndef/core/uri.h>
+#include <stdio.h>
+
+QTextStream err(stderr);
+
+// Smart Poster records are searched this deep.
+static const int max_depth = 4;
+
+static bool isWellKnown(const ndef::RecordView& record, char type)
+{
+    return record.header.tnf == ndef::WellKnown && record.type.size() == 1 && record.type[0] == uchar(type);
+}
+
+static QByteArray bytesOf(ndef::Bytes bytes)
+{
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(bytes.data()), int(bytes.size()));
+}
+
+static bool isSmartPoster(const ndef::RecordView& record)
+{
+    return record.header.tnf == ndef::WellKnown && bytesOf(record.type) == "Sp";
+}
+
+/* The predicates of the command line. A message matches if one of its
+records, or of the records of its Smart Posters, matches all of them.
+
+They are tested from the cheapest to the dearest, so that most records are
+rejected from their header and first bytes: TNF, type and ID lengths and
+bytes, then the URI identifier code and the bytes the URI must start with.
+Only records that pass all of these have their URI rebuilt for a substring
+or a regular expression, or their UTF-16 text decoded.
+*/
+class RecordFilter
+{
+public:
+    int tnf;                        // -1 for any.
+    QByteArray type;
+    bool hasType;
+    QByteArray id;
+    bool hasId;
+    QByteArray uriPrefix;
+    QByteArray uriSubstring;
+    QRegularExpression uriPattern;
+    QByteArray text;                // UTF-8.
+
+    // Per URI identifier code: whether a URI with it can start with
+    // uriPrefix, and what the rest of the URI must then start with.
+    bool codeAllowed[256];
+    QByteArray codeRest[256];
+
+    RecordFilter()
+        :   tnf(-1),
+            hasType(false),
+            hasId(false)
+    {
+    }
+
+    bool hasUri() const
+    {
+        return !uriPrefix.isEmpty() || !uriSubstring.isEmpty() || !uriPattern.pattern().isEmpty();
+    }
+
+    void prepare()
+    {
+        for (int code = 0; code < 256; code++)
+        {
+            const std::string_view prefix = ndef::uriPrefix(quint8(code));
+            const QByteArray code_prefix = QByteArray::fromRawData(prefix.data(), int(prefix.size()));
+            codeAllowed[code] = uriPrefix.startsWith(code_prefix) || code_prefix.startsWith(uriPrefix);
+            codeRest[code] = uriPrefix.mid(qMin(code_prefix.count(), uriPrefix.count()));
+        }
+    }
+
+    bool matchRecord(const ndef::RecordView& record) const
+    {
+        // 1) Header and type: no payload byte read.
+        if (tnf >= 0 && record.header.tnf != tnf)
+            return false;
+        if (hasType)
+        {
+            if (record.type.size() != std::size_t(type.count()))
+                return false;
+            const QByteArray record_type = bytesOf(record.type);
+            if (record.header.tnf == ndef::Media ? qstrnicmp(record_type.constData(), type.constData(), uint(type.count())) != 0
+                                                 : record_type != type)
+                return false;
+        }
+        if (hasId && (record.id.size() != std::size_t(id.count()) || bytesOf(record.id) != id))
+            return false;
+
+        // 2) URI: identifier code and first bytes, then the whole URI.
+        if (hasUri())
+        {
+            if (!isWellKnown(record, 'U') || record.payload.empty())
+                return false;
+            const quint8 code = record.payload[0];
+            const QByteArray rest = bytesOf(record.payload.mid(1));
+            if (!codeAllowed[code] || !rest.startsWith(codeRest[code]))
+                return false;
+            if (!uriSubstring.isEmpty() || !uriPattern.pattern().isEmpty())
+            {
+                const std::string_view prefix = ndef::uriPrefix(code);
+                const QByteArray uri = QByteArray(prefix.data(), int(prefix.size())) + rest;
+                if (!uriSubstring.isEmpty() && !uri.contains(uriSubstring))
+                    return false;
+                if (!uriPattern.pattern().isEmpty() && !uriPattern.match(QString::fromUtf8(uri)).hasMatch())
+                    return false;
+            }
+        }
+
+        // 3) Text, searched as UTF-8 bytes unless the record is UTF-16.
+        if (!text.isEmpty())
+        {
+            if (!isWellKnown(record, 'T') || record.payload.empty())
+                return false;
+            const ndef::TextView view = ndef::decodeText(record.payload);
+            if (!view.utf16)
+                return bytesOf(view.text).contains(text);
+            return NDEFRecord::textText(bytesOf(record.payload)).contains(QString::fromUtf8(text));
+        }
+        return true;
+    }
+
+    bool matchMessage(ndef::Bytes message, int depth = 0) const
+    {
+        // The message ends at its ME record; a truncated record and the bytes
+        // after the ME record are not searched.
+        for (const ndef::RecordView& record : ndef::RecordRange(message))
+        {
+            if (!record.complete)
+                break;
+            if (matchRecord(record))
+                return true;
+            if (depth < max_depth && isSmartPoster(record) && matchMessage(record.payload, depth + 1))
+                return true;
+            if (record.header.isMessageEnd())
+                break;
+        }
+        return false;
+    }
+};
+
+static bool parseTnf(const QString& value, int* tnf)
+{
+    static const char* names[] = { "empty", "wellknown", "mime", "uri", "external", "unknown", "unchanged" };
+    for (int i = 0; i < int(sizeof(names) / sizeof(names[0])); i++)
+    {
+        if (value == names[i])
+        {
+            *tnf = i;
+            return true;
+        }
+    }
+    bool ok = false;
+    *tnf = value.toInt(&ok);
+    return ok && *tnf >= 0 && *tnf < 7;
+}
+
+void print_usage(const QString& appName)
+{
+        err << "Usage: " << appName << " [OPTIONS] PATH..." << endl;
+        err << "Print the NDEF messages of PATH matching all the given predicates." << endl;
+        err << "PATH is a message file, a capture file, a directory (searched recursively) or - for stdin;" << endl;
+        err << "matches are printed as PATH, or PATH:INDEX for capture messages." << endl << endl;
+        err << "Options:" << endl;
+        err << "  -t TNF		record TNF: empty, wellknown, mime, uri, external, unknown, unchanged or 0-6" << endl;
+        err << "  -T TYPE		record type (case-insensitive for MIME types)" << endl;
+        err << "  -i ID		record ID" << endl;
+        err << "  -u PREFIX		URI starting with PREFIX (e.g. https://example.com/)" << endl;
+        err << "  -U TEXT		URI containing TEXT" << endl;
+        err << "  -E REGEX		URI matching the regular expression REGEX" << endl;
+        err << "  -x TEXT		Text record containing TEXT" << endl;
+        err << "  -j THREADS		number of threads (default: one per core)" << endl;
+        err << "  -c			only print the number of matching messages" << endl << endl;
+        err << "Records nested in Smart Posters are searched too; bytes after the ME record are not." << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app (argc, argv);
+
+    QStringList arguments = app.arguments();
+
+    RecordFilter filter;
+    QStringList paths;
+    int thread_count = QThread::idealThreadCount();
+    bool count_only = false;
+
+    for (int i=1; i<arguments.count(); i++)
+    {
+        if (arguments.at(i).at(0) == '-' && arguments.at(i).size() > 1)
+        {
+            char option = arguments.at(i).at(1).toLatin1();
+            if (option == 'h')
+            {
+                print_usage(arguments.at(0));
+                return 0;
+            }
+            if (option == 'c')
+            {
+                count_only = true;
+                continue;
+            }
+            if ((i+1) >= arguments.size())
+            {
+                err << arguments.at(i) << " option requires an argument" << endl;
+                return 2;
+            }
+            i++;
+            const QString value = arguments.at(i);
+            bool ok = true;
+            switch (option)
+            {
+                case 't': ok = parseTnf(value, &filter.tnf); break;
+                case 'T': filter.type = value.toUtf8(); filter.hasType = true; break;
+                case 'i': filter.id = value.toUtf8(); filter.hasId = true; break;
+                case 'u': filter.uriPrefix = value.toUtf8(); break;
+                case 'U': filter.uriSubstring = value.toUtf8(); break;
+                case 'E': filter.uriPattern.setPattern(value); ok = filter.uriPattern.isValid(); break;
+                case 'x': filter.text = value.toUtf8(); break;
+                case 'j': thread_count = value.toInt(&ok); ok = ok && thread_count > 0; break;
+                default:
+                    err << "Unknown option: " << arguments.at(i-1) << endl;
+                    return 2;
+            }
+            if (!ok)
+            {
+                err << "Invalid value for " << arguments.at(i-1) << ": " << value << endl;
+                return 2;
+            }
+        }
+        else
+        {
+            paths.append(arguments.at(i));
+        }
+    }
+
+    if (paths.isEmpty())
+    {
+        print_usage(arguments.at(0));
+        return 2;
+    }
+    filter.prepare();
+
+    // Record types a match needs at the top level of a message, for the
+    // capture indexes: the one searched for, or a Smart Poster around it.
+    QList<NDEFRecordType> wanted;
+    if (filter.hasUri())
+        wanted << NDEFRecordType::uriRecordType();
+    else if (!filter.text.isEmpty())
+        wanted << NDEFRecordType::textRecordType();
+    else if (filter.tnf >= 0 && filter.hasType && filter.tnf != ndef::Media)     // MIME types match in any case, the indexes do not.
+        wanted << NDEFRecordType(NDEFRecordType::NDEFRecordTypeId(filter.tnf), filter.type);
+    if (!wanted.isEmpty())
+        wanted << NDEFRecordType::smartPosterRecordType();
+
+    // 1) Files and capture blocks.
+    NDEFCorpus corpus;
+    const int errors = corpus.addPaths(paths, wanted);
+
+    // 2) Search; each unit has its own output, so that matches are printed
+    // in the order of the files and messages.
+    QVector<QByteArray> outputs(corpus.unitCount());
+    QVector<quint64> unit_matches(corpus.unitCount(), 0);
+    QByteArray* const output_data = outputs.data();
+    quint64* const match_data = unit_matches.data();
+    corpus.run(thread_count, [&](int unit, int) {
+        corpus.visitUnit(unit, [&](const QString& path, qint64 index, ndef::Bytes message) {
+            if (!filter.matchMessage(message))
+                return;
+            match_data[unit]++;
+            if (!count_only)
+                output_data[unit].append((index < 0 ? path : path + ':' + QString::number(index)).toUtf8()).append('\n');
+        });
+    });
+
+    // 3) Matches.
+    QFile standard_output;
+    standard_output.open(fileno(stdout), QIODevice::WriteOnly);
+    quint64 matches = 0;
+    for (int i = 0; i < outputs.count(); i++)
+    {
+        matches += unit_matches.at(i);
+        standard_output.write(outputs.at(i));
+    }
+    if (count_only)
+        standard_output.write(QByteArray::number(matches) + '\n');
+    standard_output.flush();
+
+    if (errors > 0)
+        return 2;
+    return matches > 0 ? 0 : 1;
+}
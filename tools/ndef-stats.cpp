@@ -0,0 +1,488 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+#include "ndefcorpus.h"
+#include <ndef/core/record.h>
+#include <ndef/core/text.h>
+#include <ndef/core/uri.h>
+#include <algorithm>
+
+QTextStream out(stdout);
+QTextStream err(stderr);
+
+// Smart Posters are followed this deep.
+static const int max_depth = 4;
+// Distinct types and locales counted one by one, per thread; the others are
+// counted together, so that memory stays bounded whatever the corpus.
+static const int max_types = 1024;
+static const int max_locales = 256;
+static const QByteArray other_key("\xff(other)");
+
+static const char* tnf_names[8] = { "empty", "wellknown", "mime", "uri", "external", "unknown", "unchanged", "reserved" };
+
+static QByteArray bytesOf(ndef::Bytes bytes)
+{
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(bytes.data()), int(bytes.size()));
+}
+
+/* Counts of values in power-of-two buckets: 0, 1, 2-3, 4-7... up to 2^32,
+with their sum and maximum.
+*/
+class Histogram
+{
+public:
+    static const int BucketCount = 34;
+
+    quint64 buckets[BucketCount];
+    quint64 count;
+    quint64 sum;
+    quint64 max;
+
+    Histogram()
+        :   count(0),
+            sum(0),
+            max(0)
+    {
+        for (int i = 0; i < BucketCount; i++)
+            buckets[i] = 0;
+    }
+
+    static int bucket(quint64 value)
+    {
+        int bucket = 0;
+        while (value && bucket < BucketCount - 1)
+        {
+            value >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    void add(quint64 value)
+    {
+        buckets[bucket(value)]++;
+        count++;
+        sum += value;
+        max = qMax(max, value);
+    }
+
+    void merge(const Histogram& other)
+    {
+        for (int i = 0; i < BucketCount; i++)
+            buckets[i] += other.buckets[i];
+        count += other.count;
+        sum += other.sum;
+        max = qMax(max, other.max);
+    }
+
+    // One line per bucket holding values.
+    void print(QTextStream& stream) const
+    {
+        for (int i = 0; i < BucketCount; i++)
+        {
+            if (buckets[i] == 0)
+                continue;
+            const quint64 low = i ? (Q_UINT64_C(1) << (i - 1)) : 0;
+            const quint64 high = i ? (low * 2 - 1) : 0;
+            stream << "  " << QString::number(low).rightJustified(10) << " .. " << QString::number(high).leftJustified(10)
+                   << QString::number(buckets[i]).rightJustified(12)
+                   << "  " << QString::number(100.0 * buckets[i] / count, 'f', 2) << "%" << endl;
+        }
+        if (count)
+            stream << "  mean " << QString::number(double(sum) / count, 'f', 1) << ", max " << max << endl;
+    }
+
+    // The buckets on one line, as "HIGH:COUNT" pairs.
+    QString summary() const
+    {
+        QStringList parts;
+        for (int i = 0; i < BucketCount; i++)
+            if (buckets[i])
+                parts << QString("<=%1:%2").arg(i ? (Q_UINT64_C(1) << i) - 1 : 0).arg(buckets[i]);
+        return parts.join(" ");
+    }
+};
+
+struct TypeStats
+{
+    quint64 records;
+    Histogram payload;
+
+    TypeStats()
+        :   records(0)
+    {
+    }
+};
+
+/* Everything counted over the messages one thread has seen. Threads have one
+each, merged at the end: counting takes no lock.
+*/
+class CorpusStats
+{
+public:
+    quint64 messages;
+    quint64 emptyMessages;          // No record could be read.
+    Histogram messageSize;
+    Histogram recordCount;          // Top-level records per message.
+    quint64 depths[max_depth + 1];  // Messages per Smart Poster nesting depth.
+
+    quint64 records;
+    quint64 tnfs[8];
+    QHash<QByteArray, TypeStats> types;     // TNF byte + type name.
+    quint64 uriCodes[256];
+    quint64 utf8Texts;
+    quint64 utf16Texts;
+    QHash<QByteArray, quint64> locales;
+
+    quint64 chunks;                 // Records with CF set.
+    quint64 chunkedPayloads;        // Runs of such records.
+    quint64 paddedMessages;
+    quint64 paddingBytes;           // After the ME record.
+    quint64 truncatedRecords;       // Cut by the end of their message.
+    quint64 longRecords;
+    quint64 longButShort;           // Long form, payload of 255 bytes or less.
+
+    CorpusStats()
+        :   messages(0),
+            emptyMessages(0),
+            records(0),
+            utf8Texts(0),
+            utf16Texts(0),
+            chunks(0),
+            chunkedPayloads(0),
+            paddedMessages(0),
+            paddingBytes(0),
+            truncatedRecords(0),
+            longRecords(0),
+            longButShort(0)
+    {
+        for (int i = 0; i <= max_depth; i++)
+            depths[i] = 0;
+        for (int i = 0; i < 8; i++)
+            tnfs[i] = 0;
+        for (int i = 0; i < 256; i++)
+            uriCodes[i] = 0;
+    }
+
+    void addMessage(ndef::Bytes message)
+    {
+        messages++;
+        messageSize.add(message.size());
+
+        int depth = 0;
+        quint64 count = 0;
+        const std::size_t end = addRecords(message, 0, &depth, &count);
+        if (count == 0)
+            emptyMessages++;
+        recordCount.add(count);
+        depths[depth]++;
+        if (count > 0 && end < message.size())
+        {
+            paddedMessages++;
+            paddingBytes += message.size() - end;
+        }
+    }
+
+    /* Returns where the records end. The message ends at its ME record: the
+    bytes after it are padding. A truncated record is not counted as a record
+    and runs to the end of the message.
+    */
+    std::size_t addRecords(ndef::Bytes message, int depth, int* deepest, quint64* count)
+    {
+        std::size_t end = 0;
+        bool in_chunk = false;
+        for (const ndef::RecordView& record : ndef::RecordRange(message))
+        {
+            if (!record.complete)
+            {
+                truncatedRecords++;
+                return message.size();
+            }
+            (*count)++;
+            end = record.offset + record.size();
+            addRecord(record);
+
+            if (record.header.isChunk())
+            {
+                chunks++;
+                if (!in_chunk)
+                    chunkedPayloads++;
+            }
+            in_chunk = record.header.isChunk();
+
+            if (depth < max_depth && record.header.tnf == ndef::WellKnown && bytesOf(record.type) == "Sp")
+            {
+                *deepest = qMax(*deepest, depth + 1);
+                quint64 nested = 0;
+                addRecords(record.payload, depth + 1, deepest, &nested);
+            }
+
+            if (record.header.isMessageEnd())
+                break;
+        }
+        return end;
+    }
+
+    void addRecord(const ndef::RecordView& record)
+    {
+        records++;
+        tnfs[record.header.tnf]++;
+
+        QByteArray key(1, char(record.header.tnf));
+        key += bytesOf(record.type);
+        if (!types.contains(key) && types.count() >= max_types)
+            key = other_key;
+        TypeStats& type = types[key];
+        type.records++;
+        type.payload.add(record.payload.size());
+
+        if (!record.header.isShort())
+        {
+            longRecords++;
+            if (record.header.payloadLength <= 0xFF)
+                longButShort++;
+        }
+
+        if (record.header.tnf != ndef::WellKnown || record.type.size() != 1 || record.payload.empty())
+            return;
+        if (record.type[0] == 'U')
+        {
+            uriCodes[record.payload[0]]++;
+        }
+        else if (record.type[0] == 'T')
+        {
+            const ndef::TextView text = ndef::decodeText(record.payload);
+            if (text.utf16)
+                utf16Texts++;
+            else
+                utf8Texts++;
+            QByteArray locale = QByteArray(reinterpret_cast<const char*>(text.locale.data()), int(text.locale.size()));
+            if (!locales.contains(locale) && locales.count() >= max_locales)
+                locale = other_key;
+            locales[locale]++;
+        }
+    }
+
+    void merge(const CorpusStats& other)
+    {
+        messages += other.messages;
+        emptyMessages += other.emptyMessages;
+        messageSize.merge(other.messageSize);
+        recordCount.merge(other.recordCount);
+        for (int i = 0; i <= max_depth; i++)
+            depths[i] += other.depths[i];
+
+        records += other.records;
+        for (int i = 0; i < 8; i++)
+            tnfs[i] += other.tnfs[i];
+        for (QHash<QByteArray, TypeStats>::const_iterator it = other.types.constBegin(); it != other.types.constEnd(); ++it)
+        {
+            const QByteArray key = (types.contains(it.key()) || types.count() < max_types) ? it.key() : other_key;
+            TypeStats& type = types[key];
+            type.records += it.value().records;
+            type.payload.merge(it.value().payload);
+        }
+        for (int i = 0; i < 256; i++)
+            uriCodes[i] += other.uriCodes[i];
+        utf8Texts += other.utf8Texts;
+        utf16Texts += other.utf16Texts;
+        for (QHash<QByteArray, quint64>::const_iterator it = other.locales.constBegin(); it != other.locales.constEnd(); ++it)
+            locales[(locales.contains(it.key()) || locales.count() < max_locales) ? it.key() : other_key] += it.value();
+
+        chunks += other.chunks;
+        chunkedPayloads += other.chunkedPayloads;
+        paddedMessages += other.paddedMessages;
+        paddingBytes += other.paddingBytes;
+        truncatedRecords += other.truncatedRecords;
+        longRecords += other.longRecords;
+        longButShort += other.longButShort;
+    }
+};
+
+static QString percent(quint64 value, quint64 total)
+{
+    return QString::number(total ? 100.0 * value / total : 0.0, 'f', 2) + "%";
+}
+
+static QString typeName(const QByteArray& key)
+{
+    if (key == other_key)
+        return "(other)";
+    return QString("%1 %2").arg(tnf_names[quint8(key.at(0)) & 0x07]).arg(QString::fromUtf8(key.mid(1)));
+}
+
+template <typename T>
+static bool moreRecords(const QPair<QByteArray, T>& a, const QPair<QByteArray, T>& b)
+{
+    return a.second > b.second;
+}
+
+static void printReport(const CorpusStats& stats, int top)
+{
+    out << "Messages: " << stats.messages << " (" << stats.emptyMessages << " without any record)" << endl;
+    out << "Records: " << stats.records << " (nested ones included)" << endl << endl;
+
+    out << "Message size (bytes):" << endl;
+    stats.messageSize.print(out);
+    out << endl << "Records per message:" << endl;
+    stats.recordCount.print(out);
+
+    out << endl << "Smart Poster nesting depth:" << endl;
+    for (int i = 0; i <= max_depth; i++)
+        if (stats.depths[i])
+            out << "  " << i << "  " << stats.depths[i] << "  " << percent(stats.depths[i], stats.messages) << endl;
+
+    out << endl << "TNF:" << endl;
+    for (int i = 0; i < 8; i++)
+        if (stats.tnfs[i])
+            out << "  " << tnf_names[i] << "  " << stats.tnfs[i] << "  " << percent(stats.tnfs[i], stats.records) << endl;
+
+    QList<QPair<QByteArray, quint64> > types;
+    for (QHash<QByteArray, TypeStats>::const_iterator it = stats.types.constBegin(); it != stats.types.constEnd(); ++it)
+        types << qMakePair(it.key(), it.value().records);
+    std::sort(types.begin(), types.end(), moreRecords<quint64>);
+    out << endl << "Types (records, payload bytes: mean, max, size buckets):" << endl;
+    for (int i = 0; i < types.count() && i < top; i++)
+    {
+        const TypeStats type = stats.types.value(types.at(i).first);
+        out << "  " << typeName(types.at(i).first) << "  " << type.records << "  " << percent(type.records, stats.records)
+            << "  mean " << QString::number(double(type.payload.sum) / type.records, 'f', 1) << ", max " << type.payload.max << endl;
+        out << "    " << type.payload.summary() << endl;
+    }
+    if (types.count() > top)
+        out << "  ... " << (types.count() - top) << " more" << endl;
+
+    out << endl << "URI identifier codes:" << endl;
+    quint64 uris = 0;
+    for (int i = 0; i < 256; i++)
+        uris += stats.uriCodes[i];
+    for (int i = 0; i < 256; i++)
+    {
+        if (!stats.uriCodes[i])
+            continue;
+        const std::string_view prefix = ndef::uriPrefix(quint8(i));
+        out << "  0x" << QString::number(i, 16).rightJustified(2, '0') << " \"" << QString::fromLatin1(prefix.data(), int(prefix.size()))
+            << "\"  " << stats.uriCodes[i] << "  " << percent(stats.uriCodes[i], uris) << endl;
+    }
+
+    out << endl << "Text records: " << (stats.utf8Texts + stats.utf16Texts) << " (UTF-8 " << stats.utf8Texts
+        << ", UTF-16 " << stats.utf16Texts << ")" << endl;
+    QList<QPair<QByteArray, quint64> > locales;
+    for (QHash<QByteArray, quint64>::const_iterator it = stats.locales.constBegin(); it != stats.locales.constEnd(); ++it)
+        locales << qMakePair(it.key(), it.value());
+    std::sort(locales.begin(), locales.end(), moreRecords<quint64>);
+    for (int i = 0; i < locales.count() && i < top; i++)
+        out << "  " << (locales.at(i).first == other_key ? QString("(other)") : QString::fromUtf8(locales.at(i).first))
+            << "  " << locales.at(i).second << "  " << percent(locales.at(i).second, stats.utf8Texts + stats.utf16Texts) << endl;
+
+    out << endl << "Chunked payloads: " << stats.chunkedPayloads << " (" << stats.chunks << " records with CF set)" << endl;
+    out << "Padded messages: " << stats.paddedMessages << " (" << percent(stats.paddedMessages, stats.messages)
+        << "), " << stats.paddingBytes << " bytes after the ME record" << endl;
+    out << "Truncated records: " << stats.truncatedRecords << endl;
+    out << "Long records: " << stats.longRecords << ", " << stats.longButShort << " of which would fit the short form ("
+        << percent(stats.longButShort, stats.records) << " of the records, " << (3 * stats.longButShort) << " bytes)" << endl;
+}
+
+void print_usage(const QString& appName)
+{
+        err << "Usage: " << appName << " [OPTIONS] PATH..." << endl;
+        err << "Print statistics over the NDEF messages of PATH: a message file, a capture file," << endl;
+        err << "a directory (searched recursively) or - for stdin." << endl << endl;
+        err << "Options:" << endl;
+        err << "  -j THREADS		number of threads (default: one per core)" << endl;
+        err << "  -n COUNT		types and locales listed (default: 20)" << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app (argc, argv);
+
+    QStringList arguments = app.arguments();
+
+    QStringList paths;
+    int thread_count = QThread::idealThreadCount();
+    int top = 20;
+
+    for (int i=1; i<arguments.count(); i++)
+    {
+        if (arguments.at(i).at(0) == '-' && arguments.at(i).size() > 1)
+        {
+            char option = arguments.at(i).at(1).toLatin1();
+            if (option == 'h')
+            {
+                print_usage(arguments.at(0));
+                return 0;
+            }
+            if ((i+1) >= arguments.size())
+            {
+                err << arguments.at(i) << " option requires an argument" << endl;
+                return 1;
+            }
+            i++;
+            const QString value = arguments.at(i);
+            bool ok = true;
+            switch (option)
+            {
+                case 'j': thread_count = value.toInt(&ok); ok = ok && thread_count > 0; break;
+                case 'n': top = value.toInt(&ok); ok = ok && top >= 0; break;
+                default:
+                    err << "Unknown option: " << arguments.at(i-1) << endl;
+                    return 1;
+            }
+            if (!ok)
+            {
+                err << "Invalid value for " << arguments.at(i-1) << ": " << value << endl;
+                return 1;
+            }
+        }
+        else
+        {
+            paths.append(arguments.at(i));
+        }
+    }
+
+    if (paths.isEmpty())
+    {
+        print_usage(arguments.at(0));
+        return 1;
+    }
+
+    NDEFCorpus corpus;
+    const int errors = corpus.addPaths(paths);
+
+    // One set of counters per thread, merged once all are done.
+    QVector<CorpusStats> thread_stats(qMax(1, thread_count));
+    CorpusStats* const stats = thread_stats.data();
+    corpus.run(thread_count, [&](int unit, int thread) {
+        corpus.visitUnit(unit, [&](const QString&, qint64, ndef::Bytes message) {
+            stats[thread].addMessage(message);
+        });
+    });
+    for (int i = 1; i < thread_stats.count(); i++)
+        stats[0].merge(stats[i]);
+
+    printReport(stats[0], top);
+    return errors > 0 ? 1 : 0;
+}
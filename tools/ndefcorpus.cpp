@@ -0,0 +1,193 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefcorpus.h"
+#include <QtCore/QAtomicInt>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QRunnable>
+#include <QtCore/QTextStream>
+#include <QtCore/QThreadPool>
+#include <stdio.h>
+
+extern QTextStream err;
+
+// Takes units until there are none left.
+class NDEFCorpusTask : public QRunnable
+{
+    const std::function<void (int, int)>& m_work;
+    QAtomicInt& m_next;
+    int m_unitCount;
+    int m_thread;
+
+public:
+    NDEFCorpusTask(const std::function<void (int, int)>& work, QAtomicInt& next, int unit_count, int thread)
+        :   m_work(work),
+            m_next(next),
+            m_unitCount(unit_count),
+            m_thread(thread)
+    {
+    }
+
+    void run()
+    {
+        for (int i = m_next.fetchAndAddRelaxed(1); i < m_unitCount; i = m_next.fetchAndAddRelaxed(1))
+            m_work(i, m_thread);
+    }
+};
+
+static ndef::Bytes bytesOf(const QByteArray& data)
+{
+    return ndef::Bytes(data.constData(), std::size_t(data.count()));
+}
+
+NDEFCorpus::NDEFCorpus()
+{
+}
+
+NDEFCorpus::~NDEFCorpus()
+{
+    qDeleteAll(m_captures);
+}
+
+int NDEFCorpus::addPaths(const QStringList& paths, const QList<NDEFRecordType>& wanted)
+{
+    QStringList files;
+    foreach (const QString& path, paths)
+    {
+        if (QFileInfo(path).isDir())
+        {
+            QStringList directory_files;
+            QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+            while (it.hasNext())
+                directory_files.append(it.next());
+            directory_files.sort();
+            files += directory_files;
+        }
+        else
+        {
+            files.append(path);
+        }
+    }
+
+    int errors = 0;
+    foreach (const QString& path, files)
+    {
+        Source source = { path, 0, QByteArray() };
+        if (path == "-")
+        {
+            QFile input;
+            input.open(fileno(stdin), QIODevice::ReadOnly);
+            source.data = input.readAll();
+        }
+        else
+        {
+            QFile file(path);
+            if (!file.open(QIODevice::ReadOnly))
+            {
+                err << "Unable to read \"" << path << "\"." << endl;
+                errors++;
+                continue;
+            }
+            if (NDEFCaptureReader::isCapture(file.read(16)))
+            {
+                NDEFCaptureReader* capture = new NDEFCaptureReader;
+                m_captures.append(capture);
+                if (!capture->open(path))
+                {
+                    err << "Invalid capture file \"" << path << "\"." << endl;
+                    errors++;
+                    continue;
+                }
+                source.capture = capture;
+            }
+        }
+        m_sources.append(source);
+
+        if (!source.capture)
+        {
+            Unit unit = { m_sources.count() - 1, 0, 1 };
+            m_units.append(unit);
+            continue;
+        }
+
+        // One unit per block that may hold what is wanted.
+        for (int block = 0; block < source.capture->blockCount(); block++)
+        {
+            bool may_match = wanted.isEmpty();
+            for (int i = 0; !may_match && i < wanted.count(); i++)
+                may_match = source.capture->blockMayContain(block, wanted.at(i));
+            if (!may_match)
+                continue;
+
+            const quint64 first = source.capture->blockFirstMessage(block);
+            Unit unit = { m_sources.count() - 1, first, first + source.capture->blockMessageCount(block) };
+            m_units.append(unit);
+        }
+    }
+    return errors;
+}
+
+int NDEFCorpus::unitCount() const
+{
+    return m_units.count();
+}
+
+void NDEFCorpus::visitUnit(int unit, const Visitor& visitor) const
+{
+    const Unit& u = m_units.at(unit);
+    const Source& source = m_sources.at(u.source);
+    if (source.capture)
+    {
+        for (quint64 i = u.first; i < u.last; i++)
+            visitor(source.path, qint64(i), bytesOf(source.capture->message(i)));
+        return;
+    }
+    if (source.path == "-")
+    {
+        visitor(source.path, -1, bytesOf(source.data));
+        return;
+    }
+
+    // Mapped, read if it cannot be.
+    QFile file(source.path);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    uchar* map = file.size() > 0 ? file.map(0, file.size()) : 0;
+    if (map)
+    {
+        visitor(source.path, -1, ndef::Bytes(map, std::size_t(file.size())));
+        file.unmap(map);
+    }
+    else
+    {
+        const QByteArray data = file.readAll();
+        visitor(source.path, -1, bytesOf(data));
+    }
+}
+
+void NDEFCorpus::run(int thread_count, const std::function<void (int unit, int thread)>& work) const
+{
+    // A pool of our own, so that all of its threads are free.
+    QThreadPool pool;
+    pool.setMaxThreadCount(thread_count);
+    QAtomicInt next(0);
+    for (int i = 0; i < qMin(thread_count, m_units.count()); i++)
+        pool.start(new NDEFCorpusTask(work, next, m_units.count(), i));
+    pool.waitForDone();
+}
@@ -0,0 +1,84 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFCORPUS_H
+#define NDEFCORPUS_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
+#include <ndef/ndefcapture.h>
+#include <ndef/core/bytes.h>
+#include <functional>
+
+/* The messages given to the corpus tools (ndef-grep, ndef-stats): message
+files, capture files, directories searched recursively and - for stdin.
+
+They are cut into units, handed out to threads by run(): a message file, or
+a block of a capture file. Files are mapped one unit at a time and captures
+are mapped once, so memory use does not grow with the corpus.
+*/
+
+class NDEFCorpus
+{
+public:
+    // The visitor of a unit's messages. index is -1 for message files.
+    typedef std::function<void (const QString& path, qint64 index, ndef::Bytes message)> Visitor;
+
+protected:
+    struct Source
+    {
+        QString path;
+        NDEFCaptureReader* capture;
+        QByteArray data;            // Standard input, read beforehand.
+    };
+
+    struct Unit
+    {
+        int source;
+        quint64 first;
+        quint64 last;
+    };
+
+    QVector<Source> m_sources;
+    QVector<Unit> m_units;
+    QList<NDEFCaptureReader*> m_captures;
+
+public:
+    NDEFCorpus();
+    virtual ~NDEFCorpus();
+
+    /* Adds the messages of paths, in the order of the paths and of the files
+    of each directory. Capture blocks holding none of the wanted record types
+    at the top level of their messages are left out. Errors are printed to
+    err; returns the number of paths that could not be read.
+    */
+    int addPaths(const QStringList& paths, const QList<NDEFRecordType>& wanted = QList<NDEFRecordType>());
+
+    int unitCount() const;
+    void visitUnit(int unit, const Visitor& visitor) const;
+
+    // Calls work(unit, thread) once per unit, on thread_count threads numbered
+    // from 0, and returns when all units are done.
+    void run(int thread_count, const std::function<void (int unit, int thread)>& work) const;
+
+private:
+    Q_DISABLE_COPY(NDEFCorpus)
+};
+
+#endif // NDEFCORPUS_H
@@ -0,0 +1,404 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#include "ndefoutput.h"
+#include <string.h>
+
+// SSE2 is part of x86-64; SSSE3 is used when the CPU has it.
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NDEF_OUTPUT_SSE2
+#endif
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <tmmintrin.h>
+#define NDEF_OUTPUT_SSSE3
+#endif
+
+static const char hex_digits[] = "0123456789abcdef";
+static const char base64_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+void ndefAppendHex(QByteArray& out, ndef::Bytes bytes)
+{
+    const int start = out.size();
+    out.resize(start + 2 * int(bytes.size()));
+    char* dst = out.data() + start;
+    const quint8* src = bytes.data();
+    std::size_t i = 0;
+
+#ifdef NDEF_OUTPUT_SSE2
+    // 16 bytes at a time: split into nibbles, interleave them, then map
+    // 0-9 to '0'-'9' and 10-15 to 'a'-'f'.
+    const __m128i low_nibbles = _mm_set1_epi8(0x0F);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i digits = _mm_set1_epi8('0');
+    const __m128i letters = _mm_set1_epi8('a' - '0' - 10);
+    for (; i + 16 <= bytes.size(); i += 16)
+    {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i high = _mm_and_si128(_mm_srli_epi16(value, 4), low_nibbles);
+        const __m128i low = _mm_and_si128(value, low_nibbles);
+        __m128i first = _mm_unpacklo_epi8(high, low);
+        __m128i second = _mm_unpackhi_epi8(high, low);
+        first = _mm_add_epi8(_mm_add_epi8(first, digits), _mm_and_si128(_mm_cmpgt_epi8(first, nine), letters));
+        second = _mm_add_epi8(_mm_add_epi8(second, digits), _mm_and_si128(_mm_cmpgt_epi8(second, nine), letters));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), first);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 16), second);
+    }
+#endif
+
+    for (; i < bytes.size(); i++)
+    {
+        dst[2 * i] = hex_digits[src[i] >> 4];
+        dst[2 * i + 1] = hex_digits[src[i] & 0x0F];
+    }
+}
+
+#ifdef NDEF_OUTPUT_SSSE3
+/* Encodes 12 bytes into 16 characters per round, as long as 16 bytes can be
+read (W. Muła's method): reshuffles the bytes so that each 32-bit lane holds
+3 of them, extracts the four 6-bit indices with multiplies, then turns the
+indices into characters with a lookup of the offset of their range. Returns
+how many bytes were encoded.
+*/
+__attribute__((target("ssse3")))
+static std::size_t base64Ssse3(char* dst, const quint8* src, std::size_t size)
+{
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, -19, -16, 0, 0);
+
+    std::size_t i = 0;
+    for (; i + 16 <= size; i += 12, dst += 16)
+    {
+        __m128i in = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), shuffle);
+        const __m128i high = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+        const __m128i low = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+        const __m128i indices = _mm_or_si128(high, low);
+
+        __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+        range = _mm_sub_epi8(range, _mm_cmpgt_epi8(indices, _mm_set1_epi8(25)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range)));
+    }
+    return i;
+}
+#endif
+
+void ndefAppendBase64(QByteArray& out, ndef::Bytes bytes)
+{
+    const int start = out.size();
+    out.resize(start + 4 * int((bytes.size() + 2) / 3));
+    char* dst = out.data() + start;
+    const quint8* src = bytes.data();
+    std::size_t i = 0;
+
+#ifdef NDEF_OUTPUT_SSSE3
+    static const bool ssse3 = __builtin_cpu_supports("ssse3");
+    if (ssse3)
+    {
+        i = base64Ssse3(dst, src, bytes.size());
+        dst += i / 3 * 4;
+    }
+#endif
+
+    for (; i + 3 <= bytes.size(); i += 3, dst += 4)
+    {
+        const quint32 value = (quint32(src[i]) << 16) | (quint32(src[i + 1]) << 8) | src[i + 2];
+        dst[0] = base64_digits[value >> 18];
+        dst[1] = base64_digits[(value >> 12) & 0x3F];
+        dst[2] = base64_digits[(value >> 6) & 0x3F];
+        dst[3] = base64_digits[value & 0x3F];
+    }
+
+    if (i < bytes.size())
+    {
+        const bool two = (i + 1 < bytes.size());
+        const quint32 value = (quint32(src[i]) << 16) | (two ? quint32(src[i + 1]) << 8 : 0);
+        dst[0] = base64_digits[value >> 18];
+        dst[1] = base64_digits[(value >> 12) & 0x3F];
+        dst[2] = two ? base64_digits[(value >> 6) & 0x3F] : '=';
+        dst[3] = '=';
+    }
+}
+
+// Whether text is well-formed UTF-8 (overlong forms and surrogates excluded).
+static bool isUtf8(ndef::Bytes text)
+{
+    std::size_t i = 0;
+    while (i < text.size())
+    {
+        const quint8 c = text[i];
+        if (c < 0x80)
+        {
+            i++;
+            continue;
+        }
+
+        std::size_t length = (c >= 0xF0) ? 4 : (c >= 0xE0) ? 3 : 2;
+        if (c < 0xC2 || c > 0xF4 || text.available(i) < length)
+            return false;
+        for (std::size_t j = 1; j < length; j++)
+            if ((text[i + j] & 0xC0) != 0x80)
+                return false;
+        if ((c == 0xE0 && text[i + 1] < 0xA0) || (c == 0xED && text[i + 1] >= 0xA0)
+            || (c == 0xF0 && text[i + 1] < 0x90) || (c == 0xF4 && text[i + 1] >= 0x90))
+            return false;
+        i += length;
+    }
+    return true;
+}
+
+NDEFWriter::NDEFWriter(QIODevice* device, Encoding encoding, int batch_size)
+    :   m_device(device),
+        m_batchSize(batch_size),
+        m_encoding(encoding)
+{
+    m_buffer.reserve(batch_size + 4096);
+}
+
+NDEFWriter::~NDEFWriter()
+{
+    flush();
+}
+
+void NDEFWriter::flush()
+{
+    if (m_device && !m_buffer.isEmpty())
+    {
+        m_device->write(m_buffer);
+        // Keeps the capacity.
+        m_buffer.resize(0);
+    }
+}
+
+QByteArray NDEFWriter::takeBuffer()
+{
+    QByteArray buffer;
+    buffer.swap(m_buffer);
+    return buffer;
+}
+
+NDEFJsonWriter::NDEFJsonWriter(QIODevice* device, Encoding encoding, int batch_size)
+    :   NDEFWriter(device, encoding, batch_size)
+{
+}
+
+void NDEFJsonWriter::separate()
+{
+    if (!m_first.isEmpty())
+    {
+        if (!m_first.last())
+            m_buffer.append(',');
+        m_first.last() = false;
+    }
+}
+
+void NDEFJsonWriter::key(const char* name)
+{
+    separate();
+    m_buffer.append('"');
+    m_buffer.append(name);
+    m_buffer.append("\":");
+}
+
+void NDEFJsonWriter::string(ndef::Bytes text)
+{
+    // Text that is not UTF-8 is taken as Latin-1.
+    const bool utf8 = isUtf8(text);
+    std::size_t run = 0;
+    for (std::size_t i = 0; i < text.size(); i++)
+    {
+        const quint8 c = text[i];
+        if (c >= 0x20 && c != '"' && c != '\\' && (c < 0x80 || utf8))
+            continue;
+
+        m_buffer.append(reinterpret_cast<const char*>(text.data() + run), int(i - run));
+        run = i + 1;
+        switch (c)
+        {
+            case '"':   m_buffer.append("\\\""); break;
+            case '\\':  m_buffer.append("\\\\"); break;
+            case '\n':  m_buffer.append("\\n"); break;
+            case '\r':  m_buffer.append("\\r"); break;
+            case '\t':  m_buffer.append("\\t"); break;
+            default:
+                m_buffer.append("\\u00");
+                m_buffer.append(hex_digits[c >> 4]);
+                m_buffer.append(hex_digits[c & 0x0F]);
+                break;
+        }
+    }
+    m_buffer.append(reinterpret_cast<const char*>(text.data() + run), int(text.size() - run));
+}
+
+void NDEFJsonWriter::beginMessage()
+{
+    m_buffer.append('{');
+    m_first.append(true);
+}
+
+void NDEFJsonWriter::endMessage(bool valid)
+{
+    key("valid");
+    m_buffer.append(valid ? "true}\n" : "false}\n");
+    m_first.removeLast();
+
+    if (m_buffer.size() >= m_batchSize)
+        flush();
+}
+
+void NDEFJsonWriter::beginRecords(const char* name)
+{
+    key(name);
+    m_buffer.append('[');
+    m_first.append(true);
+}
+
+void NDEFJsonWriter::endRecords()
+{
+    m_buffer.append(']');
+    m_first.removeLast();
+}
+
+void NDEFJsonWriter::beginRecord()
+{
+    separate();
+    m_buffer.append('{');
+    m_first.append(true);
+}
+
+void NDEFJsonWriter::endRecord()
+{
+    m_buffer.append('}');
+    m_first.removeLast();
+}
+
+void NDEFJsonWriter::textField(const char* name, ndef::Bytes text, ndef::Bytes more)
+{
+    key(name);
+    m_buffer.append('"');
+    string(text);
+    string(more);
+    m_buffer.append('"');
+}
+
+void NDEFJsonWriter::bytesField(const char* name, ndef::Bytes bytes)
+{
+    key(name);
+    m_buffer.append('"');
+    if (m_encoding == Base64)
+        ndefAppendBase64(m_buffer, bytes);
+    else
+        ndefAppendHex(m_buffer, bytes);
+    m_buffer.append('"');
+}
+
+void NDEFJsonWriter::numberField(const char* name, quint64 value)
+{
+    key(name);
+    m_buffer.append(QByteArray::number(value));
+}
+
+NDEFCborWriter::NDEFCborWriter(QIODevice* device, int batch_size)
+    :   NDEFWriter(device, Hex, batch_size)
+{
+}
+
+// The initial byte of a data item and its argument, shortest form.
+void NDEFCborWriter::head(quint8 major, quint64 value)
+{
+    char bytes[9];
+    int length = 1;
+    major <<= 5;
+    if (value < 24)
+    {
+        bytes[0] = char(major | value);
+    }
+    else
+    {
+        const int size = (value <= 0xFF) ? 1 : (value <= 0xFFFF) ? 2 : (value <= 0xFFFFFFFFULL) ? 4 : 8;
+        bytes[0] = char(major | ((size == 1) ? 24 : (size == 2) ? 25 : (size == 4) ? 26 : 27));
+        for (int i = size; i > 0; i--, value >>= 8)
+            bytes[i] = char(value & 0xFF);
+        length += size;
+    }
+    m_buffer.append(bytes, length);
+}
+
+void NDEFCborWriter::key(const char* name)
+{
+    const int length = int(strlen(name));
+    head(3, length);
+    m_buffer.append(name, length);
+}
+
+void NDEFCborWriter::beginMessage()
+{
+    m_buffer.append(char(0xBF));    // Map of indefinite length.
+}
+
+void NDEFCborWriter::endMessage(bool valid)
+{
+    key("valid");
+    m_buffer.append(char(valid ? 0xF5 : 0xF4));
+    m_buffer.append(char(0xFF));
+
+    if (m_buffer.size() >= m_batchSize)
+        flush();
+}
+
+void NDEFCborWriter::beginRecords(const char* name)
+{
+    key(name);
+    m_buffer.append(char(0x9F));    // Array of indefinite length.
+}
+
+void NDEFCborWriter::endRecords()
+{
+    m_buffer.append(char(0xFF));
+}
+
+void NDEFCborWriter::beginRecord()
+{
+    m_buffer.append(char(0xBF));
+}
+
+void NDEFCborWriter::endRecord()
+{
+    m_buffer.append(char(0xFF));
+}
+
+void NDEFCborWriter::textField(const char* name, ndef::Bytes text, ndef::Bytes more)
+{
+    // Text strings must be UTF-8: anything else goes as a byte string.
+    key(name);
+    const bool utf8 = isUtf8(text) && isUtf8(more);
+    head(utf8 ? 3 : 2, text.size() + more.size());
+    m_buffer.append(reinterpret_cast<const char*>(text.data()), int(text.size()));
+    m_buffer.append(reinterpret_cast<const char*>(more.data()), int(more.size()));
+}
+
+void NDEFCborWriter::bytesField(const char* name, ndef::Bytes bytes)
+{
+    key(name);
+    head(2, bytes.size());
+    m_buffer.append(reinterpret_cast<const char*>(bytes.data()), int(bytes.size()));
+}
+
+void NDEFCborWriter::numberField(const char* name, quint64 value)
+{
+    key(name);
+    head(0, value);
+}
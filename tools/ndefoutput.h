@@ -0,0 +1,127 @@
+/**
+ * This file is part of the libndef project.
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>
+ */
+
+#ifndef NDEFOUTPUT_H
+#define NDEFOUTPUT_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QVector>
+#include <ndef/core/bytes.h>
+
+/* Machine-readable output of ndef-decode: one structured record per message,
+as JSON Lines or as a CBOR sequence (RFC 8742).
+
+Everything is written to one buffer, sent to the device by flush(), or by
+endMessage() once the buffer holds batchSize bytes. A message is written as
+
+    beginMessage()
+        [fields of the message]
+        beginRecords("records")
+            beginRecord() fields [beginRecords() ... endRecords()] endRecord()
+            ...
+        endRecords()
+    endMessage(valid)
+
+JSON has byte fields (IDs, payloads) in hex or base64; CBOR has them as byte
+strings.
+*/
+
+class NDEFWriter
+{
+public:
+    enum Encoding
+    {
+        Hex,
+        Base64
+    };
+
+protected:
+    QIODevice* m_device;
+    QByteArray m_buffer;
+    int m_batchSize;
+    Encoding m_encoding;
+    QVector<bool> m_first;      // Per open object: whether nothing was written in it yet.
+
+public:
+    // Without device, the output stays in the buffer until takeBuffer().
+    NDEFWriter(QIODevice* device, Encoding encoding, int batch_size);
+    virtual ~NDEFWriter();
+
+    virtual void beginMessage() = 0;
+    virtual void endMessage(bool valid) = 0;
+    virtual void beginRecords(const char* name) = 0;
+    virtual void endRecords() = 0;
+    virtual void beginRecord() = 0;
+    virtual void endRecord() = 0;
+
+    // Text fields are UTF-8, written as two parts so that e.g. a URI needs
+    // not be put together first.
+    virtual void textField(const char* name, ndef::Bytes text, ndef::Bytes more = ndef::Bytes()) = 0;
+    virtual void bytesField(const char* name, ndef::Bytes bytes) = 0;
+    virtual void numberField(const char* name, quint64 value) = 0;
+
+    void flush();
+    QByteArray takeBuffer();
+};
+
+class NDEFJsonWriter : public NDEFWriter
+{
+public:
+    NDEFJsonWriter(QIODevice* device, Encoding encoding, int batch_size = 256 * 1024);
+
+    void beginMessage();
+    void endMessage(bool valid);
+    void beginRecords(const char* name);
+    void endRecords();
+    void beginRecord();
+    void endRecord();
+    void textField(const char* name, ndef::Bytes text, ndef::Bytes more = ndef::Bytes());
+    void bytesField(const char* name, ndef::Bytes bytes);
+    void numberField(const char* name, quint64 value);
+
+protected:
+    void separate();
+    void key(const char* name);
+    void string(ndef::Bytes text);
+};
+
+class NDEFCborWriter : public NDEFWriter
+{
+public:
+    NDEFCborWriter(QIODevice* device, int batch_size = 256 * 1024);
+
+    void beginMessage();
+    void endMessage(bool valid);
+    void beginRecords(const char* name);
+    void endRecords();
+    void beginRecord();
+    void endRecord();
+    void textField(const char* name, ndef::Bytes text, ndef::Bytes more = ndef::Bytes());
+    void bytesField(const char* name, ndef::Bytes bytes);
+    void numberField(const char* name, quint64 value);
+
+protected:
+    void head(quint8 major, quint64 value);
+    void key(const char* name);
+};
+
+// Hex (lowercase) and base64 of bytes, appended to out.
+void ndefAppendHex(QByteArray& out, ndef::Bytes bytes);
+void ndefAppendBase64(QByteArray& out, ndef::Bytes bytes);
+
+#endif // NDEFOUTPUT_H
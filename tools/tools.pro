@@ -21,5 +21,9 @@
 TEMPLATE = subdirs
 
 SUBDIRS = ndef-decode.pro \
-	  ndef-encode.pro
+	  ndef-encode.pro \
+	  ndef-gen.pro \
+	  ndef-stats.pro
 
+# ndef-grep uses QRegularExpression, new in Qt 5.
+greaterThan(QT_MAJOR_VERSION, 4): SUBDIRS += ndef-grep.pro